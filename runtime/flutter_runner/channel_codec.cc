@@ -0,0 +1,470 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/channel_codec.h"
+
+#include <cstring>
+#include <limits>
+
+#include "flutter/fml/logging.h"
+#include "rapidjson/reader.h"
+
+namespace flutter_runner {
+
+namespace {
+
+// Type tags of the standard encoding.  See Flutter's |StandardMessageCodec|.
+constexpr uint8_t kStandardNull = 0;
+constexpr uint8_t kStandardTrue = 1;
+constexpr uint8_t kStandardFalse = 2;
+constexpr uint8_t kStandardInt32 = 3;
+constexpr uint8_t kStandardInt64 = 4;
+constexpr uint8_t kStandardLargeInt = 5;
+constexpr uint8_t kStandardFloat64 = 6;
+constexpr uint8_t kStandardString = 7;
+constexpr uint8_t kStandardUint8List = 8;
+constexpr uint8_t kStandardInt32List = 9;
+constexpr uint8_t kStandardInt64List = 10;
+constexpr uint8_t kStandardFloat64List = 11;
+constexpr uint8_t kStandardList = 12;
+constexpr uint8_t kStandardMap = 13;
+
+// Sizes below this take one byte; larger ones are tagged as 2 or 4 bytes.
+constexpr uint8_t kStandardSize16 = 254;
+constexpr uint8_t kStandardSize32 = 255;
+
+// Deeper values are rejected rather than risk the stack.
+constexpr size_t kMaxDepth = 64;
+
+// Reads standard encoded values out of a message.
+class StandardReader final {
+ public:
+  StandardReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+  bool done() const { return position_ == size_; }
+
+  bool ReadValue(ChannelValue* value, size_t depth = 0) {
+    uint8_t tag;
+    if (depth > kMaxDepth || !Read(&tag, sizeof(tag))) {
+      return false;
+    }
+    switch (tag) {
+      case kStandardNull:
+        value->type = ChannelValue::Type::kNull;
+        return true;
+      case kStandardTrue:
+      case kStandardFalse:
+        value->type = ChannelValue::Type::kBool;
+        value->bool_value = tag == kStandardTrue;
+        return true;
+      case kStandardInt32: {
+        int32_t int_value;
+        if (!Read(&int_value, sizeof(int_value))) {
+          return false;
+        }
+        value->type = ChannelValue::Type::kInt;
+        value->int_value = int_value;
+        return true;
+      }
+      case kStandardInt64:
+        value->type = ChannelValue::Type::kInt;
+        return Read(&value->int_value, sizeof(value->int_value));
+      case kStandardFloat64:
+        value->type = ChannelValue::Type::kDouble;
+        return Align(sizeof(double)) &&
+               Read(&value->double_value, sizeof(value->double_value));
+      case kStandardLargeInt:
+      case kStandardString:
+        value->type = ChannelValue::Type::kString;
+        return ReadSpan(1, 1, &value->string_value);
+      case kStandardUint8List:
+        value->type = ChannelValue::Type::kBytes;
+        return ReadSpan(1, 1, &value->string_value);
+      case kStandardInt32List:
+        value->type = ChannelValue::Type::kBytes;
+        return ReadSpan(sizeof(int32_t), sizeof(int32_t),
+                        &value->string_value);
+      case kStandardInt64List:
+        value->type = ChannelValue::Type::kBytes;
+        return ReadSpan(sizeof(int64_t), sizeof(int64_t),
+                        &value->string_value);
+      case kStandardFloat64List:
+        value->type = ChannelValue::Type::kBytes;
+        return ReadSpan(sizeof(double), sizeof(double), &value->string_value);
+      case kStandardList:
+      case kStandardMap: {
+        const bool is_map = tag == kStandardMap;
+        size_t size;
+        // Every item takes at least a byte, which bounds |size| before it
+        // is used to allocate.
+        if (!ReadSize(&size) || size > (size_ - position_) / (is_map ? 2 : 1)) {
+          return false;
+        }
+        value->type =
+            is_map ? ChannelValue::Type::kMap : ChannelValue::Type::kList;
+        value->items.resize(is_map ? size * 2 : size);
+        for (ChannelValue& item : value->items) {
+          if (!ReadValue(&item, depth + 1)) {
+            return false;
+          }
+        }
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
+ private:
+  bool Read(void* out, size_t size) {
+    if (size > size_ - position_) {
+      return false;
+    }
+    memcpy(out, data_ + position_, size);
+    position_ += size;
+    return true;
+  }
+
+  bool ReadSize(size_t* size) {
+    uint8_t byte;
+    if (!Read(&byte, sizeof(byte))) {
+      return false;
+    }
+    if (byte < kStandardSize16) {
+      *size = byte;
+      return true;
+    }
+    if (byte == kStandardSize16) {
+      uint16_t size16;
+      if (!Read(&size16, sizeof(size16))) {
+        return false;
+      }
+      *size = size16;
+      return true;
+    }
+    uint32_t size32;
+    if (!Read(&size32, sizeof(size32))) {
+      return false;
+    }
+    *size = size32;
+    return true;
+  }
+
+  // Skips padding up to a multiple of |alignment| from the message start.
+  bool Align(size_t alignment) {
+    const size_t padding = (alignment - position_ % alignment) % alignment;
+    if (padding > size_ - position_) {
+      return false;
+    }
+    position_ += padding;
+    return true;
+  }
+
+  // Reads a size, then that many elements of |element_size| bytes aligned to
+  // |alignment|, without copying them.
+  bool ReadSpan(size_t element_size,
+                size_t alignment,
+                std::string_view* span) {
+    size_t size;
+    if (!ReadSize(&size) || !Align(alignment) ||
+        size > (size_ - position_) / element_size) {
+      return false;
+    }
+    *span = std::string_view(reinterpret_cast<const char*>(data_ + position_),
+                             size * element_size);
+    position_ += size * element_size;
+    return true;
+  }
+
+  const uint8_t* const data_;
+  const size_t size_;
+  size_t position_ = 0;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(StandardReader);
+};
+
+// Builds a value from the events of a JSON document parsed in place, so
+// that its strings stay in the parsed buffer.
+class JsonValueBuilder final
+    : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, JsonValueBuilder> {
+ public:
+  explicit JsonValueBuilder(ChannelValue* root) : root_(root) {}
+
+  bool Null() {
+    Add(ChannelValue::Type::kNull);
+    return true;
+  }
+
+  bool Bool(bool value) {
+    Add(ChannelValue::Type::kBool)->bool_value = value;
+    return true;
+  }
+
+  bool Int(int value) { return Int64(value); }
+
+  bool Uint(unsigned value) { return Int64(value); }
+
+  bool Int64(int64_t value) {
+    Add(ChannelValue::Type::kInt)->int_value = value;
+    return true;
+  }
+
+  bool Uint64(uint64_t value) {
+    if (value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+      return Double(static_cast<double>(value));
+    }
+    return Int64(static_cast<int64_t>(value));
+  }
+
+  bool Double(double value) {
+    Add(ChannelValue::Type::kDouble)->double_value = value;
+    return true;
+  }
+
+  bool String(const char* value, rapidjson::SizeType length, bool copy) {
+    FML_DCHECK(!copy);
+    Add(ChannelValue::Type::kString)->string_value =
+        std::string_view(value, length);
+    return true;
+  }
+
+  bool Key(const char* value, rapidjson::SizeType length, bool copy) {
+    return String(value, length, copy);
+  }
+
+  bool StartObject() {
+    open_.push_back(Add(ChannelValue::Type::kMap));
+    return true;
+  }
+
+  bool EndObject(rapidjson::SizeType /* member_count */) {
+    open_.pop_back();
+    return true;
+  }
+
+  bool StartArray() {
+    open_.push_back(Add(ChannelValue::Type::kList));
+    return true;
+  }
+
+  bool EndArray(rapidjson::SizeType /* element_count */) {
+    open_.pop_back();
+    return true;
+  }
+
+ private:
+  // Only the innermost open list or map grows, so pointers to the others
+  // stay valid.
+  ChannelValue* Add(ChannelValue::Type type) {
+    ChannelValue* value = root_;
+    if (!open_.empty()) {
+      value = &open_.back()->items.emplace_back();
+    }
+    value->type = type;
+    return value;
+  }
+
+  ChannelValue* const root_;
+  std::vector<ChannelValue*> open_;
+};
+
+}  // namespace
+
+const ChannelValue* ChannelValue::Find(std::string_view key) const {
+  if (type != Type::kMap) {
+    return nullptr;
+  }
+  for (size_t i = 0; i + 1 < items.size(); i += 2) {
+    if (items[i].IsString() && items[i].string_value == key) {
+      return &items[i + 1];
+    }
+  }
+  return nullptr;
+}
+
+MethodCall::MethodCall() = default;
+
+MethodCall::~MethodCall() = default;
+
+bool MethodCall::Decode(const std::vector<uint8_t>& message) {
+  args_ = ChannelValue();
+  if (!message.empty() && message[0] == kStandardString) {
+    codec_ = ChannelCodec::kStandard;
+    StandardReader reader(message.data(), message.size());
+    ChannelValue method;
+    if (!reader.ReadValue(&method) || !method.IsString() ||
+        !reader.ReadValue(&args_) || !reader.done()) {
+      return false;
+    }
+    method_ = method.string_value;
+    return true;
+  }
+
+  codec_ = ChannelCodec::kJson;
+  json_.assign(message.begin(), message.end());
+  json_.push_back('\0');
+  ChannelValue root;
+  JsonValueBuilder builder(&root);
+  rapidjson::Reader reader;
+  rapidjson::InsituStringStream stream(json_.data());
+  reader.Parse<rapidjson::kParseInsituFlag>(stream, builder);
+  if (reader.HasParseError()) {
+    return false;
+  }
+  const ChannelValue* method = root.Find("method");
+  if (method == nullptr || !method->IsString()) {
+    return false;
+  }
+  method_ = method->string_value;
+  for (size_t i = 0; i + 1 < root.items.size(); i += 2) {
+    if (root.items[i].IsString() && root.items[i].string_value == "args") {
+      args_ = std::move(root.items[i + 1]);
+      break;
+    }
+  }
+  return true;
+}
+
+ChannelWriter::ChannelWriter(ChannelCodec codec, size_t capacity)
+    : codec_(codec), json_stream_(&buffer_), json_writer_(json_stream_) {
+  buffer_.reserve(capacity);
+}
+
+ChannelWriter::~ChannelWriter() = default;
+
+void ChannelWriter::BeginMethodCall(std::string_view method) {
+  FML_DCHECK(buffer_.empty());
+  envelope_ = Envelope::kMethodCall;
+  if (codec_ == ChannelCodec::kStandard) {
+    String(method);
+  } else {
+    json_writer_.StartObject();
+    Key("method");
+    String(method);
+    Key("args");
+  }
+}
+
+void ChannelWriter::BeginSuccess() {
+  FML_DCHECK(buffer_.empty());
+  envelope_ = Envelope::kSuccess;
+  if (codec_ == ChannelCodec::kStandard) {
+    buffer_.push_back(0);
+  } else {
+    json_writer_.StartArray();
+  }
+}
+
+void ChannelWriter::Null() {
+  if (codec_ == ChannelCodec::kStandard) {
+    buffer_.push_back(kStandardNull);
+  } else {
+    json_writer_.Null();
+  }
+}
+
+void ChannelWriter::Bool(bool value) {
+  if (codec_ == ChannelCodec::kStandard) {
+    buffer_.push_back(value ? kStandardTrue : kStandardFalse);
+  } else {
+    json_writer_.Bool(value);
+  }
+}
+
+void ChannelWriter::Int(int64_t value) {
+  if (codec_ == ChannelCodec::kStandard) {
+    if (value >= std::numeric_limits<int32_t>::min() &&
+        value <= std::numeric_limits<int32_t>::max()) {
+      const int32_t value32 = static_cast<int32_t>(value);
+      buffer_.push_back(kStandardInt32);
+      WriteBytes(&value32, sizeof(value32));
+    } else {
+      buffer_.push_back(kStandardInt64);
+      WriteBytes(&value, sizeof(value));
+    }
+  } else {
+    json_writer_.Int64(value);
+  }
+}
+
+void ChannelWriter::String(std::string_view value) {
+  if (codec_ == ChannelCodec::kStandard) {
+    buffer_.push_back(kStandardString);
+    WriteSize(value.size());
+    WriteBytes(value.data(), value.size());
+  } else {
+    json_writer_.String(value.data(),
+                        static_cast<rapidjson::SizeType>(value.size()));
+  }
+}
+
+void ChannelWriter::BeginList(size_t size) {
+  if (codec_ == ChannelCodec::kStandard) {
+    buffer_.push_back(kStandardList);
+    WriteSize(size);
+  } else {
+    json_writer_.StartArray();
+  }
+}
+
+void ChannelWriter::EndList() {
+  if (codec_ == ChannelCodec::kJson) {
+    json_writer_.EndArray();
+  }
+}
+
+void ChannelWriter::BeginMap(size_t size) {
+  if (codec_ == ChannelCodec::kStandard) {
+    buffer_.push_back(kStandardMap);
+    WriteSize(size);
+  } else {
+    json_writer_.StartObject();
+  }
+}
+
+void ChannelWriter::Key(std::string_view key) {
+  if (codec_ == ChannelCodec::kStandard) {
+    String(key);
+  } else {
+    json_writer_.Key(key.data(), static_cast<rapidjson::SizeType>(key.size()));
+  }
+}
+
+void ChannelWriter::EndMap() {
+  if (codec_ == ChannelCodec::kJson) {
+    json_writer_.EndObject();
+  }
+}
+
+std::vector<uint8_t> ChannelWriter::Finish() {
+  if (codec_ == ChannelCodec::kJson) {
+    if (envelope_ == Envelope::kMethodCall) {
+      json_writer_.EndObject();
+    } else if (envelope_ == Envelope::kSuccess) {
+      json_writer_.EndArray();
+    }
+  }
+  return std::move(buffer_);
+}
+
+void ChannelWriter::WriteSize(size_t size) {
+  if (size < kStandardSize16) {
+    buffer_.push_back(static_cast<uint8_t>(size));
+  } else if (size <= std::numeric_limits<uint16_t>::max()) {
+    const uint16_t size16 = static_cast<uint16_t>(size);
+    buffer_.push_back(kStandardSize16);
+    WriteBytes(&size16, sizeof(size16));
+  } else {
+    const uint32_t size32 = static_cast<uint32_t>(size);
+    buffer_.push_back(kStandardSize32);
+    WriteBytes(&size32, sizeof(size32));
+  }
+}
+
+void ChannelWriter::WriteBytes(const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  buffer_.insert(buffer_.end(), bytes, bytes + size);
+}
+
+}  // namespace flutter_runner
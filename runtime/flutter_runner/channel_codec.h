@@ -0,0 +1,172 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_CHANNEL_CODEC_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_CHANNEL_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "flutter/fml/macros.h"
+#include "rapidjson/writer.h"
+
+namespace flutter_runner {
+
+// The encodings a platform channel message may use: those of Flutter's
+// |JSONMethodCodec| and |StandardMethodCodec|.
+enum class ChannelCodec {
+  kJson,
+  kStandard,
+};
+
+// A value decoded from a platform channel message.  Strings and byte arrays
+// are not copied: they refer into the decoded message, which must outlive
+// them.
+struct ChannelValue {
+  enum class Type {
+    kNull,
+    kBool,
+    kInt,
+    kDouble,
+    kString,
+    // A byte array or typed list of the standard encoding, as raw bytes.
+    kBytes,
+    kList,
+    kMap,
+  };
+
+  bool IsNull() const { return type == Type::kNull; }
+  bool IsBool() const { return type == Type::kBool; }
+  bool IsInt() const { return type == Type::kInt; }
+  bool IsString() const { return type == Type::kString; }
+  bool IsList() const { return type == Type::kList; }
+  bool IsMap() const { return type == Type::kMap; }
+
+  // Returns the value of |key| in a map with string keys, or null if this is
+  // not a map or has no such key.
+  const ChannelValue* Find(std::string_view key) const;
+
+  Type type = Type::kNull;
+  bool bool_value = false;
+  int64_t int_value = 0;
+  double double_value = 0;
+  // Also holds the bytes of |kBytes|.
+  std::string_view string_value;
+  // The elements of a list, or the keys and values of a map, alternating.
+  std::vector<ChannelValue> items;
+};
+
+// A method call received on a platform channel, in either encoding.  A
+// message whose first byte is the standard encoding's string tag is decoded
+// as a standard method call; anything else is parsed as JSON.
+//
+// The standard decoder reads straight out of the message.  JSON is parsed in
+// place from one copy of the message, without building a document.
+class MethodCall final {
+ public:
+  MethodCall();
+
+  ~MethodCall();
+
+  // Returns false if |message| is not a method call.  |message| must outlive
+  // this.
+  bool Decode(const std::vector<uint8_t>& message);
+
+  ChannelCodec codec() const { return codec_; }
+
+  std::string_view method() const { return method_; }
+
+  // Null if the call had no arguments.
+  const ChannelValue& args() const { return args_; }
+
+ private:
+  ChannelCodec codec_ = ChannelCodec::kJson;
+  std::string_view method_;
+  ChannelValue args_;
+  // Backs the strings of a JSON call.
+  std::vector<char> json_;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(MethodCall);
+};
+
+// Encodes a platform channel message into a buffer of a given initial
+// capacity, writing values as they are given rather than building them up
+// first.
+//
+// A message is either a method call, begun with |BeginMethodCall| and
+// followed by its arguments, a successful reply, begun with |BeginSuccess|
+// and followed by its result, or a bare value.  Maps are written as
+// alternating calls to |Key| and a value.  The standard encoding needs the
+// size of each list and map up front; JSON needs them closed.
+class ChannelWriter final {
+ public:
+  ChannelWriter(ChannelCodec codec, size_t capacity);
+
+  ~ChannelWriter();
+
+  void BeginMethodCall(std::string_view method);
+
+  void BeginSuccess();
+
+  void Null();
+
+  void Bool(bool value);
+
+  void Int(int64_t value);
+
+  void String(std::string_view value);
+
+  void BeginList(size_t size);
+
+  void EndList();
+
+  void BeginMap(size_t size);
+
+  void Key(std::string_view key);
+
+  void EndMap();
+
+  // Returns the encoded message.  The writer may not be used afterwards.
+  std::vector<uint8_t> Finish();
+
+ private:
+  // Lets |rapidjson::Writer| append to |buffer_|.
+  class JsonStream final {
+   public:
+    using Ch = char;
+
+    explicit JsonStream(std::vector<uint8_t>* buffer) : buffer_(buffer) {}
+
+    void Put(char c) { buffer_->push_back(static_cast<uint8_t>(c)); }
+
+    void Flush() {}
+
+   private:
+    std::vector<uint8_t>* buffer_;
+  };
+
+  enum class Envelope {
+    kNone,
+    kMethodCall,
+    kSuccess,
+  };
+
+  void WriteSize(size_t size);
+
+  void WriteBytes(const void* data, size_t size);
+
+  const ChannelCodec codec_;
+  Envelope envelope_ = Envelope::kNone;
+  std::vector<uint8_t> buffer_;
+  JsonStream json_stream_;
+  rapidjson::Writer<JsonStream> json_writer_;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(ChannelWriter);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_CHANNEL_CODEC_H_
@@ -0,0 +1,171 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/channel_codec.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace flutter_runner_test {
+
+using flutter_runner::ChannelCodec;
+using flutter_runner::ChannelValue;
+using flutter_runner::ChannelWriter;
+using flutter_runner::MethodCall;
+
+namespace {
+
+std::vector<uint8_t> Bytes(const std::string& text) {
+  return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+std::string Text(const std::vector<uint8_t>& bytes) {
+  return std::string(bytes.begin(), bytes.end());
+}
+
+// The arguments of TextInputClient.updateEditingState.
+std::vector<uint8_t> WriteEditingState(ChannelCodec codec,
+                                       const std::string& text) {
+  ChannelWriter writer(codec, 64);
+  writer.BeginMethodCall("TextInputClient.updateEditingState");
+  writer.BeginList(2);
+  writer.Int(3);
+  writer.BeginMap(3);
+  writer.Key("text");
+  writer.String(text);
+  writer.Key("selectionBase");
+  writer.Int(-1);
+  writer.Key("selectionIsDirectional");
+  writer.Bool(true);
+  writer.EndMap();
+  writer.EndList();
+  return writer.Finish();
+}
+
+void ExpectEditingState(const MethodCall& call, const std::string& text) {
+  EXPECT_EQ(call.method(), "TextInputClient.updateEditingState");
+  const ChannelValue& args = call.args();
+  ASSERT_TRUE(args.IsList());
+  ASSERT_EQ(args.items.size(), 2u);
+  ASSERT_TRUE(args.items[0].IsInt());
+  EXPECT_EQ(args.items[0].int_value, 3);
+  const ChannelValue* value = args.items[1].Find("text");
+  ASSERT_NE(value, nullptr);
+  ASSERT_TRUE(value->IsString());
+  EXPECT_EQ(value->string_value, text);
+  value = args.items[1].Find("selectionBase");
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(value->int_value, -1);
+  value = args.items[1].Find("selectionIsDirectional");
+  ASSERT_NE(value, nullptr);
+  ASSERT_TRUE(value->IsBool());
+  EXPECT_TRUE(value->bool_value);
+  EXPECT_EQ(args.items[1].Find("composingBase"), nullptr);
+}
+
+}  // namespace
+
+TEST(ChannelCodecTest, RoundTripsBothCodecs) {
+  const std::string long_text(300, 'x');
+  for (ChannelCodec codec : {ChannelCodec::kJson, ChannelCodec::kStandard}) {
+    for (const std::string& text : {std::string("a \"quoted\" word"),
+                                    std::string(), long_text}) {
+      const std::vector<uint8_t> message = WriteEditingState(codec, text);
+      MethodCall call;
+      ASSERT_TRUE(call.Decode(message));
+      EXPECT_EQ(call.codec(), codec);
+      ExpectEditingState(call, text);
+    }
+  }
+}
+
+TEST(ChannelCodecTest, WritesJson) {
+  EXPECT_EQ(Text(WriteEditingState(ChannelCodec::kJson, "hi")),
+            "{\"method\":\"TextInputClient.updateEditingState\",\"args\":"
+            "[3,{\"text\":\"hi\",\"selectionBase\":-1,"
+            "\"selectionIsDirectional\":true}]}");
+
+  ChannelWriter writer(ChannelCodec::kJson, 0);
+  writer.BeginSuccess();
+  writer.BeginMap(1);
+  writer.Key("text");
+  writer.String("copied");
+  writer.EndMap();
+  EXPECT_EQ(Text(writer.Finish()), "[{\"text\":\"copied\"}]");
+}
+
+TEST(ChannelCodecTest, WritesStandard) {
+  ChannelWriter writer(ChannelCodec::kStandard, 0);
+  writer.BeginSuccess();
+  writer.BeginMap(1);
+  writer.Key("a");
+  writer.Int(int64_t{1} << 40);
+  const std::vector<uint8_t> expected = {
+      0,                                // success
+      13, 1,                            // map of one entry
+      7,  1, 'a',                       // "a"
+      4,  0, 0, 0, 0, 0, 1, 0, 0,       // int64
+  };
+  EXPECT_EQ(writer.Finish(), expected);
+}
+
+TEST(ChannelCodecTest, DecodesStandardAlignedValues) {
+  // "m" with [1.5, Int32List [7]]: the double and the list contents are
+  // aligned to their size from the start of the message.
+  std::vector<uint8_t> message = {7, 1, 'm', 12, 2, 6, 0, 0};
+  const double value = 1.5;
+  const uint8_t* value_bytes = reinterpret_cast<const uint8_t*>(&value);
+  message.insert(message.end(), value_bytes, value_bytes + sizeof(value));
+  message.insert(message.end(), {9, 1, 0, 0, 7, 0, 0, 0});
+
+  MethodCall call;
+  ASSERT_TRUE(call.Decode(message));
+  EXPECT_EQ(call.codec(), ChannelCodec::kStandard);
+  EXPECT_EQ(call.method(), "m");
+  ASSERT_TRUE(call.args().IsList());
+  ASSERT_EQ(call.args().items.size(), 2u);
+  EXPECT_EQ(call.args().items[0].type, ChannelValue::Type::kDouble);
+  EXPECT_EQ(call.args().items[0].double_value, 1.5);
+  EXPECT_EQ(call.args().items[1].type, ChannelValue::Type::kBytes);
+  EXPECT_EQ(call.args().items[1].string_value.size(), 4u);
+  EXPECT_EQ(call.args().items[1].string_value.data(),
+            reinterpret_cast<const char*>(message.data() + 20));
+}
+
+TEST(ChannelCodecTest, DecodesJsonWithoutArgs) {
+  const std::vector<uint8_t> message = Bytes("{\"method\":\"TextInput.show\"}");
+  MethodCall call;
+  ASSERT_TRUE(call.Decode(message));
+  EXPECT_EQ(call.codec(), ChannelCodec::kJson);
+  EXPECT_EQ(call.method(), "TextInput.show");
+  EXPECT_TRUE(call.args().IsNull());
+}
+
+TEST(ChannelCodecTest, RejectsMalformedMessages) {
+  const std::vector<std::vector<uint8_t>> messages = {
+      {},
+      Bytes("{\"method\":"),
+      Bytes("{\"args\":{}}"),
+      Bytes("{\"method\":1}"),
+      Bytes("[\"method\"]"),
+      // Truncated string.
+      {7, 5, 'a'},
+      // Method without arguments.
+      {7, 1, 'a'},
+      // Trailing bytes.
+      {7, 1, 'a', 0, 0},
+      // A list longer than the message.
+      {7, 1, 'a', 12, 254, 255, 255},
+      // Unknown type.
+      {7, 1, 'a', 99},
+  };
+  for (const auto& message : messages) {
+    MethodCall call;
+    EXPECT_FALSE(call.Decode(message)) << Text(message);
+  }
+}
+
+}  // namespace flutter_runner_test
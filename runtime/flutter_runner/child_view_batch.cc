@@ -0,0 +1,23 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/child_view_batch.h"
+
+namespace flutter_runner {
+
+ChildViewBatch::ChildViewBatch() = default;
+
+ChildViewBatch::~ChildViewBatch() = default;
+
+void ChildViewBatch::Add(const ChildViewEvent& event) {
+  events_.push_back(event);
+}
+
+std::vector<ChildViewEvent> ChildViewBatch::Take() {
+  std::vector<ChildViewEvent> events = std::move(events_);
+  events_.clear();
+  return events;
+}
+
+}  // namespace flutter_runner
@@ -0,0 +1,59 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_CHILD_VIEW_BATCH_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_CHILD_VIEW_BATCH_H_
+
+#include <lib/ui/scenic/cpp/id.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "flutter/fml/macros.h"
+
+namespace flutter_runner {
+
+// A change to a child view that |flutter::SceneHost| is told about.
+struct ChildViewEvent {
+  enum class Type {
+    kConnected,
+    kDisconnected,
+    kStateChanged,
+  };
+
+  Type type;
+  scenic::ResourceId view_holder_id;
+  // Whether the view is rendering, for |kStateChanged|.
+  bool is_rendering;
+};
+
+// Gathers the child view events Scenic delivers together, so that the UI
+// thread gets one task per batch rather than one per event.
+//
+// Every event is kept: the framework sees each rendering state a view went
+// through, even when a later one in the batch undoes it.
+class ChildViewBatch final {
+ public:
+  ChildViewBatch();
+
+  ~ChildViewBatch();
+
+  bool empty() const { return events_.empty(); }
+
+  size_t size() const { return events_.size(); }
+
+  void Add(const ChildViewEvent& event);
+
+  // Returns the events added since the last call, in order.
+  std::vector<ChildViewEvent> Take();
+
+ private:
+  std::vector<ChildViewEvent> events_;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(ChildViewBatch);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_CHILD_VIEW_BATCH_H_
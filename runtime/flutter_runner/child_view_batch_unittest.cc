@@ -0,0 +1,65 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/child_view_batch.h"
+
+#include <gtest/gtest.h>
+
+namespace flutter_runner_test {
+
+using flutter_runner::ChildViewBatch;
+using flutter_runner::ChildViewEvent;
+
+namespace {
+
+ChildViewEvent Connected(scenic::ResourceId id) {
+  return {ChildViewEvent::Type::kConnected, id, false};
+}
+
+ChildViewEvent Disconnected(scenic::ResourceId id) {
+  return {ChildViewEvent::Type::kDisconnected, id, false};
+}
+
+ChildViewEvent StateChanged(scenic::ResourceId id, bool is_rendering) {
+  return {ChildViewEvent::Type::kStateChanged, id, is_rendering};
+}
+
+}  // namespace
+
+TEST(ChildViewBatchTest, KeepsEventsInOrder) {
+  ChildViewBatch batch;
+  batch.Add(Connected(1));
+  batch.Add(Connected(2));
+  batch.Add(StateChanged(1, true));
+  batch.Add(Disconnected(2));
+  EXPECT_EQ(batch.size(), 4u);
+
+  auto events = batch.Take();
+  ASSERT_EQ(events.size(), 4u);
+  EXPECT_EQ(events[0].type, ChildViewEvent::Type::kConnected);
+  EXPECT_EQ(events[1].view_holder_id, 2u);
+  EXPECT_EQ(events[2].type, ChildViewEvent::Type::kStateChanged);
+  EXPECT_TRUE(events[2].is_rendering);
+  EXPECT_EQ(events[3].type, ChildViewEvent::Type::kDisconnected);
+  EXPECT_TRUE(batch.empty());
+}
+
+TEST(ChildViewBatchTest, KeepsEveryStateChange) {
+  ChildViewBatch batch;
+  batch.Add(StateChanged(1, true));
+  batch.Add(StateChanged(1, false));
+  batch.Add(StateChanged(1, true));
+
+  // The view stopped rendering in between, which the framework must see.
+  auto events = batch.Take();
+  ASSERT_EQ(events.size(), 3u);
+  EXPECT_TRUE(events[0].is_rendering);
+  EXPECT_FALSE(events[1].is_rendering);
+  EXPECT_TRUE(events[2].is_rendering);
+
+  batch.Add(StateChanged(1, false));
+  EXPECT_EQ(batch.size(), 1u);
+}
+
+}  // namespace flutter_runner_test
@@ -36,6 +36,8 @@
 namespace flutter_runner {
 
 constexpr char kDataKey[] = "data";
+constexpr char kLatchPointerInputKey[] = "latch_pointer_input";
+constexpr char kMaxPresentsInFlightKey[] = "max_presents_in_flight";
 constexpr char kTmpPath[] = "/tmp";
 constexpr char kServiceRootPath[] = "/svc";
 
@@ -44,7 +46,8 @@ Application::Create(
     TerminationCallback termination_callback, fuchsia::sys::Package package,
     fuchsia::sys::StartupInfo startup_info,
     std::shared_ptr<sys::ServiceDirectory> runner_incoming_services,
-    fidl::InterfaceRequest<fuchsia::sys::ComponentController> controller) {
+    fidl::InterfaceRequest<fuchsia::sys::ComponentController> controller,
+    inspect::Node inspect_node) {
   std::unique_ptr<Thread> thread = std::make_unique<Thread>();
   std::unique_ptr<Application> application;
 
@@ -53,7 +56,7 @@ Application::Create(
     application.reset(
         new Application(std::move(termination_callback), std::move(package),
                         std::move(startup_info), runner_incoming_services,
-                        std::move(controller)));
+                        std::move(controller), std::move(inspect_node)));
     latch.Signal();
   });
 
@@ -61,6 +64,29 @@ Application::Create(
   return {std::move(thread), std::move(application)};
 }
 
+// Parses a positive decimal number out of program metadata.
+static bool ParsePositiveSize(const std::string& text, size_t* out_value) {
+  size_t value = 0;
+  std::istringstream stream(text);
+  if (!(stream >> value) || !stream.eof() || value == 0) {
+    return false;
+  }
+  *out_value = value;
+  return true;
+}
+
+// Parses "true" or "false" out of program metadata.
+static bool ParseBool(const std::string& text, bool* out_value) {
+  if (text == "true") {
+    *out_value = true;
+  } else if (text == "false") {
+    *out_value = false;
+  } else {
+    return false;
+  }
+  return true;
+}
+
 static std::string DebugLabelForURL(const std::string& url) {
   auto found = url.rfind("/");
   if (found == std::string::npos) {
@@ -75,12 +101,14 @@ Application::Application(
     fuchsia::sys::StartupInfo startup_info,
     std::shared_ptr<sys::ServiceDirectory> runner_incoming_services,
     fidl::InterfaceRequest<fuchsia::sys::ComponentController>
-        application_controller_request)
+        application_controller_request,
+    inspect::Node inspect_node)
     : termination_callback_(std::move(termination_callback)),
       debug_label_(DebugLabelForURL(startup_info.launch_info.url)),
       application_controller_(this),
       outgoing_dir_(new vfs::PseudoDir()),
       runner_incoming_services_(runner_incoming_services),
+      inspect_node_(std::move(inspect_node)),
       weak_factory_(this) {
   application_controller_.set_error_handler(
       [this](zx_status_t status) { Kill(); });
@@ -100,6 +128,17 @@ Application::Application(
     auto pg = startup_info.program_metadata->at(i);
     if (pg.key.compare(kDataKey) == 0) {
       data_path = "pkg/" + pg.value;
+    } else if (pg.key.compare(kMaxPresentsInFlightKey) == 0) {
+      if (!ParsePositiveSize(pg.value,
+                             &engine_options_.max_presents_in_flight)) {
+        FML_LOG(ERROR) << "Ignoring invalid " << kMaxPresentsInFlightKey
+                       << ": " << pg.value;
+      }
+    } else if (pg.key.compare(kLatchPointerInputKey) == 0) {
+      if (!ParseBool(pg.value, &engine_options_.latch_pointer_input)) {
+        FML_LOG(ERROR) << "Ignoring invalid " << kLatchPointerInputKey << ": "
+                       << pg.value;
+      }
     }
   }
   if (data_path.empty()) {
@@ -528,12 +567,14 @@ void Application::CreateView(
       svc_,                          // Component incoming services
       runner_incoming_services_,     // Runner incoming services
       settings_,                     // settings
+      engine_options_,               // engine options
       std::move(isolate_snapshot_),  // isolate snapshot
       scenic::ToViewToken(std::move(view_token)),  // view token
       std::move(view_ref_control),                 // view ref control
       std::move(view_ref),                         // view ref
       std::move(fdio_ns_),                         // FDIO namespace
-      std::move(directory_request_)                // outgoing request
+      std::move(directory_request_),               // outgoing request
+      inspect_node_.CreateChild(inspect::UniqueName("engine-"))  // inspect
       ));
 }
 
@@ -17,6 +17,7 @@
 #include <lib/fidl/cpp/binding_set.h>
 #include <lib/fidl/cpp/interface_request.h>
 #include <lib/fit/function.h>
+#include <lib/inspect/cpp/inspect.h>
 #include <lib/sys/cpp/service_directory.h>
 #include <lib/vfs/cpp/pseudo_dir.h>
 #include <lib/zx/eventpair.h>
@@ -45,7 +46,8 @@ class Application final : public Engine::Delegate,
   Create(TerminationCallback termination_callback,
          fuchsia::sys::Package package, fuchsia::sys::StartupInfo startup_info,
          std::shared_ptr<sys::ServiceDirectory> runner_incoming_services,
-         fidl::InterfaceRequest<fuchsia::sys::ComponentController> controller);
+         fidl::InterfaceRequest<fuchsia::sys::ComponentController> controller,
+         inspect::Node inspect_node);
 
   // Must be called on the same thread returned from the create call. The thread
   // may be collected after.
@@ -59,6 +61,7 @@ class Application final : public Engine::Delegate,
 
  private:
   flutter::Settings settings_;
+  Engine::Options engine_options_;
   TerminationCallback termination_callback_;
   const std::string debug_label_;
   UniqueFDIONS fdio_ns_ = UniqueFDIONSCreate();
@@ -72,6 +75,8 @@ class Application final : public Engine::Delegate,
   std::unique_ptr<vfs::PseudoDir> outgoing_dir_;
   std::shared_ptr<sys::ServiceDirectory> svc_;
   std::shared_ptr<sys::ServiceDirectory> runner_incoming_services_;
+  // Parent of the Inspect nodes of this application's engines.
+  inspect::Node inspect_node_;
   fidl::BindingSet<fuchsia::ui::app::ViewProvider> shells_bindings_;
 
   fml::RefPtr<flutter::DartSnapshot> isolate_snapshot_;
@@ -83,7 +88,8 @@ class Application final : public Engine::Delegate,
       TerminationCallback termination_callback, fuchsia::sys::Package package,
       fuchsia::sys::StartupInfo startup_info,
       std::shared_ptr<sys::ServiceDirectory> runner_incoming_services,
-      fidl::InterfaceRequest<fuchsia::sys::ComponentController> controller);
+      fidl::InterfaceRequest<fuchsia::sys::ComponentController> controller,
+      inspect::Node inspect_node);
 
   // |fuchsia::sys::ComponentController|
   void Kill() override;
@@ -28,10 +28,22 @@ class ScopedFrame final : public flutter::CompositorContext::ScopedFrame {
       return flutter::RasterStatus::kSuccess;
     }
 
+    FrameScheduler& frame_scheduler = session_connection_.frame_scheduler();
+    FrameTimings* frame_timings = session_connection_.frame_timings();
+    const FrameScheduler::FrameId frame_id = layer_tree.build_start();
+    const fml::TimePoint now = fml::TimePoint::Now();
+    if (frame_scheduler.OnRasterStarted(frame_id, now)) {
+      TRACE_INSTANT("flutter", "LateFrame", TRACE_SCOPE_THREAD);
+      if (frame_timings) {
+        frame_timings->RecordLateFrame();
+      }
+    }
+
     {
       // Preroll the Flutter layer tree. This allows Flutter to perform
       // pre-paint optimizations.
       TRACE_DURATION("flutter", "Preroll");
+      FrameTimings::ScopedPhase phase(frame_timings, FramePhase::kPreroll);
       layer_tree.Preroll(*this, true /* ignore raster cache */);
     }
 
@@ -39,6 +51,7 @@ class ScopedFrame final : public flutter::CompositorContext::ScopedFrame {
       // Traverse the Flutter layer tree so that the necessary session ops to
       // represent the frame are enqueued in the underlying session.
       TRACE_DURATION("flutter", "UpdateScene");
+      FrameTimings::ScopedPhase phase(frame_timings, FramePhase::kUpdateScene);
       layer_tree.UpdateScene(session_connection_.scene_update_context(),
                              session_connection_.root_node());
     }
@@ -46,9 +59,13 @@ class ScopedFrame final : public flutter::CompositorContext::ScopedFrame {
     {
       // Flush all pending session ops.
       TRACE_DURATION("flutter", "SessionPresent");
-      session_connection_.Present(*this);
+      FrameTimings::ScopedPhase phase(frame_timings,
+                                     FramePhase::kSessionPresent);
+      session_connection_.Present(*this, frame_id);
     }
 
+    frame_scheduler.OnRasterFinished(frame_id, fml::TimePoint::Now());
+
     return flutter::RasterStatus::kSuccess;
   }
 
@@ -58,11 +75,17 @@ class ScopedFrame final : public flutter::CompositorContext::ScopedFrame {
 CompositorContext::CompositorContext(
     std::string debug_label, fuchsia::ui::views::ViewToken view_token,
     fidl::InterfaceHandle<fuchsia::ui::scenic::Session> session,
-    fml::closure session_error_callback, zx_handle_t vsync_event_handle)
+    fml::closure session_error_callback, zx_handle_t vsync_event_handle,
+    std::shared_ptr<VsyncRecorder> vsync_recorder,
+    std::shared_ptr<FrameScheduler> frame_scheduler,
+    std::shared_ptr<FrameTimings> frame_timings,
+    size_t max_presents_in_flight)
     : debug_label_(std::move(debug_label)),
       session_connection_(debug_label_, std::move(view_token),
                           std::move(session), session_error_callback,
-                          vsync_event_handle) {}
+                          vsync_event_handle, std::move(vsync_recorder),
+                          std::move(frame_scheduler), std::move(frame_timings),
+                          max_presents_in_flight) {}
 
 void CompositorContext::OnSessionMetricsDidChange(
     const fuchsia::ui::gfx::Metrics& metrics) {
@@ -24,7 +24,11 @@ class CompositorContext final : public flutter::CompositorContext {
                     fuchsia::ui::views::ViewToken view_token,
                     fidl::InterfaceHandle<fuchsia::ui::scenic::Session> session,
                     fml::closure session_error_callback,
-                    zx_handle_t vsync_event_handle);
+                    zx_handle_t vsync_event_handle,
+                    std::shared_ptr<VsyncRecorder> vsync_recorder,
+                    std::shared_ptr<FrameScheduler> frame_scheduler,
+                    std::shared_ptr<FrameTimings> frame_timings,
+                    size_t max_presents_in_flight);
 
   ~CompositorContext() override;
 
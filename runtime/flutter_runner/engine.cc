@@ -43,12 +43,13 @@ static void UpdateNativeThreadLabelNames(const std::string& label,
 Engine::Engine(Delegate& delegate, std::string thread_label,
                std::shared_ptr<sys::ServiceDirectory> svc,
                std::shared_ptr<sys::ServiceDirectory> runner_services,
-               flutter::Settings settings,
+               flutter::Settings settings, Options options,
                fml::RefPtr<const flutter::DartSnapshot> isolate_snapshot,
                fuchsia::ui::views::ViewToken view_token,
                fuchsia::ui::views::ViewRefControl view_ref_control,
                fuchsia::ui::views::ViewRef view_ref, UniqueFDIONS fdio_ns,
-               fidl::InterfaceRequest<fuchsia::io::Directory> directory_request)
+               fidl::InterfaceRequest<fuchsia::io::Directory> directory_request,
+               inspect::Node inspect_node)
     : delegate_(delegate),
       thread_label_(std::move(thread_label)),
       settings_(std::move(settings)),
@@ -57,6 +58,9 @@ Engine::Engine(Delegate& delegate, std::string thread_label,
     FML_DLOG(ERROR) << "Could not create the vsync event.";
     return;
   }
+  vsync_recorder_ = std::make_shared<VsyncRecorder>();
+  frame_scheduler_ = std::make_shared<FrameScheduler>();
+  frame_timings_ = std::make_shared<FrameTimings>(std::move(inspect_node));
 
   // Launch the threads that will be used to run the shell. These threads will
   // be joined in the destructor.
@@ -122,7 +126,11 @@ Engine::Engine(Delegate& delegate, std::string thread_label,
                std::move(on_session_size_change_hint_callback),
            on_enable_wireframe_callback =
                std::move(on_enable_wireframe_callback),
-           vsync_handle = vsync_event_.get()](flutter::Shell& shell) mutable {
+           vsync_handle = vsync_event_.get(),
+           vsync_recorder = vsync_recorder_,
+           frame_scheduler = frame_scheduler_,
+           latch_pointer_input =
+               options.latch_pointer_input](flutter::Shell& shell) mutable {
             return std::make_unique<flutter_runner::PlatformView>(
                 shell,                        // delegate
                 debug_label,                  // debug label
@@ -136,7 +144,11 @@ Engine::Engine(Delegate& delegate, std::string thread_label,
                 std::move(on_session_metrics_change_callback),
                 std::move(on_session_size_change_hint_callback),
                 std::move(on_enable_wireframe_callback),
-                vsync_handle  // vsync handle
+                vsync_handle,         // vsync handle
+                vsync_recorder,       // vsync recorder
+                frame_scheduler,      // frame scheduler
+                latch_pointer_input,  // latch pointer input
+                false                 // merge pointer moves
             );
           });
 
@@ -172,7 +184,11 @@ Engine::Engine(Delegate& delegate, std::string thread_label,
                          view_token = std::move(view_token),  //
                          session = std::move(session),        //
                          on_session_error_callback,           //
-                         vsync_event = vsync_event_.get()     //
+                         vsync_event = vsync_event_.get(),    //
+                         vsync_recorder = vsync_recorder_,    //
+                         frame_scheduler = frame_scheduler_,  //
+                         frame_timings = frame_timings_,      //
+                         options                              //
   ](flutter::Shell& shell) mutable {
         std::unique_ptr<flutter_runner::CompositorContext> compositor_context;
         {
@@ -183,7 +199,11 @@ Engine::Engine(Delegate& delegate, std::string thread_label,
                   std::move(view_token),  // scenic view we attach our tree to
                   std::move(session),     // scenic session
                   on_session_error_callback,  // session did encounter error
-                  vsync_event                 // vsync event handle
+                  vsync_event,                // vsync event handle
+                  vsync_recorder,             // vsync recorder
+                  frame_scheduler,            // frame scheduler
+                  frame_timings,              // raster phase timings
+                  options.max_presents_in_flight  // presents in flight
               );
         }
 
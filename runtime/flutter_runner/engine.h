@@ -9,13 +9,18 @@
 #include <fuchsia/ui/gfx/cpp/fidl.h>
 #include <fuchsia/ui/views/cpp/fidl.h>
 #include <lib/async-loop/cpp/loop.h>
+#include <lib/inspect/cpp/inspect.h>
 #include <lib/sys/cpp/service_directory.h>
 #include <lib/zx/event.h>
 
 #include "flutter/fml/macros.h"
 #include "flutter/shell/common/shell.h"
+#include "frame_scheduler.h"
+#include "frame_timings.h"
 #include "isolate_configurator.h"
+#include "present_throttle.h"
 #include "thread.h"
+#include "vsync_recorder.h"
 
 namespace flutter_runner {
 
@@ -28,15 +33,26 @@ class Engine final {
     virtual void OnEngineTerminate(const Engine* holder) = 0;
   };
 
+  // Options a component sets in the "program" block of its manifest.
+  struct Options {
+    // See |PresentThrottle|.
+    size_t max_presents_in_flight =
+        PresentThrottle::kDefaultMaxPresentsInFlight;
+    // Whether pointer moves are held back until just before the next frame.
+    // See |PointerLatch|.
+    bool latch_pointer_input = false;
+  };
+
   Engine(Delegate& delegate, std::string thread_label,
          std::shared_ptr<sys::ServiceDirectory> svc,
          std::shared_ptr<sys::ServiceDirectory> runner_services,
-         flutter::Settings settings,
+         flutter::Settings settings, Options options,
          fml::RefPtr<const flutter::DartSnapshot> isolate_snapshot,
          fuchsia::ui::views::ViewToken view_token,
          fuchsia::ui::views::ViewRefControl view_ref_control,
          fuchsia::ui::views::ViewRef view_ref, UniqueFDIONS fdio_ns,
-         fidl::InterfaceRequest<fuchsia::io::Directory> directory_request);
+         fidl::InterfaceRequest<fuchsia::io::Directory> directory_request,
+         inspect::Node inspect_node);
   ~Engine();
 
   // Returns the Dart return code for the root isolate if one is present. This
@@ -55,6 +71,13 @@ class Engine final {
   std::unique_ptr<IsolateConfigurator> isolate_configurator_;
   std::unique_ptr<flutter::Shell> shell_;
   zx::event vsync_event_;
+  // Shared by the vsync waiter and the session connection of this engine.
+  std::shared_ptr<VsyncRecorder> vsync_recorder_;
+  // Shared by the vsync waiter, the platform view and the session connection
+  // of this engine.
+  std::shared_ptr<FrameScheduler> frame_scheduler_;
+  // Raster phase timings of this engine, published through Inspect.
+  std::shared_ptr<FrameTimings> frame_timings_;
   fml::WeakPtrFactory<Engine> weak_factory_;
 
   void OnMainIsolateStart();
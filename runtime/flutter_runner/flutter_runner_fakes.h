@@ -7,6 +7,15 @@
 
 #include <fuchsia/accessibility/cpp/fidl.h>
 #include <fuchsia/accessibility/semantics/cpp/fidl.h>
+#include <fuchsia/ui/scenic/cpp/fidl.h>
+#include <lib/fidl/cpp/binding.h>
+#include <lib/fidl/cpp/binding_set.h>
+#include <lib/zx/time.h>
+
+#include <string>
+#include <vector>
+
+#include "accessibility_bridge.h"
 
 namespace flutter_runner_test {
 using fuchsia::accessibility::semantics::SemanticsManager;
@@ -141,6 +150,83 @@ class MockAccessibilitySettingsManager : public AccessibilitySettingsManager {
   fidl::BindingSet<AccessibilitySettingsManager> bindings_;
 };
 
+// Stands in for a Scenic session, recording what it is sent.
+class FakeScenicSession : public fuchsia::ui::scenic::Session {
+ public:
+  FakeScenicSession() : binding_(this) {}
+
+  fidl::InterfaceHandle<fuchsia::ui::scenic::Session> NewBinding(
+      async_dispatcher_t* dispatcher) {
+    return binding_.NewBinding(dispatcher);
+  }
+
+  // Whether messages have been sent that this has not served yet.
+  bool HasPendingMessages() const {
+    return binding_.channel().wait_one(ZX_CHANNEL_READABLE, zx::time(),
+                                       nullptr) == ZX_OK;
+  }
+
+  // The names of the methods called, in order.
+  const std::vector<std::string>& Calls() const { return calls_; }
+
+  // The commands enqueued before each |Present|.
+  const std::vector<std::vector<fuchsia::ui::scenic::Command>>& Frames()
+      const {
+    return frames_;
+  }
+
+  std::vector<std::vector<fuchsia::ui::scenic::Command>> TakeFrames() {
+    return std::move(frames_);
+  }
+
+  // |fuchsia::ui::scenic::Session|
+  void Enqueue(std::vector<fuchsia::ui::scenic::Command> cmds) override {
+    calls_.push_back("Enqueue");
+    for (auto& command : cmds) {
+      pending_.push_back(std::move(command));
+    }
+  }
+
+  // |fuchsia::ui::scenic::Session|
+  void Present(uint64_t presentation_time,
+               std::vector<zx::event> acquire_fences,
+               std::vector<zx::event> release_fences,
+               PresentCallback callback) override {
+    calls_.push_back("Present");
+    frames_.push_back(std::move(pending_));
+    pending_.clear();
+    callback({.presentation_time = presentation_time,
+              .presentation_interval = 16666667});
+  }
+
+  // |fuchsia::ui::scenic::Session|
+  void HitTest(uint32_t node_id, fuchsia::ui::gfx::vec3 ray_origin,
+               fuchsia::ui::gfx::vec3 ray_direction,
+               HitTestCallback callback) override {
+    calls_.push_back("HitTest");
+    callback({});
+  }
+
+  // |fuchsia::ui::scenic::Session|
+  void HitTestDeviceRay(fuchsia::ui::gfx::vec3 ray_origin,
+                        fuchsia::ui::gfx::vec3 ray_direction,
+                        HitTestDeviceRayCallback callback) override {
+    calls_.push_back("HitTestDeviceRay");
+    callback({});
+  }
+
+  // |fuchsia::ui::scenic::Session|
+  void SetDebugName(std::string debug_name) override {
+    calls_.push_back("SetDebugName");
+  }
+
+ private:
+  fidl::Binding<fuchsia::ui::scenic::Session> binding_;
+  std::vector<std::string> calls_;
+  std::vector<fuchsia::ui::scenic::Command> pending_;
+  std::vector<std::vector<fuchsia::ui::scenic::Command>> frames_;
+};
+
 }  // namespace flutter_runner_test
 
 #endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_PLATFORM_VIEW_FAKES_H_
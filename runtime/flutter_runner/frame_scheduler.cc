@@ -0,0 +1,195 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/frame_scheduler.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace flutter_runner {
+
+namespace {
+
+fml::TimePoint SnapToNextPhase(fml::TimePoint value, fml::TimePoint phase,
+                               fml::TimeDelta interval) {
+  fml::TimeDelta offset = (phase - value) % interval;
+  if (offset < fml::TimeDelta::Zero()) {
+    offset = offset + interval;
+  }
+  return value + offset;
+}
+
+fml::TimeDelta Percentile(const std::deque<fml::TimeDelta>& history,
+                          double percentile) {
+  std::vector<fml::TimeDelta> sorted(history.begin(), history.end());
+  auto nth = sorted.begin() + static_cast<size_t>(percentile *
+                                                  (sorted.size() - 1));
+  std::nth_element(sorted.begin(), nth, sorted.end());
+  return *nth;
+}
+
+template <typename T>
+void PushBounded(std::deque<T>& queue, T value) {
+  if (queue.size() >= FrameScheduler::kHistorySize) {
+    queue.pop_front();
+  }
+  queue.push_back(std::move(value));
+}
+
+}  // namespace
+
+FrameScheduler::FrameScheduler() = default;
+
+FrameScheduler::~FrameScheduler() = default;
+
+void FrameScheduler::set_safety_margin(fml::TimeDelta safety_margin) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  safety_margin_ = safety_margin;
+}
+
+FrameScheduler::FrameTimes FrameScheduler::GetNextFrameTimes(
+    fml::TimePoint now, fml::TimePoint vsync_phase,
+    fml::TimeDelta vsync_interval) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return GetNextFrameTimesLocked(now, vsync_phase, vsync_interval);
+}
+
+FrameScheduler::FrameTimes FrameScheduler::GetStartFrameTimes(
+    const FrameTimes& planned, fml::TimePoint now, fml::TimePoint vsync_phase,
+    fml::TimeDelta vsync_interval) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (now <= planned.wakeup_time + safety_margin_ &&
+      planned.target_time > last_target_time_) {
+    return planned;
+  }
+  return GetNextFrameTimesLocked(now, vsync_phase, vsync_interval);
+}
+
+void FrameScheduler::OnFrameStarted(FrameId id, fml::TimePoint now,
+                                    fml::TimePoint target_time) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Frame& frame = frames_[id];
+  frame = Frame();
+  frame.start_time = now;
+  frame.target_time = target_time;
+  last_target_time_ = std::max(last_target_time_, target_time);
+  // Frames are normally forgotten once shown, so this only trims frames
+  // whose presentation was never reported.
+  while (frames_.size() > kHistorySize) {
+    frames_.erase(frames_.begin());
+  }
+}
+
+bool FrameScheduler::OnRasterStarted(FrameId id, fml::TimePoint now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = frames_.find(id);
+  if (it == frames_.end() || it->second.stage != Stage::kBuilding) {
+    return false;
+  }
+  // Older frames that never got to the raster thread were dropped by the
+  // engine.
+  for (auto older = frames_.begin(); older != it;) {
+    if (older->second.stage == Stage::kBuilding) {
+      older = frames_.erase(older);
+    } else {
+      ++older;
+    }
+  }
+  Frame& frame = it->second;
+  frame.stage = Stage::kRasterizing;
+  frame.raster_start_time = now;
+  PushBounded(build_durations_, now - frame.start_time);
+  if (raster_durations_.empty() || latch_leads_.empty()) {
+    return false;
+  }
+  const fml::TimePoint ready_time =
+      now + Percentile(raster_durations_, kPercentile) +
+      *std::min_element(latch_leads_.begin(), latch_leads_.end());
+  if (ready_time <= frame.target_time) {
+    return false;
+  }
+  stats_.late_frames++;
+  return true;
+}
+
+void FrameScheduler::OnRasterFinished(FrameId id, fml::TimePoint now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Frame* frame = FindFrame(id, Stage::kRasterizing);
+  if (!frame) {
+    return;
+  }
+  frame->stage = Stage::kPresenting;
+  frame->raster_finish_time = now;
+  PushBounded(raster_durations_, now - frame->raster_start_time);
+}
+
+void FrameScheduler::OnFramePresented(FrameId id,
+                                      fml::TimePoint presentation_time,
+                                      fml::TimeDelta vsync_interval) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Frame* frame = FindFrame(id, Stage::kPresenting);
+  if (!frame) {
+    return;
+  }
+  if (presentation_time > frame->raster_finish_time) {
+    PushBounded(latch_leads_, presentation_time - frame->raster_finish_time);
+  }
+  stats_.frames_presented++;
+  if (presentation_time > frame->target_time + vsync_interval / 2) {
+    stats_.missed_deadlines++;
+  }
+  frames_.erase(id);
+}
+
+FrameScheduler::Stats FrameScheduler::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+fml::TimeDelta FrameScheduler::PredictLeadTimeLocked() const {
+  if (build_durations_.empty() || raster_durations_.empty() ||
+      latch_leads_.empty()) {
+    return fml::TimeDelta::Zero();
+  }
+  return Percentile(build_durations_, kPercentile) +
+         Percentile(raster_durations_, kPercentile) +
+         *std::min_element(latch_leads_.begin(), latch_leads_.end()) +
+         safety_margin_;
+}
+
+FrameScheduler::FrameTimes FrameScheduler::GetNextFrameTimesLocked(
+    fml::TimePoint now, fml::TimePoint vsync_phase,
+    fml::TimeDelta vsync_interval) const {
+  const fml::TimeDelta lead_time = PredictLeadTimeLocked();
+  FrameTimes times;
+  if (lead_time == fml::TimeDelta::Zero()) {
+    fml::TimePoint next_vsync =
+        SnapToNextPhase(now, vsync_phase, vsync_interval);
+    times = {next_vsync, next_vsync + vsync_interval};
+  } else {
+    fml::TimePoint target_time =
+        SnapToNextPhase(now + lead_time, vsync_phase, vsync_interval);
+    times = {target_time - lead_time, target_time};
+  }
+  // A vsync an earlier frame already targets can only show one of them.
+  if (times.target_time <= last_target_time_) {
+    const fml::TimeDelta delay =
+        SnapToNextPhase(last_target_time_ + vsync_interval / 2, vsync_phase,
+                        vsync_interval) -
+        times.target_time;
+    times.wakeup_time = times.wakeup_time + delay;
+    times.target_time = times.target_time + delay;
+  }
+  return times;
+}
+
+FrameScheduler::Frame* FrameScheduler::FindFrame(FrameId id, Stage stage) {
+  auto it = frames_.find(id);
+  if (it == frames_.end() || it->second.stage != stage) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+}  // namespace flutter_runner
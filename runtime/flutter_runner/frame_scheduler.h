@@ -0,0 +1,151 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_FRAME_SCHEDULER_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_FRAME_SCHEDULER_H_
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <mutex>
+
+#include "flutter/fml/macros.h"
+#include "flutter/fml/time/time_delta.h"
+#include "flutter/fml/time/time_point.h"
+
+namespace flutter_runner {
+
+// Chooses when |VsyncWaiter| starts a frame, from how long recent frames took.
+//
+// A frame is built on the UI thread, rasterized and presented on the raster
+// thread, and then shown at the first vsync Scenic can latch it for.  The
+// scheduler keeps a rolling history of the build and raster durations and of
+// how long before the vsync Scenic needed the frame, and wakes the UI thread
+// as late as it can while still making the earliest vsync that the predicted
+// work allows, with a safety margin.  Until there is history, frames start
+// at the next vsync and target the one after, as they used to.
+//
+// A frame is identified by the frame start time |VsyncWaiter| hands the
+// engine for it, which comes back to the raster thread as the layer tree's
+// |build_start|.  Targets only move forward, so no two frames share an id.
+// A frame the engine drops before rasterizing it is forgotten once a newer
+// frame starts rasterizing.
+//
+// Frames that reach the raster thread too late to make their target vsync
+// are counted, so that falling behind on the raster thread can be told apart
+// from frames that were slow to build.  See |OnRasterStarted|.
+//
+// Each engine has its own scheduler.  All methods are safe to call from any
+// thread.
+class FrameScheduler final {
+ public:
+  // See the class comment.
+  using FrameId = fml::TimePoint;
+
+  struct FrameTimes {
+    // When to start building the frame.
+    fml::TimePoint wakeup_time;
+    // The vsync the frame is meant to be shown at.
+    fml::TimePoint target_time;
+  };
+
+  struct Stats {
+    size_t frames_presented = 0;
+    // Frames shown at a later vsync than they were meant for.
+    size_t missed_deadlines = 0;
+    // Frames predicted to miss their vsync when they started rasterizing.
+    size_t late_frames = 0;
+  };
+
+  // Number of frames whose durations feed the predictions.
+  static constexpr size_t kHistorySize = 32;
+  // Durations are predicted by this percentile of the history.
+  static constexpr double kPercentile = 0.9;
+  static constexpr fml::TimeDelta kDefaultSafetyMargin =
+      fml::TimeDelta::FromMilliseconds(1);
+
+  FrameScheduler();
+
+  ~FrameScheduler();
+
+  void set_safety_margin(fml::TimeDelta safety_margin);
+
+  // The frame times for a frame requested at |now|, given the vsync grid
+  // described by |vsync_phase| and |vsync_interval|.  The target is always
+  // later than that of the last frame started.
+  FrameTimes GetNextFrameTimes(fml::TimePoint now, fml::TimePoint vsync_phase,
+                               fml::TimeDelta vsync_interval) const;
+
+  // The frame times for a frame planned as |planned| that is about to start
+  // at |now|.  These are |planned| unless the frame starts later than
+  // planned by more than the safety margin, in which case it targets the
+  // earliest vsync still reachable from |now|.
+  FrameTimes GetStartFrameTimes(const FrameTimes& planned, fml::TimePoint now,
+                                fml::TimePoint vsync_phase,
+                                fml::TimeDelta vsync_interval) const;
+
+  // Frame |id|, targeting |target_time|, started building at |now|.
+  void OnFrameStarted(FrameId id, fml::TimePoint now,
+                      fml::TimePoint target_time);
+
+  // Frame |id| started rasterizing at |now|.  Returns whether the predicted
+  // raster time and latch lead put it past its target vsync.
+  bool OnRasterStarted(FrameId id, fml::TimePoint now);
+
+  // Frame |id| was presented and its paint tasks submitted at |now|.
+  void OnRasterFinished(FrameId id, fml::TimePoint now);
+
+  // Scenic reported that frame |id| was shown at |presentation_time| on a
+  // display refreshing every |vsync_interval|.
+  void OnFramePresented(FrameId id, fml::TimePoint presentation_time,
+                        fml::TimeDelta vsync_interval);
+
+  Stats GetStats() const;
+
+ private:
+  enum class Stage {
+    kBuilding,
+    kRasterizing,
+    kPresenting,
+  };
+
+  struct Frame {
+    Stage stage = Stage::kBuilding;
+    fml::TimePoint start_time;
+    fml::TimePoint target_time;
+    fml::TimePoint raster_start_time;
+    fml::TimePoint raster_finish_time;
+  };
+
+  // The time to leave between waking up and the target vsync, or zero if
+  // there is no history yet.  |mutex_| must be held.
+  fml::TimeDelta PredictLeadTimeLocked() const;
+
+  // |GetNextFrameTimes| with |mutex_| held.
+  FrameTimes GetNextFrameTimesLocked(fml::TimePoint now,
+                                     fml::TimePoint vsync_phase,
+                                     fml::TimeDelta vsync_interval) const;
+
+  // Returns frame |id| if it is at |stage|, or null.
+  Frame* FindFrame(FrameId id, Stage stage);
+
+  mutable std::mutex mutex_;
+  fml::TimeDelta safety_margin_ = kDefaultSafetyMargin;
+  std::deque<fml::TimeDelta> build_durations_;
+  std::deque<fml::TimeDelta> raster_durations_;
+  // How long before being shown each frame was ready.  The smallest of these
+  // bounds how early Scenic needs a frame to latch it for a vsync.
+  std::deque<fml::TimeDelta> latch_leads_;
+  // Frames started and not yet shown or dropped, by id.
+  std::map<FrameId, Frame> frames_;
+  // The target of the last frame started.
+  fml::TimePoint last_target_time_;
+  Stats stats_;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(FrameScheduler);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_FRAME_SCHEDULER_H_
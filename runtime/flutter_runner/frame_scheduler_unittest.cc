@@ -0,0 +1,216 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/frame_scheduler.h"
+
+#include <gtest/gtest.h>
+
+namespace flutter_runner_test {
+
+using flutter_runner::FrameScheduler;
+
+namespace {
+
+constexpr fml::TimeDelta kInterval = fml::TimeDelta::FromMilliseconds(16);
+
+fml::TimePoint Ms(int64_t milliseconds) {
+  return fml::TimePoint::FromEpochDelta(
+      fml::TimeDelta::FromMilliseconds(milliseconds));
+}
+
+fml::TimeDelta MsDelta(int64_t milliseconds) {
+  return fml::TimeDelta::FromMilliseconds(milliseconds);
+}
+
+// Runs a frame through every stage, starting at |start| and taking |build|
+// and |raster| milliseconds.  Scenic shows it at the first vsync at least
+// |latch| milliseconds after it is ready, on a grid starting at 0ms.  The
+// frame is identified by its start time.
+void RunFrame(FrameScheduler& scheduler, int64_t start, int64_t target,
+              int64_t build, int64_t raster, int64_t latch) {
+  scheduler.OnFrameStarted(Ms(start), Ms(start), Ms(target));
+  scheduler.OnRasterStarted(Ms(start), Ms(start + build));
+  scheduler.OnRasterFinished(Ms(start), Ms(start + build + raster));
+  int64_t ready = start + build + raster + latch;
+  int64_t shown = (ready + 15) / 16 * 16;
+  scheduler.OnFramePresented(Ms(start), Ms(shown), kInterval);
+}
+
+}  // namespace
+
+TEST(FrameSchedulerTest, WithoutHistoryStartsAtNextVsync) {
+  FrameScheduler scheduler;
+  auto times = scheduler.GetNextFrameTimes(Ms(20), Ms(0), kInterval);
+  EXPECT_EQ(times.wakeup_time, Ms(32));
+  EXPECT_EQ(times.target_time, Ms(48));
+}
+
+TEST(FrameSchedulerTest, WakesAsLateAsPredictedWorkAllows) {
+  FrameScheduler scheduler;
+  scheduler.set_safety_margin(MsDelta(1));
+  // Frames take 3ms to build, 4ms to raster, and are ready 2ms before the
+  // vsync Scenic shows them at.
+  for (int i = 0; i < 10; i++) {
+    int64_t start = 103 + i * 16;
+    RunFrame(scheduler, start, start + 32, 3, 4, 2);
+  }
+
+  // The lead time is 3 + 4 + 2 + 1 = 10ms, so at 340ms the earliest
+  // reachable vsync is 352ms, and the frame starts at 342ms.
+  auto times = scheduler.GetNextFrameTimes(Ms(340), Ms(0), kInterval);
+  EXPECT_EQ(times.target_time, Ms(352));
+  EXPECT_EQ(times.wakeup_time, Ms(342));
+
+  // Too late for 352ms, so aim for 368ms.
+  times = scheduler.GetNextFrameTimes(Ms(345), Ms(0), kInterval);
+  EXPECT_EQ(times.target_time, Ms(368));
+  EXPECT_EQ(times.wakeup_time, Ms(358));
+}
+
+TEST(FrameSchedulerTest, OutliersBeyondPercentileAreIgnored) {
+  FrameScheduler scheduler;
+  scheduler.set_safety_margin(fml::TimeDelta::Zero());
+  for (int i = 0; i < 20; i++) {
+    RunFrame(scheduler, i * 16, i * 16 + 16, 2, 2, 2);
+  }
+  // One slow frame in 21 stays above the 90th percentile.
+  RunFrame(scheduler, 400, 416, 2, 12, 2);
+
+  auto times = scheduler.GetNextFrameTimes(Ms(1000), Ms(0), kInterval);
+  EXPECT_EQ(times.target_time - times.wakeup_time, MsDelta(6));
+}
+
+TEST(FrameSchedulerTest, NeverTargetsAVsyncAlreadyTargeted) {
+  FrameScheduler scheduler;
+  scheduler.OnFrameStarted(Ms(32), Ms(32), Ms(48));
+
+  // Requested at 20ms, the frame would aim for 48ms like the one started.
+  auto times = scheduler.GetNextFrameTimes(Ms(20), Ms(0), kInterval);
+  EXPECT_EQ(times.wakeup_time, Ms(48));
+  EXPECT_EQ(times.target_time, Ms(64));
+}
+
+TEST(FrameSchedulerTest, KeepsPlannedTimesWhenStartedOnTime) {
+  FrameScheduler scheduler;
+  scheduler.set_safety_margin(MsDelta(1));
+  for (int i = 0; i < 10; i++) {
+    int64_t start = 103 + i * 16;
+    RunFrame(scheduler, start, start + 32, 3, 4, 2);
+  }
+  auto planned = scheduler.GetNextFrameTimes(Ms(340), Ms(0), kInterval);
+  ASSERT_EQ(planned.wakeup_time, Ms(342));
+  ASSERT_EQ(planned.target_time, Ms(352));
+
+  // Woken a little late by the timer, the frame keeps its vsync, though
+  // asking again now would aim for 368ms.
+  auto times =
+      scheduler.GetStartFrameTimes(planned, Ms(343), Ms(0), kInterval);
+  EXPECT_EQ(times.target_time, Ms(352));
+}
+
+TEST(FrameSchedulerTest, KeepsPlannedTimesWithoutHistory) {
+  FrameScheduler scheduler;
+  auto planned = scheduler.GetNextFrameTimes(Ms(20), Ms(0), kInterval);
+  ASSERT_EQ(planned.wakeup_time, Ms(32));
+  ASSERT_EQ(planned.target_time, Ms(48));
+
+  // Asking again at 33ms would aim for 64ms: the vsync after the next one,
+  // counting from the wakeup rather than from the request.
+  auto times =
+      scheduler.GetStartFrameTimes(planned, Ms(33), Ms(0), kInterval);
+  EXPECT_EQ(times.target_time, Ms(48));
+}
+
+TEST(FrameSchedulerTest, RetargetsFramesStartedLate) {
+  FrameScheduler scheduler;
+  scheduler.set_safety_margin(MsDelta(1));
+  for (int i = 0; i < 10; i++) {
+    int64_t start = 103 + i * 16;
+    RunFrame(scheduler, start, start + 32, 3, 4, 2);
+  }
+  auto planned = scheduler.GetNextFrameTimes(Ms(340), Ms(0), kInterval);
+  ASSERT_EQ(planned.target_time, Ms(352));
+
+  // Waiting for the session held the frame until 346ms, too late for
+  // 352ms.
+  auto times =
+      scheduler.GetStartFrameTimes(planned, Ms(346), Ms(0), kInterval);
+  EXPECT_EQ(times.target_time, Ms(368));
+  EXPECT_EQ(times.wakeup_time, Ms(358));
+}
+
+TEST(FrameSchedulerTest, MatchesFramesById) {
+  FrameScheduler scheduler;
+  // The frame started at 0ms is dropped by the engine; the one started at
+  // 16ms is rasterized and presented.
+  scheduler.OnFrameStarted(Ms(0), Ms(0), Ms(16));
+  scheduler.OnFrameStarted(Ms(16), Ms(16), Ms(32));
+  scheduler.OnRasterStarted(Ms(16), Ms(20));
+  scheduler.OnRasterFinished(Ms(16), Ms(24));
+  scheduler.OnFramePresented(Ms(16), Ms(32), kInterval);
+
+  // The dropped frame is forgotten rather than taking the next frame's
+  // place.
+  scheduler.OnRasterStarted(Ms(0), Ms(40));
+  scheduler.OnRasterFinished(Ms(0), Ms(41));
+  scheduler.OnFramePresented(Ms(0), Ms(48), kInterval);
+
+  auto stats = scheduler.GetStats();
+  EXPECT_EQ(stats.frames_presented, 1u);
+  EXPECT_EQ(stats.missed_deadlines, 0u);
+
+  // The presented frame alone makes up the history: 4ms to build, 4ms to
+  // raster and ready 8ms before its vsync, plus the default 1ms margin.
+  auto times = scheduler.GetNextFrameTimes(Ms(100), Ms(0), kInterval);
+  EXPECT_EQ(times.target_time - times.wakeup_time, MsDelta(17));
+}
+
+TEST(FrameSchedulerTest, CountsMissedDeadlines) {
+  FrameScheduler scheduler;
+  // Shown at 16ms, as targeted.
+  RunFrame(scheduler, 0, 16, 3, 4, 2);
+  // Ready at 25ms and shown at 32ms, one vsync after its target.
+  RunFrame(scheduler, 16, 16, 3, 4, 2);
+
+  auto stats = scheduler.GetStats();
+  EXPECT_EQ(stats.frames_presented, 2u);
+  EXPECT_EQ(stats.missed_deadlines, 1u);
+}
+
+TEST(FrameSchedulerTest, CountsFramesLateToTheRasterThread) {
+  FrameScheduler scheduler;
+  // Frames take 4ms to raster and must be ready 2ms before their vsync.
+  RunFrame(scheduler, 7, 16, 3, 4, 2);
+
+  // Ready by 24 + 4 + 2 = 30ms, in time for 32ms.
+  scheduler.OnFrameStarted(Ms(16), Ms(16), Ms(32));
+  EXPECT_FALSE(scheduler.OnRasterStarted(Ms(16), Ms(24)));
+  scheduler.OnRasterFinished(Ms(16), Ms(28));
+  scheduler.OnFramePresented(Ms(16), Ms(32), kInterval);
+
+  // A hitch: the frame targeting 48ms only gets to the raster thread at
+  // 46ms.  It is still rasterized and shown, a vsync late.
+  scheduler.OnFrameStarted(Ms(32), Ms(32), Ms(48));
+  EXPECT_TRUE(scheduler.OnRasterStarted(Ms(32), Ms(46)));
+  scheduler.OnRasterFinished(Ms(32), Ms(50));
+  scheduler.OnFramePresented(Ms(32), Ms(64), kInterval);
+
+  auto stats = scheduler.GetStats();
+  EXPECT_EQ(stats.late_frames, 1u);
+  EXPECT_EQ(stats.frames_presented, 3u);
+  EXPECT_EQ(stats.missed_deadlines, 1u);
+}
+
+TEST(FrameSchedulerTest, UnmatchedEventsAreIgnored) {
+  FrameScheduler scheduler;
+  scheduler.OnRasterStarted(Ms(0), Ms(5));
+  scheduler.OnRasterFinished(Ms(0), Ms(6));
+  scheduler.OnFramePresented(Ms(0), Ms(16), kInterval);
+  EXPECT_EQ(scheduler.GetStats().frames_presented, 0u);
+
+  auto times = scheduler.GetNextFrameTimes(Ms(20), Ms(0), kInterval);
+  EXPECT_EQ(times.wakeup_time, Ms(32));
+}
+
+}  // namespace flutter_runner_test
@@ -0,0 +1,94 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/frame_timings.h"
+
+#include <string>
+
+namespace flutter_runner {
+
+namespace {
+
+const char* PhaseName(FramePhase phase) {
+  switch (phase) {
+    case FramePhase::kPreroll:
+      return "Preroll";
+    case FramePhase::kUpdateScene:
+      return "UpdateScene";
+    case FramePhase::kSessionPresent:
+      return "SessionPresent";
+    case FramePhase::kExecutePaintTasks:
+      return "ExecutePaintTasks";
+    case FramePhase::kGrContextFlush:
+      return "GrContextFlush";
+    case FramePhase::kSurfaceAcquire:
+      return "SurfaceAcquire";
+    case FramePhase::kSceneCommandProxy:
+      return "SceneCommandProxy";
+  }
+  return "Unknown";
+}
+
+}  // namespace
+
+FrameTimings::ScopedPhase::ScopedPhase(FrameTimings* timings, FramePhase phase)
+    : timings_(timings), phase_(phase), start_(fml::TimePoint::Now()) {}
+
+FrameTimings::ScopedPhase::~ScopedPhase() {
+  if (timings_) {
+    timings_->Record(phase_, fml::TimePoint::Now() - start_);
+  }
+}
+
+FrameTimings::FrameTimings(inspect::Node node) : node_(std::move(node)) {
+  for (size_t i = 0; i < kFramePhaseCount; i++) {
+    histograms_[i] = node_.CreateExponentialUintHistogram(
+        std::string(PhaseName(static_cast<FramePhase>(i))) + "Micros",
+        0,                   // floor
+        kInitialStepMicros,  // initial step
+        kStepMultiplier,     // step multiplier
+        kBucketCount         // buckets
+    );
+  }
+  frames_ = node_.CreateUint("Frames", 0);
+  late_frames_ = node_.CreateUint("LateFrames", 0);
+  paint_tasks_ = node_.CreateLinearUintHistogram(
+      "PaintTasksPerFrame",
+      0,                     // floor
+      kPaintTaskStep,        // step size
+      kPaintTaskBucketCount  // buckets
+  );
+  paint_task_micros_ = node_.CreateExponentialUintHistogram(
+      "PaintTaskMicros",
+      0,                   // floor
+      kInitialStepMicros,  // initial step
+      kStepMultiplier,     // step multiplier
+      kBucketCount         // buckets
+  );
+}
+
+FrameTimings::~FrameTimings() = default;
+
+void FrameTimings::Record(FramePhase phase, fml::TimeDelta duration) {
+  const int64_t micros = duration.ToMicroseconds();
+  histograms_[static_cast<size_t>(phase)].Insert(
+      micros > 0 ? static_cast<uint64_t>(micros) : 0);
+  // Every frame presents its session exactly once.
+  if (phase == FramePhase::kSessionPresent) {
+    frames_.Add(1);
+  }
+}
+
+void FrameTimings::RecordLateFrame() { late_frames_.Add(1); }
+
+void FrameTimings::RecordPaintTasks(size_t count, fml::TimeDelta duration) {
+  paint_tasks_.Insert(count);
+  if (count == 0) {
+    return;
+  }
+  const int64_t micros = duration.ToMicroseconds() / count;
+  paint_task_micros_.Insert(micros > 0 ? static_cast<uint64_t>(micros) : 0);
+}
+
+}  // namespace flutter_runner
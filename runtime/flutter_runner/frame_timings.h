@@ -0,0 +1,97 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_FRAME_TIMINGS_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_FRAME_TIMINGS_H_
+
+#include <lib/inspect/cpp/inspect.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "flutter/fml/macros.h"
+#include "flutter/fml/time/time_delta.h"
+#include "flutter/fml/time/time_point.h"
+
+namespace flutter_runner {
+
+// The stages of rasterizing a frame that |FrameTimings| keeps histograms for.
+enum class FramePhase {
+  kPreroll,
+  kUpdateScene,
+  kSessionPresent,
+  kExecutePaintTasks,
+  kGrContextFlush,
+  // Recorded once per surface, not once per frame.
+  kSurfaceAcquire,
+  // Decoding, filtering and re-encoding the frame's Scenic commands in
+  // |SceneCommandBuffer|.
+  kSceneCommandProxy,
+};
+
+constexpr size_t kFramePhaseCount = 7;
+
+// Always-on histograms of how long each phase of a frame takes, published
+// through Inspect so that jank shows up in the field without a trace.
+//
+// Each phase gets an exponential histogram of microseconds under |node|:
+// buckets start at 250us and double, so the last regular bucket starts at
+// 64ms and anything slower lands in the overflow bucket.
+//
+// Recording takes no lock of ours, but Inspect serializes writes to the VMO.
+// Engines only record from the raster thread, so that is never contended.
+class FrameTimings final {
+ public:
+  static constexpr uint64_t kInitialStepMicros = 250;
+  static constexpr uint64_t kStepMultiplier = 2;
+  static constexpr size_t kBucketCount = 9;
+  // Paint tasks per frame are counted in linear buckets of this width.
+  static constexpr uint64_t kPaintTaskStep = 2;
+  static constexpr size_t kPaintTaskBucketCount = 16;
+
+  // Records the time from its construction to its destruction in the
+  // histogram of |phase|.  |timings| may be null, which records nothing.
+  class ScopedPhase final {
+   public:
+    ScopedPhase(FrameTimings* timings, FramePhase phase);
+
+    ~ScopedPhase();
+
+   private:
+    FrameTimings* const timings_;
+    const FramePhase phase_;
+    const fml::TimePoint start_;
+
+    FML_DISALLOW_COPY_AND_ASSIGN(ScopedPhase);
+  };
+
+  explicit FrameTimings(inspect::Node node);
+
+  ~FrameTimings();
+
+  void Record(FramePhase phase, fml::TimeDelta duration);
+
+  // A frame started rasterizing too late to make its vsync.  See
+  // |FrameScheduler::OnRasterStarted|.
+  void RecordLateFrame();
+
+  // A frame painted |count| layer surfaces in |duration|.  Together these
+  // say how much painting surfaces concurrently could save.
+  void RecordPaintTasks(size_t count, fml::TimeDelta duration);
+
+ private:
+  inspect::Node node_;
+  std::array<inspect::ExponentialUintHistogram, kFramePhaseCount> histograms_;
+  inspect::UintProperty frames_;
+  inspect::UintProperty late_frames_;
+  inspect::LinearUintHistogram paint_tasks_;
+  inspect::ExponentialUintHistogram paint_task_micros_;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(FrameTimings);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_FRAME_TIMINGS_H_
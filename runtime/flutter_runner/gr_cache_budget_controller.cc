@@ -0,0 +1,69 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/gr_cache_budget_controller.h"
+
+#include <algorithm>
+
+#include "flutter/fml/logging.h"
+
+namespace flutter_runner {
+
+GrCacheBudgetController::GrCacheBudgetController(const Config& config)
+    : config_(config),
+      budget_(std::clamp(config.initial_bytes, config.min_bytes,
+                         config.max_bytes)) {
+  FML_DCHECK(config_.min_bytes <= config_.max_bytes);
+}
+
+GrCacheBudgetController::~GrCacheBudgetController() = default;
+
+GrCacheBudgetController::Decision GrCacheBudgetController::OnFrame(
+    size_t cache_bytes,
+    size_t purgeable_bytes) {
+  const bool full = cache_bytes >= budget_ * kFullFraction;
+  const bool under_pressure =
+      full && purgeable_bytes < cache_bytes * kPurgeableFraction;
+  const bool underused = cache_bytes < budget_ * kUnderusedFraction;
+
+  frames_under_pressure_ = under_pressure ? frames_under_pressure_ + 1 : 0;
+  frames_underused_ = underused ? frames_underused_ + 1 : 0;
+
+  if (frames_under_pressure_ >= config_.frames_to_grow &&
+      budget_ < config_.max_bytes) {
+    budget_ = std::min(budget_ + config_.step_bytes, config_.max_bytes);
+    frames_under_pressure_ = 0;
+    return Decision::kGrow;
+  }
+
+  if (frames_underused_ >= config_.frames_to_shrink &&
+      budget_ > config_.min_bytes) {
+    // Never shrink below what is in use, which would only force a purge.
+    const size_t shrunk = std::max(
+        budget_ > config_.step_bytes ? budget_ - config_.step_bytes : 0,
+        cache_bytes);
+    frames_underused_ = 0;
+    if (shrunk < budget_) {
+      budget_ = std::max(shrunk, config_.min_bytes);
+      return Decision::kShrink;
+    }
+  }
+
+  return Decision::kKeep;
+}
+
+GrCacheBudgetController::Decision GrCacheBudgetController::OnIdle(
+    size_t cache_bytes) {
+  frames_under_pressure_ = 0;
+  frames_underused_ = 0;
+  const size_t idle_budget =
+      std::clamp(cache_bytes, config_.min_bytes, config_.max_bytes);
+  if (idle_budget < budget_) {
+    budget_ = idle_budget;
+    return Decision::kShrink;
+  }
+  return Decision::kKeep;
+}
+
+}  // namespace flutter_runner
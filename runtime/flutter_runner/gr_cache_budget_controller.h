@@ -0,0 +1,72 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_GR_CACHE_BUDGET_CONTROLLER_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_GR_CACHE_BUDGET_CONTROLLER_H_
+
+#include <cstddef>
+
+#include "flutter/fml/macros.h"
+
+namespace flutter_runner {
+
+// Picks the byte limit of Skia's GPU resource cache from the cache usage seen
+// at the end of each frame, instead of relying on a hand-tuned constant.
+//
+// A cache that stays nearly full while holding little purgeable memory is
+// evicting resources that are still in use, which shows up as textures being
+// recreated every frame, so the budget grows by a step.  A cache that stays
+// well under budget for a long time gives a step back.  When the view goes
+// idle, the budget drops to what is still in use after purging.
+class GrCacheBudgetController final {
+ public:
+  struct Config {
+    size_t min_bytes;
+    size_t max_bytes;
+    size_t initial_bytes;
+    size_t step_bytes;
+    // Consecutive frames under pressure before growing.
+    size_t frames_to_grow;
+    // Consecutive frames of low usage before shrinking.
+    size_t frames_to_shrink;
+  };
+
+  enum class Decision {
+    kKeep,
+    kGrow,
+    kShrink,
+  };
+
+  // A full cache is one whose usage is at least this fraction of the budget.
+  static constexpr double kFullFraction = 0.9;
+  // A full cache is under pressure if less than this fraction of its usage is
+  // purgeable.
+  static constexpr double kPurgeableFraction = 0.25;
+  // A cache using less than this fraction of the budget is underused.
+  static constexpr double kUnderusedFraction = 0.5;
+
+  explicit GrCacheBudgetController(const Config& config);
+
+  ~GrCacheBudgetController();
+
+  size_t budget() const { return budget_; }
+
+  // Updates the budget from the cache usage at the end of a frame.
+  Decision OnFrame(size_t cache_bytes, size_t purgeable_bytes);
+
+  // Updates the budget after the cache was purged while idle.
+  Decision OnIdle(size_t cache_bytes);
+
+ private:
+  const Config config_;
+  size_t budget_;
+  size_t frames_under_pressure_ = 0;
+  size_t frames_underused_ = 0;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(GrCacheBudgetController);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_GR_CACHE_BUDGET_CONTROLLER_H_
@@ -0,0 +1,88 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/gr_cache_budget_controller.h"
+
+#include <gtest/gtest.h>
+
+namespace flutter_runner_test {
+
+using flutter_runner::GrCacheBudgetController;
+using Decision = GrCacheBudgetController::Decision;
+
+namespace {
+
+constexpr size_t kMiB = 1 << 20;
+
+GrCacheBudgetController::Config TestConfig() {
+  return {
+      .min_bytes = 8 * kMiB,
+      .max_bytes = 24 * kMiB,
+      .initial_bytes = 16 * kMiB,
+      .step_bytes = 4 * kMiB,
+      .frames_to_grow = 3,
+      .frames_to_shrink = 10,
+  };
+}
+
+}  // namespace
+
+TEST(GrCacheBudgetControllerTest, GrowsWhenFullWithoutPurgeableMemory) {
+  GrCacheBudgetController controller(TestConfig());
+
+  EXPECT_EQ(controller.OnFrame(16 * kMiB, 0), Decision::kKeep);
+  EXPECT_EQ(controller.OnFrame(16 * kMiB, 0), Decision::kKeep);
+  EXPECT_EQ(controller.OnFrame(16 * kMiB, 0), Decision::kGrow);
+  EXPECT_EQ(controller.budget(), 20 * kMiB);
+
+  // Growth stops at the maximum.
+  for (int i = 0; i < 3; i++) {
+    controller.OnFrame(20 * kMiB, 0);
+  }
+  EXPECT_EQ(controller.budget(), 24 * kMiB);
+  for (int i = 0; i < 6; i++) {
+    EXPECT_EQ(controller.OnFrame(24 * kMiB, 0), Decision::kKeep);
+  }
+  EXPECT_EQ(controller.budget(), 24 * kMiB);
+}
+
+TEST(GrCacheBudgetControllerTest, FullCacheWithPurgeableMemoryIsNotPressure) {
+  GrCacheBudgetController controller(TestConfig());
+
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(controller.OnFrame(16 * kMiB, 8 * kMiB), Decision::kKeep);
+  }
+  EXPECT_EQ(controller.budget(), 16 * kMiB);
+}
+
+TEST(GrCacheBudgetControllerTest, ShrinksAfterSustainedLowUsage) {
+  GrCacheBudgetController controller(TestConfig());
+
+  for (int i = 0; i < 9; i++) {
+    EXPECT_EQ(controller.OnFrame(2 * kMiB, 0), Decision::kKeep);
+  }
+  EXPECT_EQ(controller.OnFrame(2 * kMiB, 0), Decision::kShrink);
+  EXPECT_EQ(controller.budget(), 12 * kMiB);
+
+  // A busy frame restarts the count.
+  for (int i = 0; i < 9; i++) {
+    controller.OnFrame(2 * kMiB, 0);
+  }
+  controller.OnFrame(10 * kMiB, 0);
+  EXPECT_EQ(controller.OnFrame(2 * kMiB, 0), Decision::kKeep);
+  EXPECT_EQ(controller.budget(), 12 * kMiB);
+}
+
+TEST(GrCacheBudgetControllerTest, IdleDropsToUsageWithinBounds) {
+  GrCacheBudgetController controller(TestConfig());
+
+  EXPECT_EQ(controller.OnIdle(10 * kMiB), Decision::kShrink);
+  EXPECT_EQ(controller.budget(), 10 * kMiB);
+  EXPECT_EQ(controller.OnIdle(1 * kMiB), Decision::kShrink);
+  EXPECT_EQ(controller.budget(), 8 * kMiB);
+  EXPECT_EQ(controller.OnIdle(12 * kMiB), Decision::kKeep);
+  EXPECT_EQ(controller.budget(), 8 * kMiB);
+}
+
+}  // namespace flutter_runner_test
@@ -0,0 +1,60 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/idle_detector.h"
+
+#include <algorithm>
+
+namespace flutter_runner {
+
+namespace {
+
+// Used until the first frame reports a presentation interval.
+constexpr fml::TimeDelta kDefaultPresentationInterval =
+    fml::TimeDelta::FromSecondsF(1.0 / 60.0);
+
+}  // namespace
+
+IdleDetector::IdleDetector()
+    : presentation_interval_(kDefaultPresentationInterval) {}
+
+IdleDetector::~IdleDetector() = default;
+
+void IdleDetector::OnFrame(fml::TimePoint now,
+                           fml::TimeDelta presentation_interval) {
+  if (has_frame_ && shrunk_) {
+    // A shrink that was followed by a frame within another idle threshold
+    // was premature, the pool will have to regrow right away.
+    if (now - last_shrink_time_ < IdleThreshold()) {
+      idle_frames_ = std::min(idle_frames_ * 2, kMaxIdleFrames);
+    } else {
+      idle_frames_ = std::max(idle_frames_ / 2, kMinIdleFrames);
+    }
+  }
+  if (presentation_interval > fml::TimeDelta::Zero()) {
+    presentation_interval_ = presentation_interval;
+  }
+  has_frame_ = true;
+  shrunk_ = false;
+  last_frame_time_ = now;
+}
+
+bool IdleDetector::ShouldShrink(fml::TimePoint now) const {
+  return shrink_pending() && now >= IdleDeadline();
+}
+
+void IdleDetector::OnShrink(fml::TimePoint now) {
+  shrunk_ = true;
+  last_shrink_time_ = now;
+}
+
+fml::TimePoint IdleDetector::IdleDeadline() const {
+  return last_frame_time_ + IdleThreshold();
+}
+
+fml::TimeDelta IdleDetector::IdleThreshold() const {
+  return presentation_interval_ * idle_frames_;
+}
+
+}  // namespace flutter_runner
@@ -0,0 +1,67 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_IDLE_DETECTOR_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_IDLE_DETECTOR_H_
+
+#include <cstddef>
+
+#include "flutter/fml/macros.h"
+#include "flutter/fml/time/time_delta.h"
+#include "flutter/fml/time/time_point.h"
+
+namespace flutter_runner {
+
+// Decides when a view has been idle long enough that memory kept around for
+// the next frame is worth releasing.
+//
+// The view is idle once no frame has been presented for a number of
+// presentation intervals.  That number adapts: if frames resume soon after
+// an idle shrink, as they do between the bursts of an animation, it doubles,
+// so the pool is not shrunk and regrown over and over.  If the view then
+// stays idle for long, it halves back towards |kMinIdleFrames|.
+class IdleDetector final {
+ public:
+  static constexpr size_t kMinIdleFrames = 10;
+  static constexpr size_t kMaxIdleFrames = 80;
+
+  IdleDetector();
+
+  ~IdleDetector();
+
+  // Record that a frame was presented at |now|, at a display refresh
+  // interval of |presentation_interval|.
+  void OnFrame(fml::TimePoint now, fml::TimeDelta presentation_interval);
+
+  // Whether the view has been idle since the last frame and has not been
+  // shrunk yet.
+  bool ShouldShrink(fml::TimePoint now) const;
+
+  // Record that the view was shrunk at |now| because |ShouldShrink| said so.
+  void OnShrink(fml::TimePoint now);
+
+  // When |ShouldShrink| will become true if no frame comes first.
+  fml::TimePoint IdleDeadline() const;
+
+  // Whether a shrink is still due since the last frame.
+  bool shrink_pending() const { return has_frame_ && !shrunk_; }
+
+  size_t idle_frames() const { return idle_frames_; }
+
+ private:
+  fml::TimeDelta IdleThreshold() const;
+
+  bool has_frame_ = false;
+  bool shrunk_ = false;
+  fml::TimePoint last_frame_time_;
+  fml::TimePoint last_shrink_time_;
+  fml::TimeDelta presentation_interval_;
+  size_t idle_frames_ = kMinIdleFrames;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(IdleDetector);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_IDLE_DETECTOR_H_
@@ -0,0 +1,81 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/idle_detector.h"
+
+#include <gtest/gtest.h>
+
+namespace flutter_runner_test {
+
+using flutter_runner::IdleDetector;
+
+namespace {
+
+constexpr fml::TimeDelta k60Hz = fml::TimeDelta::FromMicroseconds(16667);
+constexpr fml::TimeDelta k120Hz = fml::TimeDelta::FromMicroseconds(8333);
+
+fml::TimePoint At(fml::TimeDelta time) {
+  return fml::TimePoint::FromEpochDelta(time);
+}
+
+}  // namespace
+
+TEST(IdleDetectorTest, NothingToShrinkBeforeFirstFrame) {
+  IdleDetector detector;
+  EXPECT_FALSE(detector.shrink_pending());
+  EXPECT_FALSE(detector.ShouldShrink(At(fml::TimeDelta::FromSeconds(10))));
+}
+
+TEST(IdleDetectorTest, ThresholdFollowsPresentationInterval) {
+  IdleDetector detector;
+  detector.OnFrame(At(fml::TimeDelta::Zero()), k120Hz);
+  EXPECT_EQ(detector.IdleDeadline(),
+            At(k120Hz * IdleDetector::kMinIdleFrames));
+  EXPECT_FALSE(detector.ShouldShrink(At(k120Hz * 9)));
+  EXPECT_TRUE(detector.ShouldShrink(At(k120Hz * 10)));
+
+  detector.OnFrame(At(k120Hz), k60Hz);
+  EXPECT_FALSE(detector.ShouldShrink(At(k120Hz + k60Hz * 9)));
+  EXPECT_TRUE(detector.ShouldShrink(At(k120Hz + k60Hz * 10)));
+}
+
+TEST(IdleDetectorTest, ShrinksOncePerIdlePeriod) {
+  IdleDetector detector;
+  detector.OnFrame(At(fml::TimeDelta::Zero()), k60Hz);
+  ASSERT_TRUE(detector.ShouldShrink(At(k60Hz * 10)));
+  detector.OnShrink(At(k60Hz * 10));
+  EXPECT_FALSE(detector.shrink_pending());
+  EXPECT_FALSE(detector.ShouldShrink(At(k60Hz * 100)));
+
+  detector.OnFrame(At(k60Hz * 100), k60Hz);
+  EXPECT_TRUE(detector.shrink_pending());
+}
+
+TEST(IdleDetectorTest, BurstsBackOffAndLongIdleRecovers) {
+  IdleDetector detector;
+  fml::TimeDelta now = fml::TimeDelta::Zero();
+
+  // Frames resume right after each shrink, as between animation bursts.
+  for (size_t expected : {20u, 40u, 80u, 80u}) {
+    detector.OnFrame(At(now), k60Hz);
+    now = now + k60Hz * detector.idle_frames();
+    ASSERT_TRUE(detector.ShouldShrink(At(now)));
+    detector.OnShrink(At(now));
+    now = now + k60Hz;
+    detector.OnFrame(At(now), k60Hz);
+    EXPECT_EQ(detector.idle_frames(), expected);
+  }
+
+  // Shrinks that last make the detector eager again.
+  for (size_t expected : {40u, 20u, 10u, 10u}) {
+    now = now + k60Hz * detector.idle_frames();
+    ASSERT_TRUE(detector.ShouldShrink(At(now)));
+    detector.OnShrink(At(now));
+    now = now + fml::TimeDelta::FromSeconds(10);
+    detector.OnFrame(At(now), k60Hz);
+    EXPECT_EQ(detector.idle_frames(), expected);
+  }
+}
+
+}  // namespace flutter_runner_test
@@ -0,0 +1,89 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/memory_range_allocator.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "flutter/fml/logging.h"
+
+namespace flutter_runner {
+
+MemoryRangeAllocator::MemoryRangeAllocator(uint64_t capacity)
+    : capacity_(capacity), free_bytes_(capacity) {
+  if (capacity_ > 0) {
+    free_ranges_[0] = capacity_;
+  }
+}
+
+MemoryRangeAllocator::~MemoryRangeAllocator() = default;
+
+uint64_t MemoryRangeAllocator::LargestFreeRange() const {
+  uint64_t largest = 0;
+  for (const auto& [offset, size] : free_ranges_) {
+    largest = std::max(largest, size);
+  }
+  return largest;
+}
+
+uint64_t MemoryRangeAllocator::Allocate(uint64_t size, uint64_t alignment) {
+  FML_DCHECK(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  if (size == 0) {
+    return kInvalidOffset;
+  }
+
+  for (auto it = free_ranges_.begin(); it != free_ranges_.end(); ++it) {
+    const uint64_t range_offset = it->first;
+    const uint64_t range_size = it->second;
+    const uint64_t offset = (range_offset + alignment - 1) & ~(alignment - 1);
+    const uint64_t padding = offset - range_offset;
+    if (padding >= range_size || range_size - padding < size) {
+      continue;
+    }
+
+    // Padding in front of the allocation is too small to be worth tracking
+    // on its own, so it is owned by the allocation and freed with it.
+    const uint64_t used = padding + size;
+    free_ranges_.erase(it);
+    if (range_size > used) {
+      free_ranges_[range_offset + used] = range_size - used;
+    }
+    allocations_[offset] = {range_offset, used};
+    free_bytes_ -= used;
+    return offset;
+  }
+  return kInvalidOffset;
+}
+
+void MemoryRangeAllocator::Free(uint64_t offset) {
+  auto found = allocations_.find(offset);
+  FML_DCHECK(found != allocations_.end());
+  if (found == allocations_.end()) {
+    return;
+  }
+  uint64_t range_offset = found->second.range_offset;
+  uint64_t range_size = found->second.range_size;
+  allocations_.erase(found);
+  free_bytes_ += range_size;
+
+  // Coalesce with the following free range.
+  auto next = free_ranges_.lower_bound(range_offset);
+  if (next != free_ranges_.end() && next->first == range_offset + range_size) {
+    range_size += next->second;
+    next = free_ranges_.erase(next);
+  }
+
+  // Coalesce with the preceding free range.
+  if (next != free_ranges_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == range_offset) {
+      prev->second += range_size;
+      return;
+    }
+  }
+  free_ranges_[range_offset] = range_size;
+}
+
+}  // namespace flutter_runner
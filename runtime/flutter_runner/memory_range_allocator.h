@@ -0,0 +1,67 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_MEMORY_RANGE_ALLOCATOR_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_MEMORY_RANGE_ALLOCATOR_H_
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+#include "flutter/fml/macros.h"
+
+namespace flutter_runner {
+
+// Hands out aligned ranges of a fixed-size block of memory.  Free ranges are
+// kept sorted by offset and coalesced with their neighbours when released, and
+// allocation is first fit, which keeps long-lived allocations packed towards
+// the start of the block.
+class MemoryRangeAllocator final {
+ public:
+  static constexpr uint64_t kInvalidOffset = UINT64_MAX;
+
+  explicit MemoryRangeAllocator(uint64_t capacity);
+
+  ~MemoryRangeAllocator();
+
+  uint64_t capacity() const { return capacity_; }
+
+  // The bytes in allocated ranges, including the padding added for alignment.
+  uint64_t used_bytes() const { return capacity_ - free_bytes_; }
+
+  uint64_t free_bytes() const { return free_bytes_; }
+
+  bool empty() const { return allocations_.empty(); }
+
+  uint64_t LargestFreeRange() const;
+
+  // Returns the offset of a new range of |size| bytes aligned to |alignment|,
+  // which must be a power of two, or |kInvalidOffset| if there is no free
+  // range large enough.
+  uint64_t Allocate(uint64_t size, uint64_t alignment);
+
+  // Releases the range at |offset| returned by |Allocate|.
+  void Free(uint64_t offset);
+
+ private:
+  struct Allocation {
+    // The start of the free range the allocation was carved from, before
+    // alignment.
+    uint64_t range_offset;
+    uint64_t range_size;
+  };
+
+  const uint64_t capacity_;
+  uint64_t free_bytes_;
+  // Free ranges keyed by offset, mapped to their size.
+  std::map<uint64_t, uint64_t> free_ranges_;
+  // Allocations keyed by the offset returned from |Allocate|.
+  std::unordered_map<uint64_t, Allocation> allocations_;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(MemoryRangeAllocator);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_MEMORY_RANGE_ALLOCATOR_H_
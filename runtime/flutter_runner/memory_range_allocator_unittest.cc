@@ -0,0 +1,63 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/memory_range_allocator.h"
+
+#include <gtest/gtest.h>
+
+namespace flutter_runner_test {
+
+using flutter_runner::MemoryRangeAllocator;
+
+TEST(MemoryRangeAllocatorTest, AllocatesAlignedRanges) {
+  MemoryRangeAllocator allocator(1024);
+
+  const uint64_t first = allocator.Allocate(100, 64);
+  const uint64_t second = allocator.Allocate(100, 64);
+  ASSERT_NE(first, MemoryRangeAllocator::kInvalidOffset);
+  ASSERT_NE(second, MemoryRangeAllocator::kInvalidOffset);
+  EXPECT_EQ(first, 0u);
+  EXPECT_EQ(second, 128u);
+  // The padding in front of |second| is accounted to it.
+  EXPECT_EQ(allocator.used_bytes(), 228u);
+}
+
+TEST(MemoryRangeAllocatorTest, FailsWhenNoRangeIsLargeEnough) {
+  MemoryRangeAllocator allocator(1024);
+
+  EXPECT_EQ(allocator.Allocate(2048, 1), MemoryRangeAllocator::kInvalidOffset);
+  EXPECT_EQ(allocator.Allocate(0, 1), MemoryRangeAllocator::kInvalidOffset);
+
+  const uint64_t offset = allocator.Allocate(1000, 1);
+  ASSERT_NE(offset, MemoryRangeAllocator::kInvalidOffset);
+  // 24 bytes are free, but not at a 32 byte boundary with room for 16 bytes.
+  EXPECT_EQ(allocator.Allocate(16, 32), MemoryRangeAllocator::kInvalidOffset);
+}
+
+TEST(MemoryRangeAllocatorTest, CoalescesFreedRanges) {
+  MemoryRangeAllocator allocator(400);
+
+  const uint64_t a = allocator.Allocate(100, 1);
+  const uint64_t b = allocator.Allocate(100, 1);
+  const uint64_t c = allocator.Allocate(100, 1);
+  const uint64_t d = allocator.Allocate(100, 1);
+  EXPECT_EQ(allocator.free_bytes(), 0u);
+
+  allocator.Free(a);
+  allocator.Free(c);
+  EXPECT_EQ(allocator.free_bytes(), 200u);
+  EXPECT_EQ(allocator.LargestFreeRange(), 100u);
+
+  // Freeing |b| joins it with both neighbours.
+  allocator.Free(b);
+  EXPECT_EQ(allocator.LargestFreeRange(), 300u);
+  EXPECT_EQ(allocator.Allocate(300, 1), a);
+
+  allocator.Free(a);
+  allocator.Free(d);
+  EXPECT_TRUE(allocator.empty());
+  EXPECT_EQ(allocator.LargestFreeRange(), 400u);
+}
+
+}  // namespace flutter_runner_test
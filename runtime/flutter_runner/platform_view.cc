@@ -5,6 +5,7 @@
 #include "fuchsia/accessibility/cpp/fidl.h"
 #define RAPIDJSON_HAS_STDSTRING 1
 
+#include <lib/async/default.h>
 #include <trace/event.h>
 
 #include <sstream>
@@ -15,10 +16,8 @@
 #include "flutter/lib/ui/window/window.h"
 #include "fuchsia/ui/views/cpp/fidl.h"
 #include "platform_view.h"
-#include "rapidjson/document.h"
-#include "rapidjson/stringbuffer.h"
-#include "rapidjson/writer.h"
 #include "topaz/runtime/dart/utils/inlines.h"
+#include "topaz/runtime/flutter_runner/frame_scheduler.h"
 #include "topaz/runtime/flutter_runner/logging.h"
 #include "topaz/runtime/flutter_runner/vsync_waiter.h"
 
@@ -65,6 +64,19 @@ static constexpr char kKeyEventChannel[] = "flutter/keyevent";
 static constexpr char kAccessibilityChannel[] = "flutter/accessibility";
 static constexpr char kFlutterPlatformViewsChannel[] = "flutter/platform_views";
 
+// Room for the JSON of each message we send, less any text it carries, so
+// that encoding one allocates once.
+static constexpr size_t kTextInputStateMessageSize = 256;
+static constexpr size_t kTextInputActionMessageSize = 128;
+static constexpr size_t kKeyEventMessageSize = 128;
+static constexpr size_t kClipboardMessageSize = 16;
+
+// How long before a frame starts held back pointer moves and viewport
+// metrics are sent, so that they reach the UI thread before it starts
+// building the frame.
+static constexpr fml::TimeDelta kFlushLead =
+    fml::TimeDelta::FromMilliseconds(1);
+
 // FL(77): Terminate engine if Fuchsia system FIDL connections have error.
 template <class T>
 void SetInterfaceErrorHandler(fidl::InterfacePtr<T>& interface,
@@ -93,7 +105,10 @@ PlatformView::PlatformView(
     OnMetricsUpdate session_metrics_did_change_callback,
     OnSizeChangeHint session_size_change_hint_callback,
     OnEnableWireframe wireframe_enabled_callback,
-    zx_handle_t vsync_event_handle)
+    zx_handle_t vsync_event_handle,
+    std::shared_ptr<VsyncRecorder> vsync_recorder,
+    std::shared_ptr<FrameScheduler> frame_scheduler, bool latch_pointer_input,
+    bool merge_pointer_moves)
     : flutter::PlatformView(delegate, std::move(task_runners)),
       debug_label_(std::move(debug_label)),
       view_ref_control_(std::move(view_ref_control)),
@@ -107,7 +122,15 @@ PlatformView::PlatformView(
       ime_client_(this),
       a11y_settings_watcher_binding_(this),
       surface_(std::make_unique<Surface>(debug_label_)),
-      vsync_event_handle_(vsync_event_handle) {
+      latch_pointer_input_(latch_pointer_input),
+      merge_pointer_moves_(merge_pointer_moves),
+      vsync_event_handle_(vsync_event_handle),
+      vsync_recorder_(std::move(vsync_recorder)),
+      frame_scheduler_(std::move(frame_scheduler)) {
+  pointer_flush_task_.set_handler(
+      [this] { FlushPointerEvents(pointer_sample_time_); });
+  metrics_flush_task_.set_handler([this] { FlushViewportMetrics(); });
+
   // Register all error handlers.
   SetInterfaceErrorHandler(session_listener_binding_, "SessionListener");
   SetInterfaceErrorHandler(ime_, "Input Method Editor");
@@ -196,7 +219,7 @@ void PlatformView::OnPropertiesChanged(
   metrics_.padding.bottom = view_properties.inset_from_max.y;
   metrics_.padding.back = view_properties.inset_from_max.z;
 
-  FlushViewportMetrics();
+  ScheduleViewportMetricsFlush();
 }
 
 void PlatformView::UpdateViewportMetrics(
@@ -204,10 +227,39 @@ void PlatformView::UpdateViewportMetrics(
   metrics_.scale = metrics.scale_x;
   metrics_.scale_z = metrics.scale_z;
 
-  FlushViewportMetrics();
+  ScheduleViewportMetricsFlush();
+}
+
+void PlatformView::ScheduleViewportMetricsFlush() {
+  pending_metrics_updates_++;
+  // Nothing can be drawn until the view has a size and scale, so the
+  // metrics that give it one are not held back.
+  if (!viewport_metrics_complete_) {
+    FlushViewportMetrics();
+    return;
+  }
+  if (metrics_flush_task_.is_pending()) {
+    return;
+  }
+  fml::TimePoint flush_time = GetNextFrameTimes().wakeup_time - kFlushLead;
+  metrics_flush_task_.PostForTime(
+      async_get_default_dispatcher(),
+      zx::time(flush_time.ToEpochDelta().ToNanoseconds()));
 }
 
 void PlatformView::FlushViewportMetrics() {
+  TRACE_DURATION("flutter", "PlatformView::FlushViewportMetrics");
+  if (pending_metrics_updates_ > 1) {
+    merged_metrics_updates_ += pending_metrics_updates_ - 1;
+  }
+  TRACE_COUNTER("flutter", "ViewportMetrics", 0u,     //
+                "Updates", pending_metrics_updates_,  //
+                "Merged", merged_metrics_updates_     //
+  );
+  pending_metrics_updates_ = 0;
+  viewport_metrics_complete_ = metrics_.scale > 0 && metrics_.size.width > 0 &&
+                               metrics_.size.height > 0;
+
   const auto scale = metrics_.scale;
   const auto scale_z = metrics_.scale_z;
 
@@ -233,47 +285,40 @@ void PlatformView::FlushViewportMetrics() {
 void PlatformView::DidUpdateState(
     fuchsia::ui::input::TextInputState state,
     std::unique_ptr<fuchsia::ui::input::InputEvent> input_event) {
-  rapidjson::Document document;
-  auto& allocator = document.GetAllocator();
-  rapidjson::Value encoded_state(rapidjson::kObjectType);
-  encoded_state.AddMember("text", state.text, allocator);
-  encoded_state.AddMember("selectionBase", state.selection.base, allocator);
-  encoded_state.AddMember("selectionExtent", state.selection.extent, allocator);
+  ChannelWriter writer(text_input_codec_,
+                       kTextInputStateMessageSize + state.text.size());
+  writer.BeginMethodCall("TextInputClient.updateEditingState");
+  writer.BeginList(2);
+  writer.Int(current_text_input_client_);
+  writer.BeginMap(7);
+  writer.Key("text");
+  writer.String(state.text);
+  writer.Key("selectionBase");
+  writer.Int(state.selection.base);
+  writer.Key("selectionExtent");
+  writer.Int(state.selection.extent);
+  writer.Key("selectionAffinity");
   switch (state.selection.affinity) {
     case fuchsia::ui::input::TextAffinity::UPSTREAM:
-      encoded_state.AddMember("selectionAffinity",
-                              rapidjson::Value("TextAffinity.upstream"),
-                              allocator);
+      writer.String("TextAffinity.upstream");
       break;
     case fuchsia::ui::input::TextAffinity::DOWNSTREAM:
-      encoded_state.AddMember("selectionAffinity",
-                              rapidjson::Value("TextAffinity.downstream"),
-                              allocator);
+      writer.String("TextAffinity.downstream");
       break;
   }
-  encoded_state.AddMember("selectionIsDirectional", true, allocator);
-  encoded_state.AddMember("composingBase", state.composing.start, allocator);
-  encoded_state.AddMember("composingExtent", state.composing.end, allocator);
-
-  rapidjson::Value args(rapidjson::kArrayType);
-  args.PushBack(current_text_input_client_, allocator);
-  args.PushBack(encoded_state, allocator);
-
-  document.SetObject();
-  document.AddMember("method",
-                     rapidjson::Value("TextInputClient.updateEditingState"),
-                     allocator);
-  document.AddMember("args", args, allocator);
+  writer.Key("selectionIsDirectional");
+  writer.Bool(true);
+  writer.Key("composingBase");
+  writer.Int(state.composing.start);
+  writer.Key("composingExtent");
+  writer.Int(state.composing.end);
+  writer.EndMap();
+  writer.EndList();
 
-  rapidjson::StringBuffer buffer;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-  document.Accept(writer);
-
-  const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.GetString());
   DispatchPlatformMessage(fml::MakeRefCounted<flutter::PlatformMessage>(
-      kTextInputChannel,                                    // channel
-      std::vector<uint8_t>(data, data + buffer.GetSize()),  // message
-      nullptr)                                              // response
+      kTextInputChannel,  // channel
+      writer.Finish(),    // message
+      nullptr)            // response
   );
   last_text_state_ =
       std::make_unique<fuchsia::ui::input::TextInputState>(state);
@@ -287,29 +332,18 @@ void PlatformView::DidUpdateState(
 
 // |fuchsia::ui::input::InputMethodEditorClient|
 void PlatformView::OnAction(fuchsia::ui::input::InputMethodAction action) {
-  rapidjson::Document document;
-  auto& allocator = document.GetAllocator();
-
-  rapidjson::Value args(rapidjson::kArrayType);
-  args.PushBack(current_text_input_client_, allocator);
-
+  ChannelWriter writer(text_input_codec_, kTextInputActionMessageSize);
+  writer.BeginMethodCall("TextInputClient.performAction");
+  writer.BeginList(2);
+  writer.Int(current_text_input_client_);
   // Done is currently the only text input action defined by Flutter.
-  args.PushBack("TextInputAction.done", allocator);
-
-  document.SetObject();
-  document.AddMember(
-      "method", rapidjson::Value("TextInputClient.performAction"), allocator);
-  document.AddMember("args", args, allocator);
+  writer.String("TextInputAction.done");
+  writer.EndList();
 
-  rapidjson::StringBuffer buffer;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-  document.Accept(writer);
-
-  const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.GetString());
   DispatchPlatformMessage(fml::MakeRefCounted<flutter::PlatformMessage>(
-      kTextInputChannel,                                    // channel
-      std::vector<uint8_t>(data, data + buffer.GetSize()),  // message
-      nullptr)                                              // response
+      kTextInputChannel,  // channel
+      writer.Finish(),    // message
+      nullptr)            // response
   );
 }
 
@@ -321,7 +355,14 @@ void PlatformView::OnScenicError(std::string error) {
 void PlatformView::OnScenicEvent(
     std::vector<fuchsia::ui::scenic::Event> events) {
   TRACE_DURATION("flutter", "PlatformView::OnScenicEvent");
+  PointerBatch pointer_batch(merge_pointer_moves_);
+  ChildViewBatch child_view_batch;
   for (const auto& event : events) {
+    // Pointer events batched so far happened before this one, so they go
+    // first.
+    if (!event.is_input() || !event.input().is_pointer()) {
+      DispatchPointerBatch(&pointer_batch);
+    }
     switch (event.Which()) {
       case fuchsia::ui::scenic::Event::Tag::kGfx:
         switch (event.gfx().Which()) {
@@ -345,16 +386,20 @@ void PlatformView::OnScenicEvent(
             break;
           }
           case fuchsia::ui::gfx::Event::Tag::kViewConnected:
-            OnChildViewConnected(event.gfx().view_connected().view_holder_id);
+            child_view_batch.Add(
+                {ChildViewEvent::Type::kConnected,
+                 event.gfx().view_connected().view_holder_id, false});
             break;
           case fuchsia::ui::gfx::Event::Tag::kViewDisconnected:
-            OnChildViewDisconnected(
-                event.gfx().view_disconnected().view_holder_id);
+            child_view_batch.Add(
+                {ChildViewEvent::Type::kDisconnected,
+                 event.gfx().view_disconnected().view_holder_id, false});
             break;
           case fuchsia::ui::gfx::Event::Tag::kViewStateChanged:
-            OnChildViewStateChanged(
-                event.gfx().view_state_changed().view_holder_id,
-                event.gfx().view_state_changed().state.is_rendering);
+            child_view_batch.Add(
+                {ChildViewEvent::Type::kStateChanged,
+                 event.gfx().view_state_changed().view_holder_id,
+                 event.gfx().view_state_changed().state.is_rendering});
             break;
           case fuchsia::ui::gfx::Event::Tag::Invalid:
             FML_DCHECK(false) << "Flutter PlatformView::OnScenicEvent: Got "
@@ -372,7 +417,7 @@ void PlatformView::OnScenicEvent(
             break;
           }
           case fuchsia::ui::input::InputEvent::Tag::kPointer: {
-            OnHandlePointerEvent(event.input().pointer());
+            OnHandlePointerEvent(event.input().pointer(), &pointer_batch);
             break;
           }
           case fuchsia::ui::input::InputEvent::Tag::kKeyboard: {
@@ -391,24 +436,45 @@ void PlatformView::OnScenicEvent(
       }
     }
   }
-}
 
-void PlatformView::OnChildViewConnected(scenic::ResourceId view_holder_id) {
-  task_runners_.GetUITaskRunner()->PostTask([view_holder_id]() {
-    flutter::SceneHost::OnViewConnected(view_holder_id);
-  });
-}
+  DispatchPointerBatch(&pointer_batch);
 
-void PlatformView::OnChildViewDisconnected(scenic::ResourceId view_holder_id) {
-  task_runners_.GetUITaskRunner()->PostTask([view_holder_id]() {
-    flutter::SceneHost::OnViewDisconnected(view_holder_id);
-  });
+  if (!child_view_batch.empty()) {
+    TRACE_COUNTER("flutter", "ChildViewBatch", 0u,  //
+                  "Events", child_view_batch.size()  //
+    );
+    DispatchChildViewEvents(child_view_batch.Take());
+  }
 }
 
-void PlatformView::OnChildViewStateChanged(scenic::ResourceId view_holder_id,
-                                           bool state) {
-  task_runners_.GetUITaskRunner()->PostTask([view_holder_id, state]() {
-    flutter::SceneHost::OnViewStateChanged(view_holder_id, state);
+void PlatformView::DispatchPointerBatch(PointerBatch* batch) {
+  if (batch->empty()) {
+    return;
+  }
+  TRACE_COUNTER("flutter", "PointerBatch", 0u,  //
+                "Events", batch->size(),        //
+                "Merged", batch->merged()       //
+  );
+  DispatchPointerDataPacket(batch->TakePacket());
+}
+
+void PlatformView::DispatchChildViewEvents(
+    std::vector<ChildViewEvent> events) {
+  task_runners_.GetUITaskRunner()->PostTask([events = std::move(events)]() {
+    for (const auto& event : events) {
+      switch (event.type) {
+        case ChildViewEvent::Type::kConnected:
+          flutter::SceneHost::OnViewConnected(event.view_holder_id);
+          break;
+        case ChildViewEvent::Type::kDisconnected:
+          flutter::SceneHost::OnViewDisconnected(event.view_holder_id);
+          break;
+        case ChildViewEvent::Type::kStateChanged:
+          flutter::SceneHost::OnViewStateChanged(event.view_holder_id,
+                                                 event.is_rendering);
+          break;
+      }
+    }
   });
 }
 
@@ -456,7 +522,7 @@ static trace_flow_id_t PointerTraceHACK(float fa, float fb) {
 }
 
 bool PlatformView::OnHandlePointerEvent(
-    const fuchsia::ui::input::PointerEvent& pointer) {
+    const fuchsia::ui::input::PointerEvent& pointer, PointerBatch* batch) {
   TRACE_DURATION("flutter", "PlatformView::OnHandlePointerEvent");
   // TODO(SCN-1278): Use proper trace_id for tracing flow.
   trace_flow_id_t trace_id =
@@ -504,12 +570,59 @@ bool PlatformView::OnHandlePointerEvent(
       break;
   }
 
-  auto packet = std::make_unique<flutter::PointerDataPacket>(1);
-  packet->SetPointerData(0, pointer_data);
-  DispatchPointerDataPacket(std::move(packet));
+  if (!latch_pointer_input_) {
+    batch->Add(pointer_data);
+    return true;
+  }
+  if (PointerLatch::IsLatched(pointer_data)) {
+    pointer_latch_.Add(pointer_data);
+    SchedulePointerFlush();
+    return true;
+  }
+  // Send the moves held back so far first, predicted no further than this
+  // event.
+  const fml::TimePoint event_time = fml::TimePoint::FromEpochDelta(
+      fml::TimeDelta::FromMicroseconds(pointer_data.time_stamp));
+  for (const auto& event : pointer_latch_.Flush(event_time)) {
+    batch->Add(event);
+  }
+  pointer_latch_.Pass(&pointer_data);
+  batch->Add(pointer_data);
   return true;
 }
 
+FrameScheduler::FrameTimes PlatformView::GetNextFrameTimes() const {
+  VsyncInfo vsync_info = vsync_recorder_->GetCurrentVsyncInfo();
+  return frame_scheduler_->GetNextFrameTimes(
+      fml::TimePoint::Now(), vsync_info.presentation_time,
+      vsync_info.presentation_interval);
+}
+
+void PlatformView::SchedulePointerFlush() {
+  if (pointer_flush_task_.is_pending()) {
+    return;
+  }
+  auto frame_times = GetNextFrameTimes();
+  pointer_sample_time_ = frame_times.target_time;
+  fml::TimePoint flush_time = frame_times.wakeup_time - kFlushLead;
+  pointer_flush_task_.PostForTime(
+      async_get_default_dispatcher(),
+      zx::time(flush_time.ToEpochDelta().ToNanoseconds()));
+}
+
+void PlatformView::FlushPointerEvents(fml::TimePoint sample_time) {
+  TRACE_DURATION("flutter", "PlatformView::FlushPointerEvents");
+  if (pointer_latch_.empty()) {
+    return;
+  }
+  // The moves were held back to be sent together, so they are not merged.
+  PointerBatch batch(false);
+  for (const auto& event : pointer_latch_.Flush(sample_time)) {
+    batch.Add(event);
+  }
+  DispatchPointerDataPacket(batch.TakePacket());
+}
+
 bool PlatformView::OnHandleKeyboardEvent(
     const fuchsia::ui::input::KeyboardEvent& keyboard) {
   const char* type = nullptr;
@@ -527,23 +640,25 @@ bool PlatformView::OnHandleKeyboardEvent(
     return false;
   }
 
-  rapidjson::Document document;
-  auto& allocator = document.GetAllocator();
-  document.SetObject();
-  document.AddMember("type", rapidjson::Value(type, strlen(type)), allocator);
-  document.AddMember("keymap", rapidjson::Value("fuchsia"), allocator);
-  document.AddMember("hidUsage", keyboard.hid_usage, allocator);
-  document.AddMember("codePoint", keyboard.code_point, allocator);
-  document.AddMember("modifiers", keyboard.modifiers, allocator);
-  rapidjson::StringBuffer buffer;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-  document.Accept(writer);
+  // The framework decodes key events as JSON only.
+  ChannelWriter writer(ChannelCodec::kJson, kKeyEventMessageSize);
+  writer.BeginMap(5);
+  writer.Key("type");
+  writer.String(type);
+  writer.Key("keymap");
+  writer.String("fuchsia");
+  writer.Key("hidUsage");
+  writer.Int(keyboard.hid_usage);
+  writer.Key("codePoint");
+  writer.Int(keyboard.code_point);
+  writer.Key("modifiers");
+  writer.Int(keyboard.modifiers);
+  writer.EndMap();
 
-  const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.GetString());
   DispatchPlatformMessage(fml::MakeRefCounted<flutter::PlatformMessage>(
-      kKeyEventChannel,                                     // channel
-      std::vector<uint8_t>(data, data + buffer.GetSize()),  // data
-      nullptr)                                              // response
+      kKeyEventChannel,  // channel
+      writer.Finish(),   // data
+      nullptr)           // response
   );
 
   return true;
@@ -587,7 +702,8 @@ void PlatformView::DeactivateIme() {
 // |flutter::PlatformView|
 std::unique_ptr<flutter::VsyncWaiter> PlatformView::CreateVSyncWaiter() {
   return std::make_unique<flutter_runner::VsyncWaiter>(
-      debug_label_, vsync_event_handle_, task_runners_);
+      debug_label_, vsync_event_handle_, vsync_recorder_, frame_scheduler_,
+      task_runners_);
 }
 
 // |flutter::PlatformView|
@@ -639,37 +755,28 @@ void PlatformView::HandleAccessibilityChannelPlatformMessage(
 void PlatformView::HandleFlutterPlatformChannelPlatformMessage(
     fml::RefPtr<flutter::PlatformMessage> message) {
   FML_DCHECK(message->channel() == kFlutterPlatformChannel);
-  const auto& data = message->data();
-  rapidjson::Document document;
-  document.Parse(reinterpret_cast<const char*>(data.data()), data.size());
-  if (document.HasParseError() || !document.IsObject()) {
-    return;
-  }
-
-  auto root = document.GetObject();
-  auto method = root.FindMember("method");
-  if (method == root.MemberEnd() || !method->value.IsString()) {
+  MethodCall call;
+  if (!call.Decode(message->data())) {
     return;
   }
 
   fml::RefPtr<flutter::PlatformMessageResponse> response = message->response();
-  if (method->value == "Clipboard.setData") {
-    auto text = root["args"]["text"].GetString();
-    clipboard_->Push(text);
+  if (call.method() == "Clipboard.setData") {
+    const ChannelValue* text = call.args().Find("text");
+    if (text != nullptr && text->IsString()) {
+      clipboard_->Push(std::string(text->string_value));
+    }
     response->CompleteEmpty();
-  } else if (method->value == "Clipboard.getData") {
-    clipboard_->Peek([response](fidl::StringPtr text) {
-      rapidjson::StringBuffer json_buffer;
-      rapidjson::Writer<rapidjson::StringBuffer> writer(json_buffer);
-      writer.StartArray();
-      writer.StartObject();
+  } else if (call.method() == "Clipboard.getData") {
+    clipboard_->Peek([response, codec = call.codec()](fidl::StringPtr text) {
+      const std::string& value = text.value_or("");
+      ChannelWriter writer(codec, kClipboardMessageSize + value.size());
+      writer.BeginSuccess();
+      writer.BeginMap(1);
       writer.Key("text");
-      writer.String(text.value_or(""));
-      writer.EndObject();
-      writer.EndArray();
-      std::string result = json_buffer.GetString();
-      response->Complete(std::make_unique<fml::DataMapping>(
-          std::vector<uint8_t>{result.begin(), result.end()}));
+      writer.String(value);
+      writer.EndMap();
+      response->Complete(std::make_unique<fml::DataMapping>(writer.Finish()));
     });
   } else {
     response->CompleteEmpty();
@@ -680,127 +787,109 @@ void PlatformView::HandleFlutterPlatformChannelPlatformMessage(
 void PlatformView::HandleFlutterTextInputChannelPlatformMessage(
     fml::RefPtr<flutter::PlatformMessage> message) {
   FML_DCHECK(message->channel() == kTextInputChannel);
-  const auto& data = message->data();
-  rapidjson::Document document;
-  document.Parse(reinterpret_cast<const char*>(data.data()), data.size());
-  if (document.HasParseError() || !document.IsObject()) {
-    return;
-  }
-  auto root = document.GetObject();
-  auto method = root.FindMember("method");
-  if (method == root.MemberEnd() || !method->value.IsString()) {
+  MethodCall call;
+  if (!call.Decode(message->data())) {
     return;
   }
+  text_input_codec_ = call.codec();
 
-  if (method->value == "TextInput.show") {
+  const std::string_view method = call.method();
+  if (method == "TextInput.show") {
     if (ime_) {
       text_sync_service_->ShowKeyboard();
     }
-  } else if (method->value == "TextInput.hide") {
+  } else if (method == "TextInput.hide") {
     if (ime_) {
       text_sync_service_->HideKeyboard();
     }
-  } else if (method->value == "TextInput.setClient") {
+  } else if (method == "TextInput.setClient") {
     current_text_input_client_ = 0;
     DeactivateIme();
-    auto args = root.FindMember("args");
-    if (args == root.MemberEnd() || !args->value.IsArray() ||
-        args->value.Size() != 2)
+    const ChannelValue& args = call.args();
+    if (!args.IsList() || args.items.size() != 2 || !args.items[0].IsInt())
       return;
-    const auto& configuration = args->value[1];
-    if (!configuration.IsObject()) {
+    const auto& configuration = args.items[1];
+    if (!configuration.IsMap()) {
       return;
     }
     // TODO(abarth): Read the keyboard type from the configuration.
-    current_text_input_client_ = args->value[0].GetInt();
+    current_text_input_client_ = static_cast<int>(args.items[0].int_value);
 
     auto initial_text_input_state = fuchsia::ui::input::TextInputState{};
     initial_text_input_state.text = "";
     last_text_state_ = std::make_unique<fuchsia::ui::input::TextInputState>(
         initial_text_input_state);
     ActivateIme();
-  } else if (method->value == "TextInput.setEditingState") {
+  } else if (method == "TextInput.setEditingState") {
     if (ime_) {
-      auto args_it = root.FindMember("args");
-      if (args_it == root.MemberEnd() || !args_it->value.IsObject()) {
+      const ChannelValue& args = call.args();
+      if (!args.IsMap()) {
         return;
       }
-      const auto& args = args_it->value;
       fuchsia::ui::input::TextInputState state;
       state.text = "";
       // TODO(abarth): Deserialize state.
-      auto text = args.FindMember("text");
-      if (text != args.MemberEnd() && text->value.IsString())
-        state.text = text->value.GetString();
-      auto selection_base = args.FindMember("selectionBase");
-      if (selection_base != args.MemberEnd() && selection_base->value.IsInt())
-        state.selection.base = selection_base->value.GetInt();
-      auto selection_extent = args.FindMember("selectionExtent");
-      if (selection_extent != args.MemberEnd() &&
-          selection_extent->value.IsInt())
-        state.selection.extent = selection_extent->value.GetInt();
-      auto selection_affinity = args.FindMember("selectionAffinity");
-      if (selection_affinity != args.MemberEnd() &&
-          selection_affinity->value.IsString() &&
-          selection_affinity->value == "TextAffinity.upstream")
+      auto text = args.Find("text");
+      if (text != nullptr && text->IsString())
+        state.text = std::string(text->string_value);
+      auto selection_base = args.Find("selectionBase");
+      if (selection_base != nullptr && selection_base->IsInt())
+        state.selection.base = selection_base->int_value;
+      auto selection_extent = args.Find("selectionExtent");
+      if (selection_extent != nullptr && selection_extent->IsInt())
+        state.selection.extent = selection_extent->int_value;
+      auto selection_affinity = args.Find("selectionAffinity");
+      if (selection_affinity != nullptr && selection_affinity->IsString() &&
+          selection_affinity->string_value == "TextAffinity.upstream")
         state.selection.affinity = fuchsia::ui::input::TextAffinity::UPSTREAM;
       else
         state.selection.affinity = fuchsia::ui::input::TextAffinity::DOWNSTREAM;
       // We ignore selectionIsDirectional because that concept doesn't exist on
       // Fuchsia.
-      auto composing_base = args.FindMember("composingBase");
-      if (composing_base != args.MemberEnd() && composing_base->value.IsInt())
-        state.composing.start = composing_base->value.GetInt();
-      auto composing_extent = args.FindMember("composingExtent");
-      if (composing_extent != args.MemberEnd() &&
-          composing_extent->value.IsInt())
-        state.composing.end = composing_extent->value.GetInt();
+      auto composing_base = args.Find("composingBase");
+      if (composing_base != nullptr && composing_base->IsInt())
+        state.composing.start = composing_base->int_value;
+      auto composing_extent = args.Find("composingExtent");
+      if (composing_extent != nullptr && composing_extent->IsInt())
+        state.composing.end = composing_extent->int_value;
       ime_->SetState(std::move(state));
     }
-  } else if (method->value == "TextInput.clearClient") {
+  } else if (method == "TextInput.clearClient") {
     current_text_input_client_ = 0;
     last_text_state_ = nullptr;
     DeactivateIme();
   } else {
     FML_DLOG(ERROR) << "Unknown " << message->channel() << " method "
-                    << method->value.GetString();
+                    << method;
   }
 }
 
 void PlatformView::HandleFlutterPlatformViewsChannelPlatformMessage(
     fml::RefPtr<flutter::PlatformMessage> message) {
   FML_DCHECK(message->channel() == kFlutterPlatformViewsChannel);
-  const auto& data = message->data();
-  rapidjson::Document document;
-  document.Parse(reinterpret_cast<const char*>(data.data()), data.size());
-  if (document.HasParseError() || !document.IsObject()) {
-    FXL_VLOG(2) << "Could not parse document";
-    return;
-  }
-  auto root = document.GetObject();
-  auto method = root.FindMember("method");
-  if (method == root.MemberEnd() || !method->value.IsString()) {
+  MethodCall call;
+  if (!call.Decode(message->data())) {
+    FXL_VLOG(2) << "Could not decode method call";
     return;
   }
 
-  if (method->value == "View.enableWireframe") {
-    auto args_it = root.FindMember("args");
-    if (args_it == root.MemberEnd() || !args_it->value.IsObject()) {
+  if (call.method() == "View.enableWireframe") {
+    const ChannelValue& args = call.args();
+    if (!args.IsMap()) {
       FXL_VLOG(2) << "No arguments found.";
       return;
     }
-    const auto& args = args_it->value;
 
-    auto enable = args.FindMember("enable");
-    if (!enable->value.IsBool()) {
+    auto enable = args.Find("enable");
+    if (enable == nullptr || !enable->IsBool()) {
       FXL_VLOG(2) << "Argument 'enable' is not a bool";
       return;
     }
 
-    wireframe_enabled_callback_(enable->value.GetBool());
+    wireframe_enabled_callback_(enable->bool_value);
   } else {
     FML_DLOG(ERROR) << "Unknown " << message->channel() << " method "
-                    << method->value.GetString();
+                    << call.method();
   }
 }
 
@@ -11,19 +11,28 @@
 #include <fuchsia/ui/input/cpp/fidl.h>
 #include <fuchsia/ui/scenic/cpp/fidl.h>
 #include <fuchsia/ui/views/cpp/fidl.h>
+#include <lib/async/cpp/task.h>
 #include <lib/fit/function.h>
 #include <lib/sys/cpp/service_directory.h>
 
 #include <map>
+#include <memory>
 #include <set>
+#include <vector>
 
 #include "accessibility_bridge.h"
+#include "channel_codec.h"
+#include "child_view_batch.h"
 #include "flutter/fml/macros.h"
 #include "flutter/lib/ui/window/viewport_metrics.h"
 #include "flutter/shell/common/platform_view.h"
+#include "frame_scheduler.h"
 #include "lib/fidl/cpp/binding.h"
 #include "lib/ui/scenic/cpp/id.h"
+#include "pointer_batch.h"
+#include "pointer_latch.h"
 #include "surface.h"
+#include "vsync_recorder.h"
 
 namespace flutter_runner {
 
@@ -56,12 +65,16 @@ class PlatformView final : public flutter::PlatformView,
                OnMetricsUpdate session_metrics_did_change_callback,
                OnSizeChangeHint session_size_change_hint_callback,
                OnEnableWireframe wireframe_enabled_callback,
-               zx_handle_t vsync_event_handle);
+               zx_handle_t vsync_event_handle,
+               std::shared_ptr<VsyncRecorder> vsync_recorder,
+               std::shared_ptr<FrameScheduler> frame_scheduler,
+               bool latch_pointer_input, bool merge_pointer_moves);
   PlatformView(PlatformView::Delegate& delegate, std::string debug_label,
                flutter::TaskRunners task_runners,
                fidl::InterfaceHandle<fuchsia::sys::ServiceProvider>
                    parent_environment_service_provider,
-               zx_handle_t vsync_event_handle);
+               zx_handle_t vsync_event_handle,
+               std::shared_ptr<VsyncRecorder> vsync_recorder);
 
   ~PlatformView();
 
@@ -85,6 +98,9 @@ class PlatformView final : public flutter::PlatformView,
   OnEnableWireframe wireframe_enabled_callback_;
 
   int current_text_input_client_ = 0;
+  // The encoding of the last message Flutter sent on the text input channel,
+  // which the messages we send on it match.
+  ChannelCodec text_input_codec_ = ChannelCodec::kJson;
   fidl::Binding<fuchsia::ui::input::InputMethodEditorClient> ime_client_;
   fuchsia::ui::input::InputMethodEditorPtr ime_;
   fuchsia::ui::input::ImeServicePtr text_sync_service_;
@@ -103,15 +119,40 @@ class PlatformView final : public flutter::PlatformView,
   std::unique_ptr<fuchsia::ui::input::TextInputState> last_text_state_;
 
   std::set<int> down_pointers_;
+  // Whether pointer moves are held back until just before the next frame
+  // starts.  See |PointerLatch|.
+  const bool latch_pointer_input_ = false;
+  // Whether consecutive moves of a pointer delivered together are merged.
+  // See |PointerBatch|.
+  const bool merge_pointer_moves_ = false;
+  PointerLatch pointer_latch_;
+  async::TaskClosure pointer_flush_task_;
+  // The vsync the held back pointer moves are predicted ahead to.
+  fml::TimePoint pointer_sample_time_;
+  // Viewport metrics changes are applied at most once a frame, just before
+  // it starts, since each one makes the framework lay out again.
+  async::TaskClosure metrics_flush_task_;
+  // Changes since the last flush, and in all how many were merged into a
+  // later one.
+  size_t pending_metrics_updates_ = 0;
+  size_t merged_metrics_updates_ = 0;
+  // Whether the metrics last flushed had a size and scale.
+  bool viewport_metrics_complete_ = false;
   std::map<
       std::string /* channel */,
       fit::function<void(
           fml::RefPtr<flutter::PlatformMessage> /* message */)> /* handler */>
       platform_message_handlers_;
   zx_handle_t vsync_event_handle_ = 0;
+  std::shared_ptr<VsyncRecorder> vsync_recorder_;
+  std::shared_ptr<FrameScheduler> frame_scheduler_;
 
   void RegisterPlatformMessageHandlers();
 
+  // Arranges for the viewport metrics to be flushed just before the next
+  // frame starts.
+  void ScheduleViewportMetricsFlush();
+
   void FlushViewportMetrics();
 
   // Called when the view's properties have changed.
@@ -130,11 +171,26 @@ class PlatformView final : public flutter::PlatformView,
   void OnScenicError(std::string error) override;
   void OnScenicEvent(std::vector<fuchsia::ui::scenic::Event> events) override;
 
-  void OnChildViewConnected(scenic::ResourceId view_holder_id);
-  void OnChildViewDisconnected(scenic::ResourceId view_holder_id);
-  void OnChildViewStateChanged(scenic::ResourceId view_holder_id, bool state);
+  // Sends the events in |batch| to the engine in one packet, if there are
+  // any.
+  void DispatchPointerBatch(PointerBatch* batch);
+
+  // Tells |flutter::SceneHost| about |events| in one UI thread task.
+  void DispatchChildViewEvents(std::vector<ChildViewEvent> events);
+
+  // Adds |pointer| to |batch|, or holds it back if pointer input is latched.
+  bool OnHandlePointerEvent(const fuchsia::ui::input::PointerEvent& pointer,
+                            PointerBatch* batch);
+
+  // Returns when the next frame is expected to start and be shown.
+  FrameScheduler::FrameTimes GetNextFrameTimes() const;
+
+  // Arranges for the held back pointer moves to be sent just before the next
+  // frame starts.
+  void SchedulePointerFlush();
 
-  bool OnHandlePointerEvent(const fuchsia::ui::input::PointerEvent& pointer);
+  // Sends the held back pointer moves, predicted ahead to |sample_time|.
+  void FlushPointerEvents(fml::TimePoint sample_time);
 
   bool OnHandleKeyboardEvent(const fuchsia::ui::input::KeyboardEvent& keyboard);
 
@@ -11,7 +11,9 @@
 #include <lib/gtest/real_loop_fixture.h>
 #include <lib/sys/cpp/testing/service_directory_provider.h>
 
+#include <algorithm>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "flutter/lib/ui/window/platform_message.h"
@@ -33,13 +35,22 @@ class MockPlatformViewDelegate : public flutter::PlatformView::Delegate {
   void OnPlatformViewSetNextFrameCallback(fml::closure closure) {}
   // |flutter::PlatformView::Delegate|
   void OnPlatformViewSetViewportMetrics(
-      const flutter::ViewportMetrics& metrics) {}
+      const flutter::ViewportMetrics& metrics) {
+    viewport_metrics_.push_back(metrics);
+  }
   // |flutter::PlatformView::Delegate|
   void OnPlatformViewDispatchPlatformMessage(
-      fml::RefPtr<flutter::PlatformMessage> message) {}
+      fml::RefPtr<flutter::PlatformMessage> message) {
+    dispatched_.push_back(message->channel());
+    messages_.push_back(std::move(message));
+  }
   // |flutter::PlatformView::Delegate|
   void OnPlatformViewDispatchPointerDataPacket(
-      std::unique_ptr<flutter::PointerDataPacket> packet) {}
+      std::unique_ptr<flutter::PointerDataPacket> packet) {
+    dispatched_.push_back(kPointerPacket);
+    pointer_packet_sizes_.push_back(packet->data().size() /
+                                    sizeof(flutter::PointerData));
+  }
   // |flutter::PlatformView::Delegate|
   void OnPlatformViewDispatchSemanticsAction(int32_t id,
                                              flutter::SemanticsAction action,
@@ -63,10 +74,87 @@ class MockPlatformViewDelegate : public flutter::PlatformView::Delegate {
   bool SemanticsEnabled() const { return semantics_enabled_; }
   int32_t SemanticsFeatures() const { return semantics_features_; }
 
+  // Stands for a pointer packet in |Dispatched|.
+  static constexpr char kPointerPacket[] = "<pointer packet>";
+
+  // The channels of the platform messages and the pointer packets sent to
+  // the engine, in order.
+  const std::vector<std::string>& Dispatched() const { return dispatched_; }
+  const std::vector<fml::RefPtr<flutter::PlatformMessage>>& Messages() const {
+    return messages_;
+  }
+  // The number of events in each pointer packet.
+  const std::vector<size_t>& PointerPacketSizes() const {
+    return pointer_packet_sizes_;
+  }
+  // The viewport metrics set on the engine, in order.
+  const std::vector<flutter::ViewportMetrics>& ViewportMetrics() const {
+    return viewport_metrics_;
+  }
+
  private:
   bool semantics_enabled_ = false;
   int32_t semantics_features_ = 0;
+  std::vector<std::string> dispatched_;
+  std::vector<fml::RefPtr<flutter::PlatformMessage>> messages_;
+  std::vector<size_t> pointer_packet_sizes_;
+  std::vector<flutter::ViewportMetrics> viewport_metrics_;
 };
+
+fuchsia::ui::scenic::Event MakePointerEvent(
+    uint64_t event_time, fuchsia::ui::input::PointerEventPhase phase) {
+  fuchsia::ui::input::PointerEvent pointer;
+  pointer.event_time = event_time;
+  pointer.device_id = 1;
+  pointer.pointer_id = 1;
+  pointer.type = fuchsia::ui::input::PointerEventType::MOUSE;
+  pointer.phase = phase;
+  fuchsia::ui::input::InputEvent input;
+  input.set_pointer(std::move(pointer));
+  fuchsia::ui::scenic::Event event;
+  event.set_input(std::move(input));
+  return event;
+}
+
+fuchsia::ui::scenic::Event MakeKeyboardEvent(uint64_t event_time) {
+  fuchsia::ui::input::KeyboardEvent keyboard;
+  keyboard.event_time = event_time;
+  keyboard.device_id = 2;
+  keyboard.phase = fuchsia::ui::input::KeyboardEventPhase::PRESSED;
+  keyboard.hid_usage = 4;
+  keyboard.code_point = 'a';
+  keyboard.modifiers = 0;
+  fuchsia::ui::input::InputEvent input;
+  input.set_keyboard(std::move(keyboard));
+  fuchsia::ui::scenic::Event event;
+  event.set_input(std::move(input));
+  return event;
+}
+
+fuchsia::ui::scenic::Event MakeMetricsEvent(float scale) {
+  fuchsia::ui::gfx::MetricsEvent metrics;
+  metrics.node_id = 1;
+  metrics.metrics.scale_x = scale;
+  metrics.metrics.scale_y = scale;
+  metrics.metrics.scale_z = scale;
+  fuchsia::ui::gfx::Event gfx;
+  gfx.set_metrics(std::move(metrics));
+  fuchsia::ui::scenic::Event event;
+  event.set_gfx(std::move(gfx));
+  return event;
+}
+
+fuchsia::ui::scenic::Event MakeViewPropertiesEvent(float width, float height) {
+  fuchsia::ui::gfx::ViewPropertiesChangedEvent properties_changed;
+  properties_changed.view_id = 1;
+  properties_changed.properties.bounding_box.max = {width, height, 0.f};
+  fuchsia::ui::gfx::Event gfx;
+  gfx.set_view_properties_changed(std::move(properties_changed));
+  fuchsia::ui::scenic::Event event;
+  event.set_gfx(std::move(gfx));
+  return event;
+}
+
 TEST_F(PlatformViewTests, SurvivesWhenSettingsManagerNotAvailable) {
   sys::testing::ServiceDirectoryProvider services_provider(dispatcher());
   MockPlatformViewDelegate delegate;
@@ -97,7 +185,11 @@ TEST_F(PlatformViewTests, SurvivesWhenSettingsManagerNotAvailable) {
       nullptr,  // session_metrics_did_change_callback
       nullptr,  // session_size_change_hint_callback
       nullptr,  // on_enable_wireframe_callback,
-      0u        // vsync_event_handle
+      0u,       // vsync_event_handle
+      std::make_shared<flutter_runner::VsyncRecorder>(),  // vsync_recorder
+      std::make_shared<flutter_runner::FrameScheduler>(),  // frame_scheduler
+      false,  // latch_pointer_input
+      false   // merge_pointer_moves
   );
 
   RunLoopUntilIdle();
@@ -147,7 +239,11 @@ TEST_F(PlatformViewTests, RegistersWatcherAndEnablesSemantics) {
       nullptr,  // session_metrics_did_change_callback
       nullptr,  // session_size_change_hint_callback
       nullptr,  // wireframe_enabled_callback
-      0u        // vsync_event_handle
+      0u,       // vsync_event_handle
+      std::make_shared<flutter_runner::VsyncRecorder>(),  // vsync_recorder
+      std::make_shared<flutter_runner::FrameScheduler>(),  // frame_scheduler
+      false,  // latch_pointer_input
+      false   // merge_pointer_moves
   );
 
   RunLoopUntilIdle();
@@ -202,7 +298,11 @@ TEST_F(PlatformViewTests, ChangesSettings) {
       nullptr,  // session_metrics_did_change_callback
       nullptr,  // session_size_change_hint_callback
       nullptr,  // wireframe_enabled_callback
-      0u        // vsync_event_handle
+      0u,       // vsync_event_handle
+      std::make_shared<flutter_runner::VsyncRecorder>(),  // vsync_recorder
+      std::make_shared<flutter_runner::FrameScheduler>(),  // frame_scheduler
+      false,  // latch_pointer_input
+      false   // merge_pointer_moves
   );
 
   RunLoopUntilIdle();
@@ -274,7 +374,11 @@ TEST_F(PlatformViewTests, RegistersWatcherAndSetsFeaturesWhenNoScreenReader) {
       nullptr,  // session_metrics_did_change_callback
       nullptr,  // session_size_change_hint_callback
       nullptr,  // wireframe_enabled_callback
-      0u        // vsync_event_handle
+      0u,       // vsync_event_handle
+      std::make_shared<flutter_runner::VsyncRecorder>(),  // vsync_recorder
+      std::make_shared<flutter_runner::FrameScheduler>(),  // frame_scheduler
+      false,  // latch_pointer_input
+      false   // merge_pointer_moves
   );
 
   RunLoopUntilIdle();
@@ -324,7 +428,11 @@ TEST_F(PlatformViewTests, EnableWireframeTest) {
       nullptr,                  // session_metrics_did_change_callback
       nullptr,                  // session_size_change_hint_callback
       EnableWireframeCallback,  // on_enable_wireframe_callback,
-      0u                        // vsync_event_handle
+      0u,                       // vsync_event_handle
+      std::make_shared<flutter_runner::VsyncRecorder>(),  // vsync_recorder
+      std::make_shared<flutter_runner::FrameScheduler>(),  // frame_scheduler
+      false,  // latch_pointer_input
+      false   // merge_pointer_moves
   );
 
   // Cast platform_view to its base view so we can have access to the public
@@ -353,4 +461,264 @@ TEST_F(PlatformViewTests, EnableWireframeTest) {
   EXPECT_TRUE(wireframe_enabled);
 }
 
+// Same as above, for a message in the standard binary encoding.
+TEST_F(PlatformViewTests, EnableWireframeStandardCodecTest) {
+  sys::testing::ServiceDirectoryProvider services_provider(dispatcher());
+  MockPlatformViewDelegate delegate;
+  zx::eventpair a, b;
+  zx::eventpair::create(/* flags */ 0u, &a, &b);
+  auto view_ref = fuchsia::ui::views::ViewRef({
+      .reference = std::move(a),
+  });
+  auto view_ref_control = fuchsia::ui::views::ViewRefControl({
+      .reference = std::move(b),
+  });
+  flutter::TaskRunners task_runners =
+      flutter::TaskRunners("test_runners", nullptr, nullptr, nullptr, nullptr);
+
+  // Test wireframe callback function. If the message sent to the platform view
+  // was properly handled and parsed, this function should be called, setting
+  // |wireframe_enabled| to true.
+  bool wireframe_enabled = false;
+  auto EnableWireframeCallback = [&wireframe_enabled](bool should_enable) {
+    wireframe_enabled = should_enable;
+  };
+
+  auto platform_view = flutter_runner::PlatformView(
+      delegate,                               // delegate
+      "test_platform_view",                   // label
+      std::move(view_ref_control),            // view_ref_control
+      std::move(view_ref),                    // view_refs
+      std::move(task_runners),                // task_runners
+      services_provider.service_directory(),  // runner_services
+      nullptr,                  // parent_environment_service_provider_handle
+      nullptr,                  // session_listener_request
+      nullptr,                  // on_session_listener_error_callback
+      nullptr,                  // session_metrics_did_change_callback
+      nullptr,                  // session_size_change_hint_callback
+      EnableWireframeCallback,  // on_enable_wireframe_callback,
+      0u,                       // vsync_event_handle
+      std::make_shared<flutter_runner::VsyncRecorder>(),  // vsync_recorder
+      std::make_shared<flutter_runner::FrameScheduler>(),  // frame_scheduler
+      false,  // latch_pointer_input
+      false   // merge_pointer_moves
+  );
+
+  // Cast platform_view to its base view so we can have access to the public
+  // "HandlePlatformMessage" function.
+  auto base_view = dynamic_cast<flutter::PlatformView*>(&platform_view);
+  EXPECT_TRUE(base_view);
+
+  flutter_runner::ChannelWriter writer(
+      flutter_runner::ChannelCodec::kStandard, 0);
+  writer.BeginMethodCall("View.enableWireframe");
+  writer.BeginMap(1);
+  writer.Key("enable");
+  writer.Bool(true);
+  writer.EndMap();
+
+  fml::RefPtr<flutter::PlatformMessage> message =
+      fml::MakeRefCounted<flutter::PlatformMessage>(
+          "flutter/platform_views",
+          writer.Finish(),
+          fml::RefPtr<flutter::PlatformMessageResponse>());
+  base_view->HandlePlatformMessage(message);
+
+  RunLoopUntilIdle();
+
+  EXPECT_TRUE(wireframe_enabled);
+}
+
+// A mouse reporting at 1kHz, which Scenic delivers in batches at 60Hz, makes
+// one pointer packet per batch rather than one per event.
+TEST_F(PlatformViewTests, DispatchesOnePointerPacketPerBatch) {
+  sys::testing::ServiceDirectoryProvider services_provider(dispatcher());
+  MockPlatformViewDelegate delegate;
+  zx::eventpair a, b;
+  zx::eventpair::create(/* flags */ 0u, &a, &b);
+  auto view_ref = fuchsia::ui::views::ViewRef({
+      .reference = std::move(a),
+  });
+  auto view_ref_control = fuchsia::ui::views::ViewRefControl({
+      .reference = std::move(b),
+  });
+  flutter::TaskRunners task_runners =
+      flutter::TaskRunners("test_runners", nullptr, nullptr, nullptr, nullptr);
+  fuchsia::ui::scenic::SessionListenerPtr session_listener;
+
+  auto platform_view = flutter_runner::PlatformView(
+      delegate,                               // delegate
+      "test_platform_view",                   // label
+      std::move(view_ref_control),            // view_ref_control
+      std::move(view_ref),                    // view_ref
+      std::move(task_runners),                // task_runners
+      services_provider.service_directory(),  // runner_services
+      nullptr,  // parent_environment_service_provider_handle
+      session_listener.NewRequest(),  // session_listener_request
+      nullptr,                        // on_session_listener_error_callback
+      nullptr,                        // session_metrics_did_change_callback
+      nullptr,                        // session_size_change_hint_callback
+      nullptr,                        // on_enable_wireframe_callback,
+      0u,                             // vsync_event_handle
+      std::make_shared<flutter_runner::VsyncRecorder>(),  // vsync_recorder
+      std::make_shared<flutter_runner::FrameScheduler>(),  // frame_scheduler
+      false,  // latch_pointer_input
+      false   // merge_pointer_moves
+  );
+
+  constexpr size_t kEventsPerSecond = 1000;
+  constexpr size_t kBatchesPerSecond = 60;
+  std::vector<size_t> batch_sizes;
+  fml::TimeDelta total_time = fml::TimeDelta::Zero();
+  fml::TimeDelta slowest_batch = fml::TimeDelta::Zero();
+  size_t next_event = 0;
+  for (size_t i = 1; i <= kBatchesPerSecond; i++) {
+    const size_t batch_end = i * kEventsPerSecond / kBatchesPerSecond;
+    std::vector<fuchsia::ui::scenic::Event> events;
+    for (; next_event < batch_end; next_event++) {
+      events.push_back(
+          MakePointerEvent(next_event * 1000000,
+                           fuchsia::ui::input::PointerEventPhase::MOVE));
+    }
+    batch_sizes.push_back(events.size());
+
+    const fml::TimePoint start = fml::TimePoint::Now();
+    session_listener->OnScenicEvent(std::move(events));
+    RunLoopUntilIdle();
+    const fml::TimeDelta batch_time = fml::TimePoint::Now() - start;
+    total_time = total_time + batch_time;
+    slowest_batch = std::max(slowest_batch, batch_time);
+  }
+
+  EXPECT_EQ(delegate.PointerPacketSizes(), batch_sizes);
+  RecordProperty("MeanBatchMicroseconds",
+                 static_cast<int>(total_time.ToMicroseconds() /
+                                  static_cast<int64_t>(kBatchesPerSecond)));
+  RecordProperty("SlowestBatchMicroseconds",
+                 static_cast<int>(slowest_batch.ToMicroseconds()));
+}
+
+// Pointer events batched ahead of another kind of event reach the engine
+// before it.
+TEST_F(PlatformViewTests, DispatchesPointerBatchBeforeOtherEvents) {
+  sys::testing::ServiceDirectoryProvider services_provider(dispatcher());
+  MockPlatformViewDelegate delegate;
+  zx::eventpair a, b;
+  zx::eventpair::create(/* flags */ 0u, &a, &b);
+  auto view_ref = fuchsia::ui::views::ViewRef({
+      .reference = std::move(a),
+  });
+  auto view_ref_control = fuchsia::ui::views::ViewRefControl({
+      .reference = std::move(b),
+  });
+  flutter::TaskRunners task_runners =
+      flutter::TaskRunners("test_runners", nullptr, nullptr, nullptr, nullptr);
+  fuchsia::ui::scenic::SessionListenerPtr session_listener;
+
+  auto platform_view = flutter_runner::PlatformView(
+      delegate,                               // delegate
+      "test_platform_view",                   // label
+      std::move(view_ref_control),            // view_ref_control
+      std::move(view_ref),                    // view_ref
+      std::move(task_runners),                // task_runners
+      services_provider.service_directory(),  // runner_services
+      nullptr,  // parent_environment_service_provider_handle
+      session_listener.NewRequest(),  // session_listener_request
+      nullptr,                        // on_session_listener_error_callback
+      nullptr,                        // session_metrics_did_change_callback
+      nullptr,                        // session_size_change_hint_callback
+      nullptr,                        // on_enable_wireframe_callback,
+      0u,                             // vsync_event_handle
+      std::make_shared<flutter_runner::VsyncRecorder>(),  // vsync_recorder
+      std::make_shared<flutter_runner::FrameScheduler>(),  // frame_scheduler
+      false,  // latch_pointer_input
+      false   // merge_pointer_moves
+  );
+
+  std::vector<fuchsia::ui::scenic::Event> events;
+  events.push_back(
+      MakePointerEvent(1000, fuchsia::ui::input::PointerEventPhase::DOWN));
+  events.push_back(
+      MakePointerEvent(2000, fuchsia::ui::input::PointerEventPhase::MOVE));
+  events.push_back(MakeKeyboardEvent(3000));
+  events.push_back(
+      MakePointerEvent(4000, fuchsia::ui::input::PointerEventPhase::UP));
+  session_listener->OnScenicEvent(std::move(events));
+  RunLoopUntilIdle();
+
+  const std::vector<std::string> expected = {
+      MockPlatformViewDelegate::kPointerPacket,
+      "flutter/keyevent",
+      MockPlatformViewDelegate::kPointerPacket,
+  };
+  EXPECT_EQ(delegate.Dispatched(), expected);
+  EXPECT_EQ(delegate.PointerPacketSizes(), std::vector<size_t>({2, 1}));
+}
+
+// Metrics and properties changes that arrive within one frame reach the
+// engine as a single viewport metrics update, carrying the latest of each.
+TEST_F(PlatformViewTests, SetsViewportMetricsOncePerFrame) {
+  sys::testing::ServiceDirectoryProvider services_provider(dispatcher());
+  MockPlatformViewDelegate delegate;
+  zx::eventpair a, b;
+  zx::eventpair::create(/* flags */ 0u, &a, &b);
+  auto view_ref = fuchsia::ui::views::ViewRef({
+      .reference = std::move(a),
+  });
+  auto view_ref_control = fuchsia::ui::views::ViewRefControl({
+      .reference = std::move(b),
+  });
+  flutter::TaskRunners task_runners =
+      flutter::TaskRunners("test_runners", nullptr, nullptr, nullptr, nullptr);
+  fuchsia::ui::scenic::SessionListenerPtr session_listener;
+  flutter_runner::OnMetricsUpdate on_metrics_update =
+      [](const fuchsia::ui::gfx::Metrics&) {};
+
+  auto platform_view = flutter_runner::PlatformView(
+      delegate,                               // delegate
+      "test_platform_view",                   // label
+      std::move(view_ref_control),            // view_ref_control
+      std::move(view_ref),                    // view_ref
+      std::move(task_runners),                // task_runners
+      services_provider.service_directory(),  // runner_services
+      nullptr,  // parent_environment_service_provider_handle
+      session_listener.NewRequest(),  // session_listener_request
+      nullptr,  // on_session_listener_error_callback
+      std::move(on_metrics_update),  // session_metrics_did_change_callback
+      nullptr,                       // session_size_change_hint_callback
+      nullptr,                       // on_enable_wireframe_callback,
+      0u,                            // vsync_event_handle
+      std::make_shared<flutter_runner::VsyncRecorder>(),  // vsync_recorder
+      std::make_shared<flutter_runner::FrameScheduler>(),  // frame_scheduler
+      false,  // latch_pointer_input
+      false   // merge_pointer_moves
+  );
+
+  // Until the view has a size and scale, every change goes through.
+  std::vector<fuchsia::ui::scenic::Event> first_events;
+  first_events.push_back(MakeMetricsEvent(1.f));
+  first_events.push_back(MakeViewPropertiesEvent(100.f, 100.f));
+  session_listener->OnScenicEvent(std::move(first_events));
+  RunLoopUntilIdle();
+  ASSERT_EQ(delegate.ViewportMetrics().size(), 2u);
+
+  std::vector<fuchsia::ui::scenic::Event> events;
+  events.push_back(MakeViewPropertiesEvent(200.f, 100.f));
+  events.push_back(MakeMetricsEvent(2.f));
+  events.push_back(MakeViewPropertiesEvent(300.f, 100.f));
+  events.push_back(MakeMetricsEvent(3.f));
+  session_listener->OnScenicEvent(std::move(events));
+  RunLoopWithTimeoutOrUntil(
+      [&delegate] { return delegate.ViewportMetrics().size() > 2u; },
+      zx::sec(1));
+  // Nothing else is pending.
+  RunLoopWithTimeout(zx::msec(50));
+
+  ASSERT_EQ(delegate.ViewportMetrics().size(), 3u);
+  const flutter::ViewportMetrics& metrics = delegate.ViewportMetrics().back();
+  EXPECT_EQ(metrics.device_pixel_ratio, 3.0);
+  EXPECT_EQ(metrics.physical_width, 900.0);
+  EXPECT_EQ(metrics.physical_height, 300.0);
+}
+
 }  // namespace flutter_runner_test::flutter_runner_a11y_test
@@ -0,0 +1,44 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/pointer_batch.h"
+
+namespace flutter_runner {
+
+namespace {
+
+bool IsMove(const flutter::PointerData& data) {
+  return data.change == flutter::PointerData::Change::kMove ||
+         data.change == flutter::PointerData::Change::kHover;
+}
+
+}  // namespace
+
+PointerBatch::PointerBatch(bool merge_moves) : merge_moves_(merge_moves) {}
+
+PointerBatch::~PointerBatch() = default;
+
+void PointerBatch::Add(const flutter::PointerData& data) {
+  if (merge_moves_ && IsMove(data) && !events_.empty()) {
+    flutter::PointerData& last = events_.back();
+    if (last.change == data.change && last.device == data.device &&
+        last.buttons == data.buttons) {
+      last = data;
+      merged_++;
+      return;
+    }
+  }
+  events_.push_back(data);
+}
+
+std::unique_ptr<flutter::PointerDataPacket> PointerBatch::TakePacket() {
+  auto packet = std::make_unique<flutter::PointerDataPacket>(events_.size());
+  for (size_t i = 0; i < events_.size(); i++) {
+    packet->SetPointerData(i, events_[i]);
+  }
+  events_.clear();
+  return packet;
+}
+
+}  // namespace flutter_runner
@@ -0,0 +1,54 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_POINTER_BATCH_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_POINTER_BATCH_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "flutter/fml/macros.h"
+#include "flutter/lib/ui/window/pointer_data.h"
+#include "flutter/lib/ui/window/pointer_data_packet.h"
+
+namespace flutter_runner {
+
+// Gathers the pointer events Scenic delivers together into one packet, so
+// that the engine gets one UI thread task per batch rather than one per
+// event.
+//
+// With |merge_moves|, a move or hover that directly follows one of the same
+// kind from the same pointer, with the same buttons, replaces it.  That
+// keeps only the latest position of a fast mouse, at the cost of the samples
+// in between that velocity tracking would otherwise see.
+class PointerBatch final {
+ public:
+  explicit PointerBatch(bool merge_moves);
+
+  ~PointerBatch();
+
+  bool empty() const { return events_.empty(); }
+
+  size_t size() const { return events_.size(); }
+
+  // Number of events replaced by a later one.
+  size_t merged() const { return merged_; }
+
+  void Add(const flutter::PointerData& data);
+
+  // Returns a packet of the events added since the last call, in order.
+  std::unique_ptr<flutter::PointerDataPacket> TakePacket();
+
+ private:
+  const bool merge_moves_;
+  std::vector<flutter::PointerData> events_;
+  size_t merged_ = 0;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(PointerBatch);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_POINTER_BATCH_H_
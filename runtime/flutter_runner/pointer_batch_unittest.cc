@@ -0,0 +1,77 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/pointer_batch.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+namespace flutter_runner_test {
+
+using flutter::PointerData;
+using flutter_runner::PointerBatch;
+
+namespace {
+
+PointerData MakeEvent(PointerData::Change change, int64_t device,
+                      int64_t time_micros, double x) {
+  PointerData data;
+  data.Clear();
+  data.change = change;
+  data.device = device;
+  data.time_stamp = time_micros;
+  data.physical_x = x;
+  return data;
+}
+
+std::vector<PointerData> Unpack(const flutter::PointerDataPacket& packet) {
+  std::vector<PointerData> events(packet.data().size() / sizeof(PointerData));
+  if (!events.empty()) {
+    memcpy(events.data(), packet.data().data(), packet.data().size());
+  }
+  return events;
+}
+
+}  // namespace
+
+TEST(PointerBatchTest, KeepsEventsInOrder) {
+  PointerBatch batch(false);
+  batch.Add(MakeEvent(PointerData::Change::kDown, 1, 0, 0));
+  batch.Add(MakeEvent(PointerData::Change::kMove, 1, 1, 1));
+  batch.Add(MakeEvent(PointerData::Change::kMove, 1, 2, 2));
+  batch.Add(MakeEvent(PointerData::Change::kUp, 1, 3, 2));
+  EXPECT_EQ(batch.size(), 4u);
+
+  auto events = Unpack(*batch.TakePacket());
+  ASSERT_EQ(events.size(), 4u);
+  for (size_t i = 0; i < events.size(); i++) {
+    EXPECT_EQ(events[i].time_stamp, static_cast<int64_t>(i));
+  }
+  EXPECT_TRUE(batch.empty());
+  EXPECT_EQ(batch.merged(), 0u);
+}
+
+TEST(PointerBatchTest, MergesConsecutiveMovesOfOnePointer) {
+  PointerBatch batch(true);
+  batch.Add(MakeEvent(PointerData::Change::kDown, 1, 0, 0));
+  batch.Add(MakeEvent(PointerData::Change::kMove, 1, 1, 1));
+  batch.Add(MakeEvent(PointerData::Change::kMove, 1, 2, 2));
+  batch.Add(MakeEvent(PointerData::Change::kMove, 2, 3, 5));
+  batch.Add(MakeEvent(PointerData::Change::kMove, 1, 4, 4));
+  batch.Add(MakeEvent(PointerData::Change::kMove, 1, 5, 5));
+  batch.Add(MakeEvent(PointerData::Change::kUp, 1, 6, 5));
+
+  auto events = Unpack(*batch.TakePacket());
+  ASSERT_EQ(events.size(), 5u);
+  EXPECT_EQ(events[1].time_stamp, 2);
+  EXPECT_EQ(events[1].physical_x, 2);
+  EXPECT_EQ(events[2].device, 2);
+  EXPECT_EQ(events[3].time_stamp, 5);
+  EXPECT_EQ(events[4].change, PointerData::Change::kUp);
+  EXPECT_EQ(batch.merged(), 2u);
+}
+
+}  // namespace flutter_runner_test
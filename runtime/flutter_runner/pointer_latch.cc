@@ -0,0 +1,86 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/pointer_latch.h"
+
+#include <algorithm>
+
+#include "flutter/fml/logging.h"
+
+namespace flutter_runner {
+
+PointerLatch::PointerLatch() = default;
+
+PointerLatch::~PointerLatch() = default;
+
+bool PointerLatch::IsLatched(const flutter::PointerData& data) {
+  return data.change == flutter::PointerData::Change::kMove ||
+         data.change == flutter::PointerData::Change::kHover;
+}
+
+void PointerLatch::Add(const flutter::PointerData& data) {
+  FML_DCHECK(IsLatched(data));
+  pending_.push_back(data);
+}
+
+std::vector<flutter::PointerData> PointerLatch::Flush(
+    fml::TimePoint sample_time) {
+  std::vector<flutter::PointerData> events = std::move(pending_);
+  pending_.clear();
+
+  // Pointer data times are in microseconds on the monotonic clock, which is
+  // the clock |fml::TimePoint| reads.
+  const int64_t sample_micros = sample_time.ToEpochDelta().ToMicroseconds();
+  std::unordered_map<int64_t, size_t> last_events;
+  for (size_t i = 0; i < events.size(); i++) {
+    last_events[events[i].device] = i;
+  }
+
+  for (size_t i = 0; i < events.size(); i++) {
+    flutter::PointerData& data = events[i];
+    const Sample sample = {data.time_stamp, data.physical_x, data.physical_y};
+    auto pointer = pointers_.find(data.device);
+    if (last_events[data.device] == i && pointer != pointers_.end() &&
+        pointer->second.has_last_sample) {
+      const Sample& previous = pointer->second.last_sample;
+      const int64_t interval = sample.time_stamp - previous.time_stamp;
+      const int64_t lead =
+          std::min({sample_micros - sample.time_stamp,
+                    kMaxPrediction.ToMicroseconds(), interval / 2});
+      if (interval > 0 && lead > 0) {
+        const double scale = static_cast<double>(lead) / interval;
+        data.physical_x += (sample.physical_x - previous.physical_x) * scale;
+        data.physical_y += (sample.physical_y - previous.physical_y) * scale;
+        data.time_stamp += lead;
+      }
+    }
+    Send(&data, sample);
+  }
+  return events;
+}
+
+void PointerLatch::Pass(flutter::PointerData* data) {
+  Send(data, {data->time_stamp, data->physical_x, data->physical_y});
+}
+
+void PointerLatch::Send(flutter::PointerData* data, const Sample& sample) {
+  if (data->change == flutter::PointerData::Change::kRemove) {
+    auto pointer = pointers_.find(data->device);
+    if (pointer != pointers_.end()) {
+      data->time_stamp =
+          std::max(data->time_stamp, pointer->second.last_sent_time);
+      pointers_.erase(pointer);
+    }
+    return;
+  }
+  Pointer& pointer = pointers_[data->device];
+  if (pointer.has_last_sample) {
+    data->time_stamp = std::max(data->time_stamp, pointer.last_sent_time);
+  }
+  pointer.last_sample = sample;
+  pointer.has_last_sample = true;
+  pointer.last_sent_time = data->time_stamp;
+}
+
+}  // namespace flutter_runner
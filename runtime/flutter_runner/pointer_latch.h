@@ -0,0 +1,83 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_POINTER_LATCH_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_POINTER_LATCH_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "flutter/fml/macros.h"
+#include "flutter/fml/time/time_delta.h"
+#include "flutter/fml/time/time_point.h"
+#include "flutter/lib/ui/window/pointer_data.h"
+
+namespace flutter_runner {
+
+// Holds pointer moves back until just before a frame is built, so that a
+// move which arrives right after a frame started is not a whole frame late
+// by the time the frame that shows it starts.
+//
+// When the moves are flushed, the last one of each pointer is moved ahead
+// along the pointer's recent velocity to where it is predicted to be when the
+// frame is shown.  The prediction reaches at most |kMaxPrediction| ahead,
+// and at most half the time between the pointer's last two samples, so that
+// a pointer which changes direction overshoots by little.  Event times stay
+// increasing per pointer, so later events are sent no earlier than a
+// prediction that went past them.
+//
+// Other events, such as downs and ups, are not held back, but the moves
+// buffered before them are flushed first so that events stay in order.
+class PointerLatch final {
+ public:
+  static constexpr fml::TimeDelta kMaxPrediction =
+      fml::TimeDelta::FromMilliseconds(8);
+
+  PointerLatch();
+
+  ~PointerLatch();
+
+  // Whether |data| is held back rather than sent right away.
+  static bool IsLatched(const flutter::PointerData& data);
+
+  bool empty() const { return pending_.empty(); }
+
+  // Holds back |data|, for which |IsLatched| is true.
+  void Add(const flutter::PointerData& data);
+
+  // Returns the held back events in order, with the last one of each pointer
+  // predicted ahead to |sample_time|, and forgets them.
+  std::vector<flutter::PointerData> Flush(fml::TimePoint sample_time);
+
+  // Prepares |data|, which is sent right away, after |Flush|.
+  void Pass(flutter::PointerData* data);
+
+ private:
+  struct Sample {
+    int64_t time_stamp = 0;
+    double physical_x = 0;
+    double physical_y = 0;
+  };
+
+  struct Pointer {
+    // The last sample sent, before any prediction.
+    Sample last_sample;
+    bool has_last_sample = false;
+    // The time of the last event sent.
+    int64_t last_sent_time = 0;
+  };
+
+  std::vector<flutter::PointerData> pending_;
+  std::unordered_map<int64_t, Pointer> pointers_;
+
+  // Keeps |data| after the last event sent for its pointer, and records it.
+  void Send(flutter::PointerData* data, const Sample& sample);
+
+  FML_DISALLOW_COPY_AND_ASSIGN(PointerLatch);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_POINTER_LATCH_H_
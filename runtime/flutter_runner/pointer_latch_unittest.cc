@@ -0,0 +1,114 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/pointer_latch.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace flutter_runner_test {
+
+using flutter::PointerData;
+using flutter_runner::PointerLatch;
+
+namespace {
+
+PointerData MakeEvent(PointerData::Change change, int64_t device,
+                      int64_t time_micros, double x, double y) {
+  PointerData data;
+  data.Clear();
+  data.change = change;
+  data.device = device;
+  data.time_stamp = time_micros;
+  data.physical_x = x;
+  data.physical_y = y;
+  return data;
+}
+
+fml::TimePoint Micros(int64_t micros) {
+  return fml::TimePoint::FromEpochDelta(
+      fml::TimeDelta::FromMicroseconds(micros));
+}
+
+}  // namespace
+
+TEST(PointerLatchTest, LatchesOnlyMoves) {
+  EXPECT_TRUE(PointerLatch::IsLatched(
+      MakeEvent(PointerData::Change::kMove, 0, 0, 0, 0)));
+  EXPECT_TRUE(PointerLatch::IsLatched(
+      MakeEvent(PointerData::Change::kHover, 0, 0, 0, 0)));
+  EXPECT_FALSE(PointerLatch::IsLatched(
+      MakeEvent(PointerData::Change::kDown, 0, 0, 0, 0)));
+  EXPECT_FALSE(PointerLatch::IsLatched(
+      MakeEvent(PointerData::Change::kUp, 0, 0, 0, 0)));
+}
+
+TEST(PointerLatchTest, PredictsTheLastMoveOfEachPointer) {
+  PointerLatch latch;
+  PointerData down = MakeEvent(PointerData::Change::kDown, 1, 0, 0, 0);
+  latch.Pass(&down);
+  latch.Add(MakeEvent(PointerData::Change::kMove, 1, 8000, 8, 0));
+  latch.Add(MakeEvent(PointerData::Change::kMove, 2, 9000, 0, 0));
+  latch.Add(MakeEvent(PointerData::Change::kMove, 1, 16000, 16, 0));
+  EXPECT_FALSE(latch.empty());
+
+  auto events = latch.Flush(Micros(20000));
+  EXPECT_TRUE(latch.empty());
+  ASSERT_EQ(events.size(), 3u);
+  // Earlier moves are sent as they are.
+  EXPECT_EQ(events[0].time_stamp, 8000);
+  EXPECT_EQ(events[0].physical_x, 8);
+  // A pointer without history is not predicted.
+  EXPECT_EQ(events[1].time_stamp, 9000);
+  // The last move is predicted ahead by half its sample interval at most.
+  EXPECT_EQ(events[2].time_stamp, 20000);
+  EXPECT_DOUBLE_EQ(events[2].physical_x, 20);
+}
+
+TEST(PointerLatchTest, LimitsPrediction) {
+  PointerLatch latch;
+  latch.Add(MakeEvent(PointerData::Change::kMove, 1, 0, 0, 0));
+  latch.Add(MakeEvent(PointerData::Change::kMove, 1, 40000, 40, 40));
+  auto events = latch.Flush(Micros(100000));
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(events[1].time_stamp,
+            40000 + PointerLatch::kMaxPrediction.ToMicroseconds());
+  EXPECT_DOUBLE_EQ(events[1].physical_x, 48);
+  EXPECT_DOUBLE_EQ(events[1].physical_y, 48);
+
+  // Nothing is predicted into the past.
+  latch.Add(MakeEvent(PointerData::Change::kMove, 1, 60000, 60, 60));
+  events = latch.Flush(Micros(50000));
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].time_stamp, 60000);
+  EXPECT_DOUBLE_EQ(events[0].physical_x, 60);
+}
+
+TEST(PointerLatchTest, KeepsTimesIncreasingAfterPrediction) {
+  PointerLatch latch;
+  latch.Add(MakeEvent(PointerData::Change::kMove, 1, 0, 0, 0));
+  latch.Add(MakeEvent(PointerData::Change::kMove, 1, 16000, 16, 0));
+  auto events = latch.Flush(Micros(30000));
+  ASSERT_EQ(events.size(), 2u);
+  EXPECT_EQ(events[1].time_stamp, 24000);
+
+  // The up happened before the time the move was predicted to.
+  PointerData up = MakeEvent(PointerData::Change::kUp, 1, 20000, 20, 0);
+  latch.Pass(&up);
+  EXPECT_EQ(up.time_stamp, 24000);
+  EXPECT_EQ(up.physical_x, 20);
+
+  // The next touch predicts from its down, not the earlier moves.
+  PointerData down = MakeEvent(PointerData::Change::kDown, 1, 50000, 0, 0);
+  latch.Pass(&down);
+  EXPECT_EQ(down.time_stamp, 50000);
+  latch.Add(MakeEvent(PointerData::Change::kMove, 1, 52000, 0, 2));
+  events = latch.Flush(Micros(60000));
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].time_stamp, 53000);
+  EXPECT_DOUBLE_EQ(events[0].physical_y, 3);
+}
+
+}  // namespace flutter_runner_test
@@ -0,0 +1,49 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/present_throttle.h"
+
+#include <algorithm>
+
+#include "flutter/fml/logging.h"
+
+namespace flutter_runner {
+
+PresentThrottle::PresentThrottle(size_t max_presents_in_flight,
+                                 fit::closure present,
+                                 fit::function<void(bool)> set_vsync_signal)
+    : max_presents_in_flight_(std::max<size_t>(max_presents_in_flight, 1)),
+      present_(std::move(present)),
+      set_vsync_signal_(std::move(set_vsync_signal)) {}
+
+PresentThrottle::~PresentThrottle() = default;
+
+void PresentThrottle::OnFrame() {
+  if (presents_in_flight_ < max_presents_in_flight_) {
+    Present();
+    return;
+  }
+  // Throttle vsync while the pipeline is full.  The paint tasks of this frame
+  // still execute in parallel with the presents in flight, but no more work
+  // gets queued.
+  frame_pending_ = true;
+  set_vsync_signal_(false);
+}
+
+void PresentThrottle::OnPresentCompleted() {
+  FML_DCHECK(presents_in_flight_ > 0);
+  presents_in_flight_--;
+  if (frame_pending_) {
+    frame_pending_ = false;
+    Present();
+  }
+  set_vsync_signal_(true);
+}
+
+void PresentThrottle::Present() {
+  presents_in_flight_++;
+  present_();
+}
+
+}  // namespace flutter_runner
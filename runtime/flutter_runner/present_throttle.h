@@ -0,0 +1,64 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_PRESENT_THROTTLE_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_PRESENT_THROTTLE_H_
+
+#include <lib/fit/function.h>
+
+#include <cstddef>
+
+#include "flutter/fml/macros.h"
+
+namespace flutter_runner {
+
+// Decides when |SessionConnection| calls |Session::Present|, and applies
+// back-pressure to the vsync waiter when Scenic falls behind.
+//
+// Up to |max_presents_in_flight| presents may be waiting for their
+// presentation callback.  A frame that arrives when that many are in flight
+// is held back until the oldest one completes, and the vsync signal is
+// lowered meanwhile so that no further frame starts.  Frames held back
+// together go out in one present, in the order their updates were enqueued.
+//
+// A depth of 1 paints one frame while the previous one is being presented,
+// which has the lowest latency.  Larger depths let throughput-bound content
+// overlap more frames at the cost of latency.
+class PresentThrottle final {
+ public:
+  static constexpr size_t kDefaultMaxPresentsInFlight = 1;
+
+  // |present| must call |Session::Present| and arrange for
+  // |OnPresentCompleted| to be called from its callback.  |set_vsync_signal|
+  // raises or lowers the signal the vsync waiter waits on.
+  PresentThrottle(size_t max_presents_in_flight, fit::closure present,
+                  fit::function<void(bool)> set_vsync_signal);
+
+  ~PresentThrottle();
+
+  // The session updates of a frame have been enqueued.
+  void OnFrame();
+
+  // Scenic has called back for the oldest present in flight.
+  void OnPresentCompleted();
+
+  size_t max_presents_in_flight() const { return max_presents_in_flight_; }
+  size_t presents_in_flight() const { return presents_in_flight_; }
+  bool frame_pending() const { return frame_pending_; }
+
+ private:
+  void Present();
+
+  const size_t max_presents_in_flight_;
+  fit::closure present_;
+  fit::function<void(bool)> set_vsync_signal_;
+  size_t presents_in_flight_ = 0;
+  bool frame_pending_ = false;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(PresentThrottle);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_PRESENT_THROTTLE_H_
@@ -0,0 +1,153 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/present_throttle.h"
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <vector>
+
+namespace flutter_runner_test {
+
+using flutter_runner::PresentThrottle;
+
+namespace {
+
+// Stands in for |scenic::Session|: enqueued commands are batched by
+// |Present|, and presentation callbacks run in order when the test completes
+// them.
+class FakeSession {
+ public:
+  void Enqueue(int command) { enqueued_.push_back(command); }
+
+  void Present(fit::closure callback) {
+    presented_.push_back(std::move(enqueued_));
+    enqueued_.clear();
+    callbacks_.push_back(std::move(callback));
+  }
+
+  void CompleteOldestPresent() {
+    ASSERT_FALSE(callbacks_.empty());
+    auto callback = std::move(callbacks_.front());
+    callbacks_.pop_front();
+    callback();
+  }
+
+  size_t presents_in_flight() const { return callbacks_.size(); }
+
+  // The commands of each present, in the order they were presented.
+  const std::vector<std::vector<int>>& presented() const { return presented_; }
+
+ private:
+  std::vector<int> enqueued_;
+  std::vector<std::vector<int>> presented_;
+  std::deque<fit::closure> callbacks_;
+};
+
+// Wires a |PresentThrottle| to a |FakeSession| the way |SessionConnection|
+// wires it to Scenic.
+class Connection {
+ public:
+  explicit Connection(size_t max_presents_in_flight)
+      : throttle_(
+            max_presents_in_flight,
+            [this] {
+              session_.Present([this] { throttle_.OnPresentCompleted(); });
+            },
+            [this](bool raise) { vsync_signal_ = raise; }) {}
+
+  // Mirrors |SessionConnection::Present|.
+  void Frame(int command) {
+    session_.Enqueue(command);
+    throttle_.OnFrame();
+  }
+
+  FakeSession& session() { return session_; }
+  PresentThrottle& throttle() { return throttle_; }
+  bool vsync_signal() const { return vsync_signal_; }
+
+ private:
+  FakeSession session_;
+  PresentThrottle throttle_;
+  bool vsync_signal_ = true;
+};
+
+}  // namespace
+
+TEST(PresentThrottleTest, DepthOneHoldsBackSecondFrame) {
+  Connection connection(1);
+
+  connection.Frame(1);
+  EXPECT_EQ(connection.session().presents_in_flight(), 1u);
+  EXPECT_TRUE(connection.vsync_signal());
+
+  // The pipeline is full, so the frame waits and vsync is throttled.
+  connection.Frame(2);
+  EXPECT_EQ(connection.session().presents_in_flight(), 1u);
+  EXPECT_TRUE(connection.throttle().frame_pending());
+  EXPECT_FALSE(connection.vsync_signal());
+
+  connection.session().CompleteOldestPresent();
+  EXPECT_FALSE(connection.throttle().frame_pending());
+  EXPECT_EQ(connection.session().presents_in_flight(), 1u);
+  EXPECT_TRUE(connection.vsync_signal());
+
+  connection.session().CompleteOldestPresent();
+  EXPECT_EQ(connection.session().presents_in_flight(), 0u);
+  EXPECT_EQ(connection.session().presented(),
+            (std::vector<std::vector<int>>{{1}, {2}}));
+}
+
+TEST(PresentThrottleTest, DeeperPipelineKeepsMorePresentsInFlight) {
+  Connection connection(3);
+
+  for (int frame = 1; frame <= 3; frame++) {
+    connection.Frame(frame);
+    EXPECT_TRUE(connection.vsync_signal());
+  }
+  EXPECT_EQ(connection.session().presents_in_flight(), 3u);
+
+  connection.Frame(4);
+  EXPECT_EQ(connection.session().presents_in_flight(), 3u);
+  EXPECT_FALSE(connection.vsync_signal());
+
+  connection.session().CompleteOldestPresent();
+  EXPECT_EQ(connection.session().presents_in_flight(), 3u);
+  EXPECT_TRUE(connection.vsync_signal());
+
+  // Completing presents without new frames drains the pipeline.
+  for (int i = 0; i < 3; i++) {
+    connection.session().CompleteOldestPresent();
+  }
+  EXPECT_EQ(connection.throttle().presents_in_flight(), 0u);
+  EXPECT_EQ(connection.session().presented(),
+            (std::vector<std::vector<int>>{{1}, {2}, {3}, {4}}));
+}
+
+TEST(PresentThrottleTest, HeldBackFramesShareOnePresentInOrder) {
+  Connection connection(2);
+
+  connection.Frame(1);
+  connection.Frame(2);
+  // Frames that arrive despite the throttled signal are batched.
+  connection.Frame(3);
+  connection.Frame(4);
+  EXPECT_EQ(connection.session().presents_in_flight(), 2u);
+
+  connection.session().CompleteOldestPresent();
+  connection.session().CompleteOldestPresent();
+  connection.session().CompleteOldestPresent();
+  EXPECT_EQ(connection.session().presented(),
+            (std::vector<std::vector<int>>{{1}, {2}, {3, 4}}));
+}
+
+TEST(PresentThrottleTest, ZeroDepthMeansOne) {
+  Connection connection(0);
+  EXPECT_EQ(connection.throttle().max_presents_in_flight(), 1u);
+  connection.Frame(1);
+  EXPECT_EQ(connection.session().presents_in_flight(), 1u);
+}
+
+}  // namespace flutter_runner_test
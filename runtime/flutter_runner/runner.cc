@@ -6,6 +6,7 @@
 
 #include <fuchsia/mem/cpp/fidl.h>
 #include <lib/async/cpp/task.h>
+#include <lib/vfs/cpp/vmo_file.h>
 #include <trace-engine/instrumentation.h>
 #include <zircon/status.h>
 #include <zircon/types.h>
@@ -116,6 +117,13 @@ Runner::Runner(async::Loop* loop)
   SetupTraceObserver();
 #endif  // !defined(DART_PRODUCT)
 
+  zx::vmo inspect_vmo = inspector_.DuplicateVmo();
+  uint64_t inspect_vmo_size = 0;
+  inspect_vmo.get_size(&inspect_vmo_size);
+  context_->outgoing()->debug_dir()->AddEntry(
+      "root.inspect", std::make_unique<vfs::VmoFile>(std::move(inspect_vmo), 0,
+                                                     inspect_vmo_size));
+
   SkGraphics::Init();
 
   SetupICU();
@@ -183,12 +191,15 @@ void Runner::StartComponent(
         });
       };
 
+  // The same component may run more than once, so its URL is made unique.
   auto thread_application_pair = Application::Create(
       std::move(termination_callback),  // termination callback
       std::move(package),               // application pacakge
       std::move(startup_info),          // startup info
       context_->svc(),                  // runner incoming services
-      std::move(controller)             // controller request
+      std::move(controller),            // controller request
+      inspector_.GetRoot().CreateChild(
+          inspect::UniqueName(url_copy + "-"))  // inspect node
   );
 
   auto key = thread_application_pair.second.get();
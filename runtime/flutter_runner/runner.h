@@ -7,6 +7,7 @@
 
 #include <fuchsia/sys/cpp/fidl.h>
 #include <lib/async-loop/cpp/loop.h>
+#include <lib/inspect/cpp/inspect.h>
 #include <lib/sys/cpp/component_context.h>
 #include <trace-engine/instrumentation.h>
 #include <trace/observer.h>
@@ -45,6 +46,9 @@ class Runner final : public fuchsia::sys::Runner {
   };
 
   std::unique_ptr<sys::ComponentContext> context_;
+  // Frame timings of every engine in the process, published under the
+  // runner's debug directory.
+  inspect::Inspector inspector_;
   fidl::BindingSet<fuchsia::sys::Runner> active_applications_bindings_;
   std::unordered_map<const Application*, ActiveApplication>
       active_applications_;
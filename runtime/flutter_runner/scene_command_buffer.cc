@@ -0,0 +1,218 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/scene_command_buffer.h"
+
+#include <lib/fidl/cpp/clone.h>
+#include <lib/fidl/cpp/comparison.h>
+#include <lib/zx/time.h>
+#include <trace/event.h>
+
+namespace flutter_runner {
+
+namespace {
+
+using GfxTag = fuchsia::ui::gfx::Command::Tag;
+
+SceneCommandInfo SetInfo(uint32_t id, GfxTag tag) {
+  return {SceneCommandInfo::Type::kSet, id, static_cast<uint32_t>(tag)};
+}
+
+// Describes a set of a value that may be bound to the variable
+// |variable_id| instead.
+SceneCommandInfo SetOrBindInfo(uint32_t id, GfxTag tag, uint32_t variable_id) {
+  if (variable_id != 0) {
+    return {SceneCommandInfo::Type::kBind, id, static_cast<uint32_t>(tag)};
+  }
+  return SetInfo(id, tag);
+}
+
+}  // namespace
+
+bool SceneCommandBuffer::CommandTraits::Equals(
+    const fuchsia::ui::gfx::Command& a, const fuchsia::ui::gfx::Command& b) {
+  return fidl::Equals(a, b);
+}
+
+fuchsia::ui::gfx::Command SceneCommandBuffer::CommandTraits::Clone(
+    const fuchsia::ui::gfx::Command& command) {
+  fuchsia::ui::gfx::Command clone;
+  fidl::Clone(command, &clone);
+  return clone;
+}
+
+SceneCommandBuffer::SceneCommandBuffer(
+    fidl::InterfaceHandle<fuchsia::ui::scenic::Session> session)
+    : session_(session.Bind()), binding_(this) {
+  session_.set_error_handler(
+      [this](zx_status_t status) { binding_.Close(status); });
+}
+
+SceneCommandBuffer::~SceneCommandBuffer() = default;
+
+fidl::InterfaceHandle<fuchsia::ui::scenic::Session>
+SceneCommandBuffer::NewBinding() {
+  return binding_.NewBinding();
+}
+
+void SceneCommandBuffer::DispatchPending() {
+  TRACE_DURATION("flutter", "SceneCommandBuffer::DispatchPending");
+  while (binding_.is_bound() &&
+         binding_.channel().wait_one(ZX_CHANNEL_READABLE, zx::time(),
+                                     nullptr) == ZX_OK) {
+    if (binding_.WaitForMessage() != ZX_OK) {
+      return;
+    }
+  }
+}
+
+SceneCommandInfo SceneCommandBuffer::Classify(
+    const fuchsia::ui::scenic::Command& command) {
+  if (!command.is_gfx()) {
+    return {};
+  }
+  const fuchsia::ui::gfx::Command& gfx = command.gfx();
+  const GfxTag tag = gfx.Which();
+  switch (tag) {
+    case GfxTag::kCreateResource:
+      return {SceneCommandInfo::Type::kCreate, gfx.create_resource().id, 0};
+    case GfxTag::kReleaseResource:
+      return {SceneCommandInfo::Type::kRelease, gfx.release_resource().id, 0};
+    case GfxTag::kAddChild:
+      return {SceneCommandInfo::Type::kAddChild, gfx.add_child().node_id, 0,
+              gfx.add_child().child_id};
+    case GfxTag::kAddPart:
+      return {SceneCommandInfo::Type::kAddPart, gfx.add_part().node_id, 0,
+              gfx.add_part().part_id};
+    case GfxTag::kDetach:
+      return {SceneCommandInfo::Type::kDetach, gfx.detach().id, 0};
+    case GfxTag::kDetachChildren:
+      return {SceneCommandInfo::Type::kDetachChildren,
+              gfx.detach_children().node_id, 0};
+    case GfxTag::kSetTranslation:
+      return SetOrBindInfo(gfx.set_translation().id, tag,
+                           gfx.set_translation().value.variable_id);
+    case GfxTag::kSetScale:
+      return SetOrBindInfo(gfx.set_scale().id, tag,
+                           gfx.set_scale().value.variable_id);
+    case GfxTag::kSetRotation:
+      return SetOrBindInfo(gfx.set_rotation().id, tag,
+                           gfx.set_rotation().value.variable_id);
+    case GfxTag::kSetAnchor:
+      return SetOrBindInfo(gfx.set_anchor().id, tag,
+                           gfx.set_anchor().value.variable_id);
+    case GfxTag::kSetColor:
+      return SetOrBindInfo(gfx.set_color().material_id, tag,
+                           gfx.set_color().color.variable_id);
+    case GfxTag::kSetOpacity:
+      return SetInfo(gfx.set_opacity().node_id, tag);
+    case GfxTag::kSetShape:
+      return SetInfo(gfx.set_shape().node_id, tag);
+    case GfxTag::kSetMaterial:
+      return SetInfo(gfx.set_material().node_id, tag);
+    case GfxTag::kSetHitTestBehavior:
+      return SetInfo(gfx.set_hit_test_behavior().node_id, tag);
+    case GfxTag::kSetLabel:
+      return SetInfo(gfx.set_label().id, tag);
+    case GfxTag::kSetEventMask:
+      return SetInfo(gfx.set_event_mask().id, tag);
+    default:
+      return {};
+  }
+}
+
+void SceneCommandBuffer::Enqueue(
+    std::vector<fuchsia::ui::scenic::Command> cmds) {
+  batches_.push_back(std::move(cmds));
+}
+
+void SceneCommandBuffer::Present(uint64_t presentation_time,
+                                 std::vector<zx::event> acquire_fences,
+                                 std::vector<zx::event> release_fences,
+                                 PresentCallback callback) {
+  Flush();
+  session_->Present(presentation_time, std::move(acquire_fences),
+                    std::move(release_fences), std::move(callback));
+}
+
+void SceneCommandBuffer::Flush() {
+  TRACE_DURATION("gfx", "SceneCommandBuffer::Flush");
+  std::vector<SceneCommandInfo> infos;
+  std::vector<const fuchsia::ui::gfx::Command*> values;
+  for (const auto& batch : batches_) {
+    for (const auto& command : batch) {
+      infos.push_back(Classify(command));
+      values.push_back(infos.back().type == SceneCommandInfo::Type::kSet
+                           ? &command.gfx()
+                           : nullptr);
+    }
+  }
+
+  const auto stats_before = mirror_.stats();
+  const std::vector<bool> send = mirror_.FilterFrame(infos, values);
+  const auto& stats = mirror_.stats();
+
+  size_t index = 0;
+  size_t commands_out = 0;
+  for (auto& batch : batches_) {
+    std::vector<fuchsia::ui::scenic::Command> changes;
+    changes.reserve(batch.size());
+    for (auto& command : batch) {
+      if (send[index++]) {
+        changes.push_back(std::move(command));
+      }
+    }
+    commands_out += changes.size();
+    if (!changes.empty()) {
+      session_->Enqueue(std::move(changes));
+    }
+  }
+  batches_.clear();
+
+  constexpr size_t kCommandBytes =
+      fidl::CodingTraits<fuchsia::ui::scenic::Command>::encoded_size;
+  const size_t commands_in = infos.size();
+  const size_t superseded = stats.superseded - stats_before.superseded;
+  const size_t unchanged = stats.unchanged - stats_before.unchanged;
+  const size_t empty_detaches =
+      stats.empty_detaches - stats_before.empty_detaches;
+  TRACE_COUNTER("flutter", "SceneCommands", 0u,            //
+                "CommandsIn", commands_in,                 //
+                "CommandsOut", commands_out,               //
+                "BytesIn", commands_in * kCommandBytes,    //
+                "BytesOut", commands_out * kCommandBytes,  //
+                "Superseded", superseded,                  //
+                "Unchanged", unchanged,                    //
+                "EmptyDetaches", empty_detaches,           //
+                "MirroredResources", mirror_.size()        //
+  );
+}
+
+void SceneCommandBuffer::HitTest(uint32_t node_id,
+                                 fuchsia::ui::gfx::vec3 ray_origin,
+                                 fuchsia::ui::gfx::vec3 ray_direction,
+                                 HitTestCallback callback) {
+  if (!batches_.empty()) {
+    Flush();
+  }
+  session_->HitTest(node_id, ray_origin, ray_direction, std::move(callback));
+}
+
+void SceneCommandBuffer::HitTestDeviceRay(
+    fuchsia::ui::gfx::vec3 ray_origin, fuchsia::ui::gfx::vec3 ray_direction,
+    HitTestDeviceRayCallback callback) {
+  if (!batches_.empty()) {
+    Flush();
+  }
+  session_->HitTestDeviceRay(ray_origin, ray_direction, std::move(callback));
+}
+
+void SceneCommandBuffer::SetDebugName(std::string debug_name) {
+  if (!batches_.empty()) {
+    Flush();
+  }
+  session_->SetDebugName(std::move(debug_name));
+}
+
+}  // namespace flutter_runner
@@ -0,0 +1,105 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_SCENE_COMMAND_BUFFER_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_SCENE_COMMAND_BUFFER_H_
+
+#include <fuchsia/ui/gfx/cpp/fidl.h>
+#include <fuchsia/ui/scenic/cpp/fidl.h>
+#include <lib/fidl/cpp/binding.h>
+#include <lib/fidl/cpp/interface_handle.h>
+
+#include <vector>
+
+#include "flutter/fml/macros.h"
+#include "topaz/runtime/flutter_runner/scene_mirror.h"
+
+namespace flutter_runner {
+
+// Sits between the |scenic::Session| the layer tree enqueues its commands on
+// and the Scenic session itself, and leaves out commands that would not
+// change the scene.  See |SceneMirror|.
+//
+// Scenic applies enqueued commands when the session presents, so the batches
+// of a frame are held until |Present| and filtered together.  Any other
+// message sends the batches held so far first, so Scenic gets every message
+// in the order it was sent.  Commands are only ever dropped, so each batch
+// still fits in a message.
+//
+// Flutter's scene update code talks to |scenic::Session| directly, so this
+// serves the |fuchsia::ui::scenic::Session| protocol in process and forwards
+// to Scenic, rather than asking every caller to go through it.  Messages
+// would otherwise wait for the raster thread to get back to its loop, after
+// the frame is painted, so whoever sends them calls |DispatchPending|.
+//
+// The ("flutter", "SceneCommands") trace counter reports the commands and
+// their inline wire bytes per frame, before and after filtering, along with
+// why commands were dropped.
+class SceneCommandBuffer final : public fuchsia::ui::scenic::Session {
+ public:
+  // Forwards to |session|.  When |session| closes, so does the binding
+  // returned by |NewBinding|.
+  explicit SceneCommandBuffer(
+      fidl::InterfaceHandle<fuchsia::ui::scenic::Session> session);
+
+  ~SceneCommandBuffer() override;
+
+  // The handle for |scenic::Session| to send its commands to.
+  fidl::InterfaceHandle<fuchsia::ui::scenic::Session> NewBinding();
+
+  // Serves the messages already sent to the binding, forwarding them to
+  // Scenic before returning.
+  void DispatchPending();
+
+  // Describes |command| to |SceneMirror|.  Values bound to a Scenic variable
+  // change without a command, so sets of those are passed through as they
+  // are.
+  static SceneCommandInfo Classify(const fuchsia::ui::scenic::Command& command);
+
+  // |fuchsia::ui::scenic::Session|
+  void Enqueue(std::vector<fuchsia::ui::scenic::Command> cmds) override;
+
+  // |fuchsia::ui::scenic::Session|
+  void Present(uint64_t presentation_time,
+               std::vector<zx::event> acquire_fences,
+               std::vector<zx::event> release_fences,
+               PresentCallback callback) override;
+
+  // |fuchsia::ui::scenic::Session|
+  void HitTest(uint32_t node_id, fuchsia::ui::gfx::vec3 ray_origin,
+               fuchsia::ui::gfx::vec3 ray_direction,
+               HitTestCallback callback) override;
+
+  // |fuchsia::ui::scenic::Session|
+  void HitTestDeviceRay(fuchsia::ui::gfx::vec3 ray_origin,
+                        fuchsia::ui::gfx::vec3 ray_direction,
+                        HitTestDeviceRayCallback callback) override;
+
+  // |fuchsia::ui::scenic::Session|
+  void SetDebugName(std::string debug_name) override;
+
+ private:
+  struct CommandTraits {
+    static bool Equals(const fuchsia::ui::gfx::Command& a,
+                       const fuchsia::ui::gfx::Command& b);
+    static fuchsia::ui::gfx::Command Clone(
+        const fuchsia::ui::gfx::Command& command);
+  };
+
+  fuchsia::ui::scenic::SessionPtr session_;
+  fidl::Binding<fuchsia::ui::scenic::Session> binding_;
+  SceneMirror<fuchsia::ui::gfx::Command, CommandTraits> mirror_;
+
+  // Batches enqueued since the last |Present|.
+  std::vector<std::vector<fuchsia::ui::scenic::Command>> batches_;
+
+  // Sends the enqueued batches, minus the commands that change nothing.
+  void Flush();
+
+  FML_DISALLOW_COPY_AND_ASSIGN(SceneCommandBuffer);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_SCENE_COMMAND_BUFFER_H_
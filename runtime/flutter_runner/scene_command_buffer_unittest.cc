@@ -0,0 +1,180 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/scene_command_buffer.h"
+
+#include <gtest/gtest.h>
+#include <lib/gtest/real_loop_fixture.h>
+#include <lib/ui/scenic/cpp/commands.h>
+#include <lib/ui/scenic/cpp/session.h>
+
+#include <string>
+#include <vector>
+
+#include "flutter_runner_fakes.h"
+
+namespace flutter_runner_test {
+
+using flutter_runner::SceneCommandBuffer;
+using flutter_runner::SceneCommandInfo;
+using SceneCommandBufferTest = gtest::RealLoopFixture;
+
+namespace {
+
+SceneCommandInfo Classify(fuchsia::ui::gfx::Command command) {
+  return SceneCommandBuffer::Classify(scenic::NewCommand(std::move(command)));
+}
+
+uint32_t Property(fuchsia::ui::gfx::Command::Tag tag) {
+  return static_cast<uint32_t>(tag);
+}
+
+}  // namespace
+
+TEST(SceneCommandBufferClassifyTest, DescribesStructureCommands) {
+  auto create = Classify(scenic::NewCreateEntityNodeCmd(1));
+  EXPECT_EQ(create.type, SceneCommandInfo::Type::kCreate);
+  EXPECT_EQ(create.id, 1u);
+
+  auto release = Classify(scenic::NewReleaseResourceCmd(1));
+  EXPECT_EQ(release.type, SceneCommandInfo::Type::kRelease);
+  EXPECT_EQ(release.id, 1u);
+
+  auto add_child = Classify(scenic::NewAddChildCmd(1, 2));
+  EXPECT_EQ(add_child.type, SceneCommandInfo::Type::kAddChild);
+  EXPECT_EQ(add_child.id, 1u);
+  EXPECT_EQ(add_child.child_id, 2u);
+
+  auto add_part = Classify(scenic::NewAddPartCmd(1, 3));
+  EXPECT_EQ(add_part.type, SceneCommandInfo::Type::kAddPart);
+  EXPECT_EQ(add_part.child_id, 3u);
+
+  auto detach = Classify(scenic::NewDetachCmd(2));
+  EXPECT_EQ(detach.type, SceneCommandInfo::Type::kDetach);
+  EXPECT_EQ(detach.id, 2u);
+
+  auto detach_children = Classify(scenic::NewDetachChildrenCmd(1));
+  EXPECT_EQ(detach_children.type, SceneCommandInfo::Type::kDetachChildren);
+  EXPECT_EQ(detach_children.id, 1u);
+}
+
+TEST(SceneCommandBufferClassifyTest, DescribesSets) {
+  auto translation =
+      Classify(scenic::NewSetTranslationCmd(4, {1.f, 2.f, 3.f}));
+  EXPECT_EQ(translation.type, SceneCommandInfo::Type::kSet);
+  EXPECT_EQ(translation.id, 4u);
+  EXPECT_EQ(translation.property,
+            Property(fuchsia::ui::gfx::Command::Tag::kSetTranslation));
+
+  // Colors are set on the material, not the node that uses it.
+  auto color = Classify(scenic::NewSetColorCmd(5, 255, 0, 0, 255));
+  EXPECT_EQ(color.type, SceneCommandInfo::Type::kSet);
+  EXPECT_EQ(color.id, 5u);
+  EXPECT_EQ(color.property,
+            Property(fuchsia::ui::gfx::Command::Tag::kSetColor));
+
+  auto label = Classify(scenic::NewSetLabelCmd(4, "label"));
+  EXPECT_EQ(label.type, SceneCommandInfo::Type::kSet);
+  EXPECT_NE(label.property, translation.property);
+
+  // A value bound to a variable changes without a command.
+  auto bound = Classify(scenic::NewSetTranslationCmd(4, 7u));
+  EXPECT_EQ(bound.type, SceneCommandInfo::Type::kBind);
+  EXPECT_EQ(bound.id, 4u);
+  EXPECT_EQ(bound.property, translation.property);
+}
+
+TEST(SceneCommandBufferClassifyTest, PassesThroughWhatItCannotReasonAbout) {
+  fuchsia::ui::input::SetHardKeyboardDeliveryCmd delivery;
+  delivery.delivery_request = true;
+  fuchsia::ui::input::Command input;
+  input.set_set_hard_keyboard_delivery(std::move(delivery));
+  fuchsia::ui::scenic::Command command;
+  command.set_input(std::move(input));
+  EXPECT_EQ(SceneCommandBuffer::Classify(command).type,
+            SceneCommandInfo::Type::kOther);
+}
+
+TEST_F(SceneCommandBufferTest, ForwardsFrameWhenDispatched) {
+  FakeScenicSession scenic_session;
+  SceneCommandBuffer command_buffer(scenic_session.NewBinding(dispatcher()));
+  scenic::Session session(command_buffer.NewBinding().Bind(), nullptr);
+
+  session.Enqueue(scenic::NewCreateEntityNodeCmd(1));
+  session.Present(0, [](fuchsia::images::PresentationInfo info) {});
+  command_buffer.DispatchPending();
+
+  // Everything reached Scenic without the loop getting to run.
+  EXPECT_TRUE(scenic_session.HasPendingMessages());
+  RunLoopUntilIdle();
+  ASSERT_EQ(scenic_session.Frames().size(), 1u);
+  EXPECT_EQ(scenic_session.Frames()[0].size(), 1u);
+}
+
+TEST_F(SceneCommandBufferTest, LeavesOutCommandsThatChangeNothing) {
+  FakeScenicSession scenic_session;
+  SceneCommandBuffer command_buffer(scenic_session.NewBinding(dispatcher()));
+  scenic::Session session(command_buffer.NewBinding().Bind(), nullptr);
+
+  session.Enqueue(scenic::NewCreateEntityNodeCmd(1));
+  session.Enqueue(scenic::NewSetTranslationCmd(1, {1.f, 2.f, 3.f}));
+  session.Present(0, [](fuchsia::images::PresentationInfo info) {});
+  command_buffer.DispatchPending();
+
+  // The first set is superseded, and the last sets what is already there.
+  session.Enqueue(scenic::NewSetTranslationCmd(1, {4.f, 5.f, 6.f}));
+  session.Enqueue(scenic::NewSetTranslationCmd(1, {1.f, 2.f, 3.f}));
+  session.Enqueue(scenic::NewSetLabelCmd(1, "node"));
+  session.Present(0, [](fuchsia::images::PresentationInfo info) {});
+  command_buffer.DispatchPending();
+  RunLoopUntilIdle();
+
+  const auto& frames = scenic_session.Frames();
+  ASSERT_EQ(frames.size(), 2u);
+  EXPECT_EQ(frames[0].size(), 2u);
+  ASSERT_EQ(frames[1].size(), 1u);
+  EXPECT_TRUE(frames[1][0].gfx().is_set_label());
+}
+
+TEST_F(SceneCommandBufferTest, SendsSetsAfterBindingToAVariable) {
+  FakeScenicSession scenic_session;
+  SceneCommandBuffer command_buffer(scenic_session.NewBinding(dispatcher()));
+  scenic::Session session(command_buffer.NewBinding().Bind(), nullptr);
+
+  session.Enqueue(scenic::NewCreateEntityNodeCmd(1));
+  session.Enqueue(scenic::NewSetTranslationCmd(1, {1.f, 2.f, 3.f}));
+  session.Present(0, [](fuchsia::images::PresentationInfo info) {});
+  session.Enqueue(scenic::NewSetTranslationCmd(1, 7u));
+  session.Present(0, [](fuchsia::images::PresentationInfo info) {});
+  // The translation followed the variable, so this sets it again.
+  session.Enqueue(scenic::NewSetTranslationCmd(1, {1.f, 2.f, 3.f}));
+  session.Present(0, [](fuchsia::images::PresentationInfo info) {});
+  command_buffer.DispatchPending();
+  RunLoopUntilIdle();
+
+  const auto& frames = scenic_session.Frames();
+  ASSERT_EQ(frames.size(), 3u);
+  ASSERT_EQ(frames[1].size(), 1u);
+  EXPECT_EQ(frames[1][0].gfx().set_translation().value.variable_id, 7u);
+  ASSERT_EQ(frames[2].size(), 1u);
+  EXPECT_EQ(frames[2][0].gfx().set_translation().value.variable_id, 0u);
+}
+
+TEST_F(SceneCommandBufferTest, SendsHeldCommandsBeforeHitTest) {
+  FakeScenicSession scenic_session;
+  SceneCommandBuffer command_buffer(scenic_session.NewBinding(dispatcher()));
+  fuchsia::ui::scenic::SessionPtr session = command_buffer.NewBinding().Bind();
+
+  std::vector<fuchsia::ui::scenic::Command> commands;
+  commands.push_back(scenic::NewCommand(scenic::NewCreateEntityNodeCmd(1)));
+  session->Enqueue(std::move(commands));
+  session->HitTest(1, {0.f, 0.f, 0.f}, {0.f, 0.f, 1.f}, [](auto hits) {});
+  session->Present(0, {}, {}, [](fuchsia::images::PresentationInfo info) {});
+  RunLoopUntilIdle();
+
+  EXPECT_EQ(scenic_session.Calls(),
+            (std::vector<std::string>{"Enqueue", "HitTest", "Present"}));
+}
+
+}  // namespace flutter_runner_test
@@ -0,0 +1,336 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_SCENE_MIRROR_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_SCENE_MIRROR_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "flutter/fml/logging.h"
+#include "flutter/fml/macros.h"
+
+namespace flutter_runner {
+
+// What |SceneMirror| needs to know about a Scenic command.
+struct SceneCommandInfo {
+  enum class Type {
+    // Passed through untouched.
+    kOther,
+    // Creates resource |id|.
+    kCreate,
+    // Releases resource |id|.  The session can no longer refer to it, but
+    // Scenic keeps a node for as long as it is attached to a parent.
+    kRelease,
+    // Sets |property| of resource |id|, replacing whatever it was set to.
+    kSet,
+    // Binds |property| of resource |id| to a variable, replacing whatever it
+    // was set to.  Its value then changes without a command, so binds are
+    // always sent.
+    kBind,
+    // Attaches node |child_id| to node |id|, detaching it from any other
+    // parent first.
+    kAddChild,
+    // Attaches node |child_id| to node |id| as a part.  Parts are not
+    // children, so the mirror stops tracking |child_id|.
+    kAddPart,
+    // Detaches node |id| from its parent.
+    kDetach,
+    // Detaches every child of node |id|.
+    kDetachChildren,
+  };
+
+  Type type = Type::kOther;
+  uint32_t id = 0;
+  uint32_t property = 0;
+  uint32_t child_id = 0;
+};
+
+template <typename Value>
+struct SceneValueTraits {
+  static bool Equals(const Value& a, const Value& b) { return a == b; }
+  static Value Clone(const Value& value) { return value; }
+};
+
+// Mirrors the scene this session has built in Scenic, so that commands which
+// would not change it can be left out before they are sent.
+//
+// Within a frame, a set or bind command is dropped when a later command of
+// the frame sets or binds the same property of the same resource.  Across
+// frames, the property values last sent for each live resource are kept, and
+// a set to the value a property already has is dropped.  Flutter rebuilds its
+// Scenic nodes every frame, so most resources only live for a frame, but the
+// view, the root node and retained layer nodes are configured the same way
+// over and over.
+//
+// The mirror also tracks the parent and children of the resources this
+// session created, and drops detaches of nodes without a parent and of
+// parents without children.  Resources it did not see created are assumed to
+// be attached to something.
+//
+// |Traits| compares and copies |Value|s, which are whatever the caller uses
+// to describe a set command.  See |SceneValueTraits|.
+template <typename Value, typename Traits = SceneValueTraits<Value>>
+class SceneMirror final {
+ public:
+  struct Stats {
+    size_t commands = 0;
+    // Sets replaced by a later set in the same frame.
+    size_t superseded = 0;
+    // Sets to the value the property already had.
+    size_t unchanged = 0;
+    // Detaches that had nothing to detach.
+    size_t empty_detaches = 0;
+  };
+
+  SceneMirror() = default;
+
+  ~SceneMirror() = default;
+
+  const Stats& stats() const { return stats_; }
+
+  // Number of resources with mirrored property values.
+  size_t size() const { return values_.size(); }
+
+  // Number of nodes whose parent and children are tracked.
+  size_t node_count() const { return nodes_.size(); }
+
+  // Records the commands of one frame, in order, and returns which of them
+  // change the scene and should be sent.  |values[i]| describes what
+  // |infos[i]| sets if it is a |kSet|, and is ignored otherwise.
+  std::vector<bool> FilterFrame(const std::vector<SceneCommandInfo>& infos,
+                                const std::vector<const Value*>& values) {
+    FML_DCHECK(infos.size() == values.size());
+    stats_.commands += infos.size();
+    std::vector<bool> send = FindLastSets(infos);
+    for (size_t i = 0; i < infos.size(); i++) {
+      const SceneCommandInfo& info = infos[i];
+      if (!send[i]) {
+        stats_.superseded++;
+        continue;
+      }
+      switch (info.type) {
+        case SceneCommandInfo::Type::kOther:
+          break;
+        case SceneCommandInfo::Type::kCreate:
+          values_.erase(info.id);
+          Forget(info.id);
+          nodes_.emplace(info.id, Node());
+          break;
+        case SceneCommandInfo::Type::kRelease:
+          Release(info.id);
+          break;
+        case SceneCommandInfo::Type::kSet:
+          if (!Set(info.id, info.property, *values[i])) {
+            send[i] = false;
+            stats_.unchanged++;
+          }
+          break;
+        case SceneCommandInfo::Type::kBind:
+          Unset(info.id, info.property);
+          break;
+        case SceneCommandInfo::Type::kAddChild:
+          AddChild(info.id, info.child_id);
+          break;
+        case SceneCommandInfo::Type::kAddPart:
+          Forget(info.child_id);
+          break;
+        case SceneCommandInfo::Type::kDetach:
+          if (!Detach(info.id)) {
+            send[i] = false;
+            stats_.empty_detaches++;
+          }
+          break;
+        case SceneCommandInfo::Type::kDetachChildren:
+          if (!DetachChildren(info.id)) {
+            send[i] = false;
+            stats_.empty_detaches++;
+          }
+          break;
+      }
+    }
+    return send;
+  }
+
+ private:
+  struct Node {
+    // Zero when the node has no parent.
+    uint32_t parent = 0;
+    // Children this session created.
+    std::vector<uint32_t> children;
+    // Children created some other way, which can't be followed.
+    size_t untracked_children = 0;
+    // Released nodes are kept while they are attached.
+    bool released = false;
+  };
+
+  // Property values of each resource, by resource ID and property.
+  std::unordered_map<uint32_t, std::unordered_map<uint32_t, Value>> values_;
+  // Nodes created by this session that are still alive in Scenic.
+  std::unordered_map<uint32_t, Node> nodes_;
+  Stats stats_;
+
+  // Marks each set or bind that a later set or bind of the same property
+  // replaces before the resource is released.
+  static std::vector<bool> FindLastSets(
+      const std::vector<SceneCommandInfo>& infos) {
+    std::vector<bool> last(infos.size(), true);
+    // Index of the latest set of each property, by resource ID and property.
+    std::unordered_map<uint32_t, std::unordered_map<uint32_t, size_t>> latest;
+    for (size_t i = 0; i < infos.size(); i++) {
+      const SceneCommandInfo& info = infos[i];
+      if (info.type == SceneCommandInfo::Type::kSet ||
+          info.type == SceneCommandInfo::Type::kBind) {
+        auto [earlier, inserted] =
+            latest[info.id].try_emplace(info.property, i);
+        if (!inserted) {
+          last[earlier->second] = false;
+          earlier->second = i;
+        }
+      } else if (info.type == SceneCommandInfo::Type::kRelease) {
+        latest.erase(info.id);
+      }
+    }
+    return last;
+  }
+
+  // Returns whether the property changed.
+  bool Set(uint32_t id, uint32_t property, const Value& value) {
+    auto& properties = values_[id];
+    auto found = properties.find(property);
+    if (found != properties.end() && Traits::Equals(found->second, value)) {
+      return false;
+    }
+    properties.insert_or_assign(property, Traits::Clone(value));
+    return true;
+  }
+
+  // Forgets the value of the property, so that the next set is sent.
+  void Unset(uint32_t id, uint32_t property) {
+    auto properties = values_.find(id);
+    if (properties == values_.end()) {
+      return;
+    }
+    properties->second.erase(property);
+    if (properties->second.empty()) {
+      values_.erase(properties);
+    }
+  }
+
+  void Release(uint32_t id) {
+    values_.erase(id);
+    auto node = nodes_.find(id);
+    if (node != nodes_.end()) {
+      node->second.released = true;
+      Collect(id);
+    }
+  }
+
+  void AddChild(uint32_t parent, uint32_t child) {
+    auto parent_node = nodes_.find(parent);
+    auto child_node = nodes_.find(child);
+    if (child_node == nodes_.end()) {
+      if (parent_node != nodes_.end()) {
+        parent_node->second.untracked_children++;
+      }
+      return;
+    }
+    RemoveFromParent(child_node->second, child);
+    child_node->second.parent = parent;
+    if (parent_node != nodes_.end()) {
+      parent_node->second.children.push_back(child);
+    }
+  }
+
+  // Returns whether |id| had a parent.
+  bool Detach(uint32_t id) {
+    auto node = nodes_.find(id);
+    if (node == nodes_.end()) {
+      return true;
+    }
+    if (node->second.parent == 0) {
+      return false;
+    }
+    RemoveFromParent(node->second, id);
+    Collect(id);
+    return true;
+  }
+
+  // Returns whether |id| had children.
+  bool DetachChildren(uint32_t id) {
+    auto node = nodes_.find(id);
+    if (node == nodes_.end()) {
+      return true;
+    }
+    if (node->second.children.empty() &&
+        node->second.untracked_children == 0) {
+      return false;
+    }
+    OrphanChildren(node->second);
+    return true;
+  }
+
+  // Stops tracking |id|.  Scenic may still have it attached to its parent,
+  // and its children may still be attached to it.
+  void Forget(uint32_t id) {
+    auto node = nodes_.find(id);
+    if (node == nodes_.end()) {
+      return;
+    }
+    auto parent = nodes_.find(node->second.parent);
+    RemoveFromParent(node->second, id);
+    if (parent != nodes_.end()) {
+      parent->second.untracked_children++;
+    }
+    nodes_.erase(node);
+  }
+
+  // Clears the parent of |node|, whose ID is |id|.
+  void RemoveFromParent(Node& node, uint32_t id) {
+    if (node.parent == 0) {
+      return;
+    }
+    auto parent = nodes_.find(node.parent);
+    if (parent != nodes_.end()) {
+      auto& siblings = parent->second.children;
+      auto sibling = std::find(siblings.begin(), siblings.end(), id);
+      if (sibling != siblings.end()) {
+        siblings.erase(sibling);
+      }
+    }
+    node.parent = 0;
+  }
+
+  // Clears the parent of every child of |node|.
+  void OrphanChildren(Node& node) {
+    std::vector<uint32_t> children = std::move(node.children);
+    node.children.clear();
+    node.untracked_children = 0;
+    for (uint32_t child : children) {
+      nodes_.at(child).parent = 0;
+      Collect(child);
+    }
+  }
+
+  // Scenic destroys a released node once it has no parent, and its children
+  // lose their parent.
+  void Collect(uint32_t id) {
+    auto node = nodes_.find(id);
+    if (node == nodes_.end() || !node->second.released ||
+        node->second.parent != 0) {
+      return;
+    }
+    OrphanChildren(node->second);
+    nodes_.erase(id);
+  }
+
+  FML_DISALLOW_COPY_AND_ASSIGN(SceneMirror);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_SCENE_MIRROR_H_
@@ -0,0 +1,184 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/scene_mirror.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace flutter_runner_test {
+
+using flutter_runner::SceneCommandInfo;
+using flutter_runner::SceneMirror;
+using Type = SceneCommandInfo::Type;
+
+namespace {
+
+constexpr uint32_t kTranslation = 1;
+constexpr uint32_t kScale = 2;
+
+// Builds the commands of one frame.
+class Frame {
+ public:
+  Frame& Create(uint32_t id) { return Add({Type::kCreate, id}); }
+  Frame& Release(uint32_t id) { return Add({Type::kRelease, id}); }
+  Frame& Set(uint32_t id, uint32_t property, std::string value) {
+    return Add({Type::kSet, id, property}, std::move(value));
+  }
+  Frame& Bind(uint32_t id, uint32_t property) {
+    return Add({Type::kBind, id, property});
+  }
+  Frame& AddChild(uint32_t id, uint32_t child_id) {
+    return Add({Type::kAddChild, id, 0, child_id});
+  }
+  Frame& AddPart(uint32_t id, uint32_t part_id) {
+    return Add({Type::kAddPart, id, 0, part_id});
+  }
+  Frame& Detach(uint32_t id) { return Add({Type::kDetach, id}); }
+  Frame& DetachChildren(uint32_t id) {
+    return Add({Type::kDetachChildren, id});
+  }
+
+  std::vector<bool> SendTo(SceneMirror<std::string>& mirror) const {
+    std::vector<const std::string*> values;
+    for (const auto& value : values_) {
+      values.push_back(&value);
+    }
+    return mirror.FilterFrame(infos_, values);
+  }
+
+ private:
+  std::vector<SceneCommandInfo> infos_;
+  std::vector<std::string> values_;
+
+  Frame& Add(SceneCommandInfo info, std::string value = "") {
+    infos_.push_back(info);
+    values_.push_back(std::move(value));
+    return *this;
+  }
+};
+
+}  // namespace
+
+TEST(SceneMirrorTest, DropsSetsToTheCurrentValue) {
+  SceneMirror<std::string> mirror;
+  EXPECT_EQ(Frame().Set(1, kTranslation, "1,2,3").SendTo(mirror),
+            std::vector<bool>({true}));
+  EXPECT_EQ(Frame().Set(1, kTranslation, "1,2,3").SendTo(mirror),
+            std::vector<bool>({false}));
+  EXPECT_EQ(Frame()
+                .Set(1, kTranslation, "4,5,6")
+                .Set(1, kScale, "1")
+                .Set(2, kTranslation, "4,5,6")
+                .SendTo(mirror),
+            std::vector<bool>({true, true, true}));
+  EXPECT_EQ(mirror.size(), 2u);
+  EXPECT_EQ(mirror.stats().unchanged, 1u);
+}
+
+TEST(SceneMirrorTest, DropsSetsSupersededInTheSameFrame) {
+  SceneMirror<std::string> mirror;
+  EXPECT_EQ(Frame()
+                .Set(1, kTranslation, "1")
+                .Set(1, kScale, "1")
+                .Set(1, kTranslation, "2")
+                .Set(1, kTranslation, "3")
+                .SendTo(mirror),
+            std::vector<bool>({false, true, false, true}));
+  EXPECT_EQ(mirror.stats().superseded, 2u);
+  // The last set of the frame is what the mirror remembers.
+  EXPECT_EQ(Frame().Set(1, kTranslation, "3").SendTo(mirror),
+            std::vector<bool>({false}));
+}
+
+TEST(SceneMirrorTest, BindingForgetsTheValue) {
+  SceneMirror<std::string> mirror;
+  EXPECT_EQ(Frame().Set(1, kTranslation, "1").SendTo(mirror),
+            std::vector<bool>({true}));
+  EXPECT_EQ(Frame().Bind(1, kTranslation).SendTo(mirror),
+            std::vector<bool>({true}));
+  // The translation followed the variable, so setting it back is a change.
+  EXPECT_EQ(Frame().Set(1, kTranslation, "1").SendTo(mirror),
+            std::vector<bool>({true}));
+  EXPECT_EQ(mirror.stats().unchanged, 0u);
+
+  // Within a frame, binds and sets replace each other.
+  EXPECT_EQ(Frame()
+                .Bind(1, kTranslation)
+                .Set(1, kTranslation, "2")
+                .Set(1, kScale, "1")
+                .Bind(1, kScale)
+                .SendTo(mirror),
+            std::vector<bool>({false, true, false, true}));
+  EXPECT_EQ(Frame().Bind(1, kTranslation).Bind(1, kTranslation).SendTo(mirror),
+            std::vector<bool>({false, true}));
+}
+
+TEST(SceneMirrorTest, ReleaseForgetsValues) {
+  SceneMirror<std::string> mirror;
+  EXPECT_EQ(Frame()
+                .Set(1, kTranslation, "1")
+                .Release(1)
+                .Set(1, kTranslation, "2")
+                .SendTo(mirror),
+            std::vector<bool>({true, true, true}));
+  EXPECT_EQ(Frame().Release(1).SendTo(mirror), std::vector<bool>({true}));
+  EXPECT_EQ(mirror.size(), 0u);
+  EXPECT_EQ(Frame().Set(1, kTranslation, "2").SendTo(mirror),
+            std::vector<bool>({true}));
+}
+
+TEST(SceneMirrorTest, DropsEmptyDetaches) {
+  SceneMirror<std::string> mirror;
+  EXPECT_EQ(Frame()
+                .Create(1)
+                .Create(2)
+                .Detach(2)
+                .DetachChildren(1)
+                .AddChild(1, 2)
+                .DetachChildren(1)
+                .Detach(2)
+                .SendTo(mirror),
+            std::vector<bool>({true, true, false, false, true, true, false}));
+  EXPECT_EQ(mirror.stats().empty_detaches, 3u);
+}
+
+TEST(SceneMirrorTest, KeepsDetachesOfUntrackedNodes) {
+  SceneMirror<std::string> mirror;
+  EXPECT_EQ(Frame()
+                .Create(1)
+                .Create(2)
+                .Detach(3)
+                .AddChild(1, 3)
+                .DetachChildren(1)
+                .AddPart(1, 2)
+                .Detach(2)
+                .SendTo(mirror),
+            std::vector<bool>({true, true, true, true, true, true, true}));
+  EXPECT_EQ(mirror.node_count(), 1u);
+}
+
+TEST(SceneMirrorTest, ReleasedNodesLiveWhileAttached) {
+  SceneMirror<std::string> mirror;
+  Frame()
+      .Create(1)
+      .Create(2)
+      .Create(3)
+      .AddChild(1, 2)
+      .AddChild(2, 3)
+      .Release(2)
+      .Release(3)
+      .SendTo(mirror);
+  EXPECT_EQ(mirror.node_count(), 3u);
+  // Detaching 2 destroys it, which detaches 3 and destroys it in turn.
+  EXPECT_EQ(Frame().DetachChildren(1).SendTo(mirror),
+            std::vector<bool>({true}));
+  EXPECT_EQ(mirror.node_count(), 1u);
+  EXPECT_EQ(Frame().DetachChildren(1).SendTo(mirror),
+            std::vector<bool>({false}));
+}
+
+}  // namespace flutter_runner_test
@@ -0,0 +1,567 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/scene_replay.h"
+
+#include <lib/fidl/cpp/clone.h>
+#include <lib/fidl/cpp/comparison.h>
+#include <lib/ui/scenic/cpp/commands.h>
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+#include "flutter/fml/logging.h"
+#include "rapidjson/document.h"
+#include "topaz/runtime/dart/utils/files.h"
+
+
+namespace flutter_runner {
+
+namespace {
+
+using GfxTag = fuchsia::ui::gfx::Command::Tag;
+
+// The resource whose property |command| sets, or 0 if it doesn't set one.
+// Values bound to a Scenic variable are properties like any other here: the
+// command that bound them is what both scenes must agree on.
+uint32_t PropertyTarget(const fuchsia::ui::gfx::Command& command) {
+  switch (command.Which()) {
+    case GfxTag::kSetTranslation:
+      return command.set_translation().id;
+    case GfxTag::kSetScale:
+      return command.set_scale().id;
+    case GfxTag::kSetRotation:
+      return command.set_rotation().id;
+    case GfxTag::kSetAnchor:
+      return command.set_anchor().id;
+    case GfxTag::kSetSize:
+      return command.set_size().id;
+    case GfxTag::kSetOpacity:
+      return command.set_opacity().node_id;
+    case GfxTag::kSetShape:
+      return command.set_shape().node_id;
+    case GfxTag::kSetMaterial:
+      return command.set_material().node_id;
+    case GfxTag::kSetClip:
+      return command.set_clip().node_id;
+    case GfxTag::kSetClipPlanes:
+      return command.set_clip_planes().node_id;
+    case GfxTag::kSetTag:
+      return command.set_tag().node_id;
+    case GfxTag::kSetHitTestBehavior:
+      return command.set_hit_test_behavior().node_id;
+    case GfxTag::kSetColor:
+      return command.set_color().material_id;
+    case GfxTag::kSetTexture:
+      return command.set_texture().material_id;
+    case GfxTag::kSetLabel:
+      return command.set_label().id;
+    case GfxTag::kSetEventMask:
+      return command.set_event_mask().id;
+    default:
+      return 0;
+  }
+}
+
+// Stands in for the scene graph of a Scenic session.
+//
+// Resources are keyed by the order they were created in rather than their
+// IDs, so that released nodes which are still attached can be told apart
+// from resources created later with the same ID.
+class ReplayScene {
+ public:
+  void Apply(const fuchsia::ui::scenic::Command& command) {
+    if (!command.is_gfx()) {
+      ApplyOther(command);
+      return;
+    }
+    const fuchsia::ui::gfx::Command& gfx = command.gfx();
+    switch (gfx.Which()) {
+      case GfxTag::kCreateResource: {
+        const uint32_t id = gfx.create_resource().id;
+        Release(id);
+        keys_[id] = ++last_key_;
+        Resource& resource = resources_[last_key_];
+        resource.id = id;
+        // What the resource was created as is compared like a property.
+        fidl::Clone(gfx, &resource.properties[static_cast<uint32_t>(
+                             GfxTag::kCreateResource)]);
+        break;
+      }
+      case GfxTag::kReleaseResource:
+        Release(gfx.release_resource().id);
+        break;
+      case GfxTag::kAddChild:
+        Attach(gfx.add_child().node_id, gfx.add_child().child_id,
+               /*is_part=*/false);
+        break;
+      case GfxTag::kAddPart:
+        Attach(gfx.add_part().node_id, gfx.add_part().part_id,
+               /*is_part=*/true);
+        break;
+      case GfxTag::kDetach: {
+        const size_t key = Key(gfx.detach().id);
+        if (key != 0) {
+          Unparent(key);
+        }
+        break;
+      }
+      case GfxTag::kDetachChildren:
+        if (Resource* resource = Find(gfx.detach_children().node_id)) {
+          std::vector<size_t> children = std::move(resource->children);
+          resource->children.clear();
+          for (size_t child : children) {
+            resources_[child].parent = 0;
+            CollectIfUnreachable(child);
+          }
+        }
+        break;
+      default:
+        if (const uint32_t id = PropertyTarget(gfx)) {
+          if (Resource* resource = Find(id)) {
+            fidl::Clone(gfx, &resource->properties[static_cast<uint32_t>(
+                                 gfx.Which())]);
+          }
+        } else {
+          ApplyOther(command);
+        }
+        break;
+    }
+  }
+
+  bool operator==(const ReplayScene& other) const {
+    return resources_ == other.resources_ &&
+           std::equal(other_commands_.begin(), other_commands_.end(),
+                      other.other_commands_.begin(),
+                      other.other_commands_.end(),
+                      [](const auto& a, const auto& b) {
+                        return fidl::Equals(a, b);
+                      });
+  }
+
+  std::string ToString() const {
+    std::ostringstream stream;
+    for (const auto& [key, resource] : resources_) {
+      stream << key << ": id " << resource.id << ", parent " << resource.parent
+             << (resource.is_part ? " (part)" : "") << ", children [";
+      for (size_t child : resource.children) {
+        stream << " " << child;
+      }
+      stream << " ], parts [";
+      for (size_t part : resource.parts) {
+        stream << " " << part;
+      }
+      stream << " ], properties [";
+      for (const auto& property : resource.properties) {
+        stream << " " << property.first;
+      }
+      stream << " ]\n";
+    }
+    stream << other_commands_.size() << " other commands\n";
+    return stream.str();
+  }
+
+ private:
+  struct Resource {
+    // Zero once released.
+    uint32_t id = 0;
+    size_t parent = 0;
+    bool is_part = false;
+    std::vector<size_t> children;
+    std::vector<size_t> parts;
+    // The command that last set each property.
+    std::map<uint32_t, fuchsia::ui::gfx::Command> properties;
+
+    bool operator==(const Resource& other) const {
+      return id == other.id && parent == other.parent &&
+             is_part == other.is_part && children == other.children &&
+             parts == other.parts &&
+             std::equal(properties.begin(), properties.end(),
+                        other.properties.begin(), other.properties.end(),
+                        [](const auto& a, const auto& b) {
+                          return a.first == b.first &&
+                                 fidl::Equals(a.second, b.second);
+                        });
+    }
+  };
+
+  std::map<size_t, Resource> resources_;
+  std::unordered_map<uint32_t, size_t> keys_;
+  size_t last_key_ = 0;
+  // Commands the model doesn't interpret, in the order they were applied.
+  std::vector<fuchsia::ui::scenic::Command> other_commands_;
+
+  void ApplyOther(const fuchsia::ui::scenic::Command& command) {
+    other_commands_.emplace_back();
+    fidl::Clone(command, &other_commands_.back());
+  }
+
+  size_t Key(uint32_t id) const {
+    auto found = keys_.find(id);
+    return found == keys_.end() ? 0 : found->second;
+  }
+
+  Resource* Find(uint32_t id) {
+    const size_t key = Key(id);
+    return key == 0 ? nullptr : &resources_[key];
+  }
+
+  void Attach(uint32_t parent_id, uint32_t child_id, bool is_part) {
+    const size_t parent = Key(parent_id);
+    const size_t child = Key(child_id);
+    if (parent == 0 || child == 0) {
+      return;
+    }
+    Unparent(child);
+    resources_[child].parent = parent;
+    resources_[child].is_part = is_part;
+    (is_part ? resources_[parent].parts : resources_[parent].children)
+        .push_back(child);
+  }
+
+  void Release(uint32_t id) {
+    const size_t key = Key(id);
+    if (key == 0) {
+      return;
+    }
+    keys_.erase(id);
+    resources_[key].id = 0;
+    CollectIfUnreachable(key);
+  }
+
+  void Unparent(size_t key) {
+    Resource& resource = resources_[key];
+    if (resource.parent == 0) {
+      return;
+    }
+    Resource& parent = resources_[resource.parent];
+    auto& siblings = resource.is_part ? parent.parts : parent.children;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), key));
+    resource.parent = 0;
+    resource.is_part = false;
+    CollectIfUnreachable(key);
+  }
+
+  void CollectIfUnreachable(size_t key) {
+    Resource& resource = resources_[key];
+    if (resource.id != 0 || resource.parent != 0) {
+      return;
+    }
+    std::vector<size_t> orphans = std::move(resource.children);
+    orphans.insert(orphans.end(), resource.parts.begin(),
+                   resource.parts.end());
+    resources_.erase(key);
+    for (size_t orphan : orphans) {
+      resources_[orphan].parent = 0;
+      resources_[orphan].is_part = false;
+      CollectIfUnreachable(orphan);
+    }
+  }
+};
+
+bool GetUint(const rapidjson::Value& object, const char* name,
+             uint32_t* out) {
+  auto member = object.FindMember(name);
+  if (member == object.MemberEnd() || !member->value.IsUint()) {
+    return false;
+  }
+  *out = member->value.GetUint();
+  return true;
+}
+
+bool GetFloat(const rapidjson::Value& object, const char* name, float* out) {
+  auto member = object.FindMember(name);
+  if (member == object.MemberEnd() || !member->value.IsNumber()) {
+    return false;
+  }
+  *out = static_cast<float>(member->value.GetDouble());
+  return true;
+}
+
+bool GetVec3(const rapidjson::Value& object, const char* name,
+             std::array<float, 3>* out) {
+  auto member = object.FindMember(name);
+  if (member == object.MemberEnd() || !member->value.IsArray() ||
+      member->value.Size() != out->size()) {
+    return false;
+  }
+  for (size_t i = 0; i < out->size(); i++) {
+    if (!member->value[i].IsNumber()) {
+      return false;
+    }
+    (*out)[i] = static_cast<float>(member->value[i].GetDouble());
+  }
+  return true;
+}
+
+bool ParseCreateResource(const rapidjson::Value& args,
+                         fuchsia::ui::gfx::Command* out) {
+  uint32_t id = 0;
+  if (!GetUint(args, "id", &id)) {
+    return false;
+  }
+  if (args.HasMember("entity_node")) {
+    *out = scenic::NewCreateEntityNodeCmd(id);
+    return true;
+  }
+  if (args.HasMember("shape_node")) {
+    *out = scenic::NewCreateShapeNodeCmd(id);
+    return true;
+  }
+  if (args.HasMember("material")) {
+    *out = scenic::NewCreateMaterialCmd(id);
+    return true;
+  }
+  auto rectangle = args.FindMember("rectangle");
+  if (rectangle != args.MemberEnd()) {
+    float width = 0.f;
+    float height = 0.f;
+    if (!GetFloat(rectangle->value, "width", &width) ||
+        !GetFloat(rectangle->value, "height", &height)) {
+      return false;
+    }
+    *out = scenic::NewCreateRectangleCmd(id, width, height);
+    return true;
+  }
+  auto rounded_rectangle = args.FindMember("rounded_rectangle");
+  if (rounded_rectangle != args.MemberEnd()) {
+    const rapidjson::Value& shape = rounded_rectangle->value;
+    float width = 0.f;
+    float height = 0.f;
+    float top_left_radius = 0.f;
+    float top_right_radius = 0.f;
+    float bottom_right_radius = 0.f;
+    float bottom_left_radius = 0.f;
+    if (!GetFloat(shape, "width", &width) ||
+        !GetFloat(shape, "height", &height) ||
+        !GetFloat(shape, "top_left_radius", &top_left_radius) ||
+        !GetFloat(shape, "top_right_radius", &top_right_radius) ||
+        !GetFloat(shape, "bottom_right_radius", &bottom_right_radius) ||
+        !GetFloat(shape, "bottom_left_radius", &bottom_left_radius)) {
+      return false;
+    }
+    *out = scenic::NewCreateRoundedRectangleCmd(
+        id, width, height, top_left_radius, top_right_radius,
+        bottom_right_radius, bottom_left_radius);
+    return true;
+  }
+  return false;
+}
+
+// Translations and scales are either a value or the ID of a variable.
+bool ParseVec3Set(const rapidjson::Value& args, GfxTag tag,
+                  fuchsia::ui::gfx::Command* out) {
+  uint32_t id = 0;
+  if (!GetUint(args, "id", &id)) {
+    return false;
+  }
+  uint32_t variable_id = 0;
+  if (GetUint(args, "variable_id", &variable_id)) {
+    *out = tag == GfxTag::kSetTranslation
+               ? scenic::NewSetTranslationCmd(id, variable_id)
+               : scenic::NewSetScaleCmd(id, variable_id);
+    return true;
+  }
+  std::array<float, 3> value;
+  if (!GetVec3(args, "value", &value)) {
+    return false;
+  }
+  *out = tag == GfxTag::kSetTranslation
+             ? scenic::NewSetTranslationCmd(id, value)
+             : scenic::NewSetScaleCmd(id, value);
+  return true;
+}
+
+bool ParseSetColor(const rapidjson::Value& args,
+                   fuchsia::ui::gfx::Command* out) {
+  uint32_t material_id = 0;
+  auto value = args.FindMember("value");
+  if (!GetUint(args, "material_id", &material_id) ||
+      value == args.MemberEnd() || !value->value.IsArray() ||
+      value->value.Size() != 4) {
+    return false;
+  }
+  std::array<uint8_t, 4> rgba;
+  for (size_t i = 0; i < rgba.size(); i++) {
+    if (!value->value[i].IsUint() || value->value[i].GetUint() > 255) {
+      return false;
+    }
+    rgba[i] = value->value[i].GetUint();
+  }
+  *out = scenic::NewSetColorCmd(material_id, rgba[0], rgba[1], rgba[2],
+                                rgba[3]);
+  return true;
+}
+
+// Parses a command object of the form {"add_child": {"node_id": 1,
+// "child_id": 2}}.
+bool ParseCommand(const rapidjson::Value& value,
+                  fuchsia::ui::scenic::Command* out) {
+  if (!value.IsObject() || value.MemberCount() != 1 ||
+      !value.MemberBegin()->value.IsObject()) {
+    return false;
+  }
+  const std::string name = value.MemberBegin()->name.GetString();
+  const rapidjson::Value& args = value.MemberBegin()->value;
+  fuchsia::ui::gfx::Command gfx;
+  uint32_t first = 0;
+  uint32_t second = 0;
+  if (name == "create_resource") {
+    if (!ParseCreateResource(args, &gfx)) {
+      return false;
+    }
+  } else if (name == "release_resource") {
+    if (!GetUint(args, "id", &first)) {
+      return false;
+    }
+    gfx = scenic::NewReleaseResourceCmd(first);
+  } else if (name == "add_child") {
+    if (!GetUint(args, "node_id", &first) ||
+        !GetUint(args, "child_id", &second)) {
+      return false;
+    }
+    gfx = scenic::NewAddChildCmd(first, second);
+  } else if (name == "add_part") {
+    if (!GetUint(args, "node_id", &first) ||
+        !GetUint(args, "part_id", &second)) {
+      return false;
+    }
+    gfx = scenic::NewAddPartCmd(first, second);
+  } else if (name == "detach") {
+    if (!GetUint(args, "id", &first)) {
+      return false;
+    }
+    gfx = scenic::NewDetachCmd(first);
+  } else if (name == "detach_children") {
+    if (!GetUint(args, "node_id", &first)) {
+      return false;
+    }
+    gfx = scenic::NewDetachChildrenCmd(first);
+  } else if (name == "set_translation") {
+    if (!ParseVec3Set(args, GfxTag::kSetTranslation, &gfx)) {
+      return false;
+    }
+  } else if (name == "set_scale") {
+    if (!ParseVec3Set(args, GfxTag::kSetScale, &gfx)) {
+      return false;
+    }
+  } else if (name == "set_label") {
+    auto label = args.FindMember("label");
+    if (!GetUint(args, "id", &first) || label == args.MemberEnd() ||
+        !label->value.IsString()) {
+      return false;
+    }
+    gfx = scenic::NewSetLabelCmd(first, label->value.GetString());
+  } else if (name == "set_shape") {
+    if (!GetUint(args, "node_id", &first) ||
+        !GetUint(args, "shape_id", &second)) {
+      return false;
+    }
+    gfx = scenic::NewSetShapeCmd(first, second);
+  } else if (name == "set_material") {
+    if (!GetUint(args, "node_id", &first) ||
+        !GetUint(args, "material_id", &second)) {
+      return false;
+    }
+    gfx = scenic::NewSetMaterialCmd(first, second);
+  } else if (name == "set_color") {
+    if (!ParseSetColor(args, &gfx)) {
+      return false;
+    }
+  } else if (name == "set_texture") {
+    if (!GetUint(args, "material_id", &first) ||
+        !GetUint(args, "texture_id", &second)) {
+      return false;
+    }
+    gfx = scenic::NewSetTextureCmd(first, second);
+  } else if (name == "set_event_mask") {
+    if (!GetUint(args, "id", &first) ||
+        !GetUint(args, "event_mask", &second)) {
+      return false;
+    }
+    gfx = scenic::NewSetEventMaskCmd(first, second);
+  } else {
+    FML_LOG(ERROR) << "Unknown scene command " << name;
+    return false;
+  }
+  *out = scenic::NewCommand(std::move(gfx));
+  return true;
+}
+
+}  // namespace
+
+std::string SceneReplayReport::ToString() const {
+  std::ostringstream stream;
+  stream << "frames: " << frames << ", commands in: " << commands_in
+         << ", commands out: " << commands_out
+         << ", mismatched frames: " << mismatched_frames;
+  return stream.str();
+}
+
+SceneReplayReport ReplaySceneCommands(const SceneReplayFrames& recorded,
+                                      const SceneReplayFrames& filtered) {
+  SceneReplayReport report;
+  ReplayScene recorded_scene;
+  ReplayScene filtered_scene;
+  report.frames = std::max(recorded.size(), filtered.size());
+  for (size_t i = 0; i < report.frames; i++) {
+    if (i < recorded.size()) {
+      for (const auto& command : recorded[i]) {
+        recorded_scene.Apply(command);
+      }
+      report.commands_in += recorded[i].size();
+    }
+    if (i < filtered.size()) {
+      for (const auto& command : filtered[i]) {
+        filtered_scene.Apply(command);
+      }
+      report.commands_out += filtered[i].size();
+    }
+    if (!(recorded_scene == filtered_scene)) {
+      report.mismatched_frames++;
+    }
+  }
+  report.recorded_scene = recorded_scene.ToString();
+  report.filtered_scene = filtered_scene.ToString();
+  return report;
+}
+
+bool ParseSceneReplayFrames(const std::string& json,
+                            SceneReplayFrames* out_frames) {
+  rapidjson::Document document;
+  document.Parse(json.data(), json.size());
+  if (document.HasParseError() || !document.IsArray()) {
+    return false;
+  }
+  SceneReplayFrames frames;
+  for (const auto& frame : document.GetArray()) {
+    if (!frame.IsArray()) {
+      return false;
+    }
+    frames.emplace_back();
+    for (const auto& command : frame.GetArray()) {
+      frames.back().emplace_back();
+      if (!ParseCommand(command, &frames.back().back())) {
+        return false;
+      }
+    }
+  }
+  *out_frames = std::move(frames);
+  return true;
+}
+
+bool LoadSceneReplayFrames(const std::string& path,
+                           SceneReplayFrames* out_frames) {
+  std::string json;
+  if (!dart_utils::ReadFileToString(path, &json)) {
+    FML_LOG(ERROR) << "Could not read scene commands " << path;
+    return false;
+  }
+  return ParseSceneReplayFrames(json, out_frames);
+}
+
+}  // namespace flutter_runner
@@ -0,0 +1,64 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_SCENE_REPLAY_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_SCENE_REPLAY_H_
+
+#include <fuchsia/ui/scenic/cpp/fidl.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace flutter_runner {
+
+// Replays, through a model of the scene graph Scenic builds from them, the
+// commands a session sent and what |SceneCommandBuffer| forwarded of them to
+// Scenic.  Filtering is only correct if both end up with the same scene
+// after every frame.
+//
+// The model keeps resources with the arguments they were created with and
+// the last command that set each of their properties, released nodes that
+// stay alive while attached, and the ordered children and parts of each
+// node.  It reads gfx commands itself rather than through
+// |SceneCommandBuffer::Classify|, so that a mistake there can't hide in both
+// the filter and its check.  Commands it does not model are kept in the
+// order they were applied, so that dropping any of them is noticed too.
+
+// The commands enqueued before each |Present|, in order, as a fake Scenic
+// session records them.
+using SceneReplayFrames =
+    std::vector<std::vector<fuchsia::ui::scenic::Command>>;
+
+struct SceneReplayReport {
+  size_t frames = 0;
+  size_t commands_in = 0;
+  size_t commands_out = 0;
+  // Frames after which the filtered scene differed from the recorded one.
+  size_t mismatched_frames = 0;
+  // The scenes after the last frame, as recorded and as filtered.
+  std::string recorded_scene;
+  std::string filtered_scene;
+
+  std::string ToString() const;
+};
+
+SceneReplayReport ReplaySceneCommands(const SceneReplayFrames& recorded,
+                                      const SceneReplayFrames& filtered);
+
+// Parses frames of commands from |json|, an array with an array of commands
+// for each frame.  Each command is an object with a single member, named
+// like the |fuchsia::ui::gfx::Command| it stands for, whose fields are named
+// like those of the command.  Only the commands Flutter's layer tree sends
+// are understood.  Returns false on malformed input.
+bool ParseSceneReplayFrames(const std::string& json,
+                            SceneReplayFrames* out_frames);
+
+// |ParseSceneReplayFrames| on the contents of the file at |path|.
+bool LoadSceneReplayFrames(const std::string& path,
+                           SceneReplayFrames* out_frames);
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_SCENE_REPLAY_H_
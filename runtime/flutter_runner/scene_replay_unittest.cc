@@ -0,0 +1,274 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/scene_replay.h"
+
+#include <gtest/gtest.h>
+#include <lib/fidl/cpp/clone.h>
+#include <lib/fidl/cpp/comparison.h>
+#include <lib/gtest/real_loop_fixture.h>
+#include <lib/ui/scenic/cpp/commands.h>
+#include <lib/ui/scenic/cpp/resources.h>
+#include <lib/ui/scenic/cpp/session.h>
+
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+
+#include "flutter_runner_fakes.h"
+#include "topaz/runtime/flutter_runner/scene_command_buffer.h"
+
+namespace flutter_runner_test {
+
+using flutter_runner::LoadSceneReplayFrames;
+using flutter_runner::ParseSceneReplayFrames;
+using flutter_runner::ReplaySceneCommands;
+using flutter_runner::SceneCommandBuffer;
+using flutter_runner::SceneReplayFrames;
+
+namespace {
+
+// Frames of commands transcribed from what the runner sends for a view with
+// an app bar, a solid body and, from the third frame on, a retained layer.
+// The view and the surfaces' memory and images are created with handles,
+// which don't fit in the file, so their creation is left out.
+constexpr char kSceneCommandsPath[] = "/pkg/data/testdata/scene_commands.json";
+
+void Present(scenic::Session* session) {
+  session->Present(0, [](fuchsia::images::PresentationInfo info) {});
+}
+
+// Sends frames the way the layer tree does: the view's root node and a
+// retained layer are configured again every frame, and the layers below are
+// rebuilt from new resources and swapped in for the previous frame's.
+void SendRebuiltLayers(scenic::Session* session) {
+  {
+    scenic::EntityNode root(session);
+    scenic::EntityNode retained(session);
+    root.AddChild(retained);
+    Present(session);
+
+    for (int frame = 0; frame < 4; frame++) {
+      root.SetTranslation(0.f, 0.f, 0.f);
+      retained.SetTranslation(0.f, frame % 2 == 0 ? 100.f : 90.f, 0.f);
+      retained.DetachChildren();
+
+      scenic::EntityNode layer(session);
+      scenic::ShapeNode shape(session);
+      scenic::Rectangle rect(session, 100.f, 10.f);
+      scenic::Material material(session);
+      material.SetColor(255, 0, 0, 255);
+      shape.SetShape(rect);
+      shape.SetMaterial(material);
+      layer.AddPart(shape);
+      layer.SetTranslation(0.f, 0.f, 1.f);
+      layer.SetTranslation(0.f, 10.f, 1.f);
+      retained.AddChild(layer);
+      if (frame == 3) {
+        // Moved elsewhere, then taken out again.
+        layer.Detach();
+        layer.Detach();
+        root.AddChild(layer);
+        retained.DetachChildren();
+      }
+      Present(session);
+    }
+
+    root.DetachChildren();
+    retained.Detach();
+    Present(session);
+  }
+  // The releases of the root and retained nodes.
+  Present(session);
+}
+
+}  // namespace
+
+class SceneReplayTest : public gtest::RealLoopFixture {
+ protected:
+  // Sends the same frames to two fake Scenic sessions, one straight from a
+  // |scenic::Session| and one through a |SceneCommandBuffer|, and returns
+  // what each received.
+  void RecordFrames(const std::function<void(scenic::Session*)>& send_frames,
+                    SceneReplayFrames* out_recorded,
+                    SceneReplayFrames* out_filtered) {
+    FakeScenicSession recorded;
+    scenic::Session recorded_session(recorded.NewBinding(dispatcher()).Bind(),
+                                     nullptr);
+    send_frames(&recorded_session);
+
+    FakeScenicSession filtered;
+    SceneCommandBuffer command_buffer(filtered.NewBinding(dispatcher()));
+    scenic::Session filtered_session(command_buffer.NewBinding().Bind(),
+                                     nullptr);
+    send_frames(&filtered_session);
+
+    RunLoopUntilIdle();
+    *out_recorded = recorded.TakeFrames();
+    *out_filtered = filtered.TakeFrames();
+  }
+
+  // Sends |frames| through a |SceneCommandBuffer|, presenting after each, and
+  // returns what it forwarded.
+  SceneReplayFrames FilterFrames(const SceneReplayFrames& frames) {
+    FakeScenicSession filtered;
+    SceneCommandBuffer command_buffer(filtered.NewBinding(dispatcher()));
+    fuchsia::ui::scenic::SessionPtr session;
+    session.Bind(command_buffer.NewBinding(), dispatcher());
+    for (const auto& frame : frames) {
+      std::vector<fuchsia::ui::scenic::Command> commands;
+      fidl::Clone(frame, &commands);
+      session->Enqueue(std::move(commands));
+      session->Present(0, {}, {},
+                       [](fuchsia::images::PresentationInfo info) {});
+    }
+    RunLoopUntilIdle();
+    return filtered.TakeFrames();
+  }
+};
+
+TEST_F(SceneReplayTest, FilteringKeepsTheScene) {
+  SceneReplayFrames recorded;
+  SceneReplayFrames filtered;
+  RecordFrames(SendRebuiltLayers, &recorded, &filtered);
+  ASSERT_EQ(recorded.size(), 7u);
+  ASSERT_EQ(filtered.size(), recorded.size());
+
+  auto report = ReplaySceneCommands(recorded, filtered);
+  SCOPED_TRACE(report.ToString());
+  EXPECT_EQ(report.mismatched_frames, 0u);
+  EXPECT_EQ(report.recorded_scene, report.filtered_scene);
+  EXPECT_LT(report.commands_out, report.commands_in);
+}
+
+TEST_F(SceneReplayTest, KeepsEveryCommandThatChangesTheScene) {
+  SceneReplayFrames recorded;
+  SceneReplayFrames filtered;
+  RecordFrames(
+      [](scenic::Session* session) {
+        scenic::EntityNode parent(session);
+        {
+          scenic::EntityNode child(session);
+          parent.SetTranslation(1.f, 0.f, 0.f);
+          parent.AddChild(child);
+          Present(session);
+          parent.SetTranslation(2.f, 0.f, 0.f);
+          child.Detach();
+        }
+        Present(session);
+      },
+      &recorded, &filtered);
+
+  auto report = ReplaySceneCommands(recorded, filtered);
+  SCOPED_TRACE(report.ToString());
+  EXPECT_EQ(report.mismatched_frames, 0u);
+  EXPECT_EQ(report.commands_out, report.commands_in);
+}
+
+TEST_F(SceneReplayTest, FilteringKeepsTheSceneOfRecordedCommands) {
+  SceneReplayFrames recorded;
+  ASSERT_TRUE(LoadSceneReplayFrames(kSceneCommandsPath, &recorded));
+  ASSERT_EQ(recorded.size(), 8u);
+  SceneReplayFrames filtered = FilterFrames(recorded);
+  ASSERT_EQ(filtered.size(), recorded.size());
+
+  auto report = ReplaySceneCommands(recorded, filtered);
+  SCOPED_TRACE(report.ToString());
+  EXPECT_EQ(report.mismatched_frames, 0u);
+  EXPECT_EQ(report.recorded_scene, report.filtered_scene);
+  // The first frame's detach of the root node's children, which it has none
+  // of yet.
+  EXPECT_EQ(report.commands_out, report.commands_in - 1);
+}
+
+// Replays the commands in the file named by SCENE_REPLAY_COMMANDS, in the
+// format of |ParseSceneReplayFrames|, through the filter.  Run with
+// --gtest_also_run_disabled_tests.
+TEST_F(SceneReplayTest, DISABLED_ReplaysCapturedCommands) {
+  const char* path = std::getenv("SCENE_REPLAY_COMMANDS");
+  ASSERT_NE(path, nullptr) << "SCENE_REPLAY_COMMANDS is not set";
+  SceneReplayFrames recorded;
+  ASSERT_TRUE(LoadSceneReplayFrames(path, &recorded));
+  auto report = ReplaySceneCommands(recorded, FilterFrames(recorded));
+  EXPECT_EQ(report.mismatched_frames, 0u);
+  std::cout << report.ToString() << std::endl;
+}
+
+TEST(SceneReplayParseTest, ParsesCommands) {
+  SceneReplayFrames frames;
+  ASSERT_TRUE(ParseSceneReplayFrames(
+      "[[{\"create_resource\":{\"id\":1,\"entity_node\":{}}},"
+      "{\"set_translation\":{\"id\":1,\"value\":[1,2.5,3]}}],"
+      "[],"
+      "[{\"set_scale\":{\"id\":1,\"variable_id\":7}},"
+      "{\"set_color\":{\"material_id\":2,\"value\":[1,2,3,4]}}]]",
+      &frames));
+  ASSERT_EQ(frames.size(), 3u);
+  ASSERT_EQ(frames[0].size(), 2u);
+  EXPECT_TRUE(fidl::Equals(
+      frames[0][0], scenic::NewCommand(scenic::NewCreateEntityNodeCmd(1))));
+  EXPECT_TRUE(fidl::Equals(frames[0][1],
+                           scenic::NewCommand(scenic::NewSetTranslationCmd(
+                               1, {1.f, 2.5f, 3.f}))));
+  EXPECT_TRUE(frames[1].empty());
+  ASSERT_EQ(frames[2].size(), 2u);
+  EXPECT_TRUE(fidl::Equals(
+      frames[2][0], scenic::NewCommand(scenic::NewSetScaleCmd(1, 7u))));
+  EXPECT_TRUE(fidl::Equals(
+      frames[2][1], scenic::NewCommand(scenic::NewSetColorCmd(2, 1, 2, 3, 4))));
+}
+
+TEST(SceneReplayParseTest, RejectsMalformedCommands) {
+  SceneReplayFrames frames;
+  EXPECT_FALSE(ParseSceneReplayFrames("[[", &frames));
+  EXPECT_FALSE(ParseSceneReplayFrames("{}", &frames));
+  EXPECT_FALSE(ParseSceneReplayFrames("[{}]", &frames));
+  EXPECT_FALSE(
+      ParseSceneReplayFrames("[[{\"present\":{\"id\":1}}]]", &frames));
+  EXPECT_FALSE(ParseSceneReplayFrames(
+      "[[{\"detach\":{\"id\":1},\"release_resource\":{\"id\":1}}]]",
+      &frames));
+  EXPECT_FALSE(ParseSceneReplayFrames(
+      "[[{\"set_translation\":{\"id\":1,\"value\":[1,2]}}]]", &frames));
+  EXPECT_FALSE(ParseSceneReplayFrames(
+      "[[{\"set_color\":{\"material_id\":1,\"value\":[1,2,3,256]}}]]",
+      &frames));
+}
+
+TEST(SceneReplayModelTest, NoticesADroppedCommand) {
+  SceneReplayFrames recorded(1);
+  recorded[0].push_back(scenic::NewCommand(scenic::NewCreateEntityNodeCmd(1)));
+  recorded[0].push_back(
+      scenic::NewCommand(scenic::NewSetTranslationCmd(1, {1.f, 2.f, 3.f})));
+  SceneReplayFrames filtered(1);
+  filtered[0].push_back(scenic::NewCommand(scenic::NewCreateEntityNodeCmd(1)));
+
+  auto report = ReplaySceneCommands(recorded, filtered);
+  EXPECT_EQ(report.mismatched_frames, 1u);
+  EXPECT_NE(report.recorded_scene, report.filtered_scene);
+}
+
+TEST(SceneReplayModelTest, ComparesWhatResourcesWereCreatedAs) {
+  SceneReplayFrames recorded(1);
+  recorded[0].push_back(
+      scenic::NewCommand(scenic::NewCreateRectangleCmd(1, 10.f, 20.f)));
+  SceneReplayFrames filtered(1);
+  filtered[0].push_back(
+      scenic::NewCommand(scenic::NewCreateRectangleCmd(1, 10.f, 30.f)));
+
+  EXPECT_EQ(ReplaySceneCommands(recorded, filtered).mismatched_frames, 1u);
+}
+
+TEST(SceneReplayModelTest, NoticesADroppedCommandItDoesNotModel) {
+  SceneReplayFrames recorded(1);
+  recorded[0].push_back(scenic::NewCommand(scenic::NewCreateEntityNodeCmd(1)));
+  recorded[0].push_back(
+      scenic::NewCommand(scenic::NewSetEnableDebugViewBoundsCmd(2, true)));
+  SceneReplayFrames filtered(1);
+  filtered[0].push_back(scenic::NewCommand(scenic::NewCreateEntityNodeCmd(1)));
+
+  EXPECT_EQ(ReplaySceneCommands(recorded, filtered).mismatched_frames, 1u);
+}
+
+}  // namespace flutter_runner_test
@@ -7,7 +7,6 @@
 #include "flutter/fml/make_copyable.h"
 #include "lib/fidl/cpp/optional.h"
 #include "lib/ui/scenic/cpp/commands.h"
-#include "vsync_recorder.h"
 #include "vsync_waiter.h"
 
 namespace flutter_runner {
@@ -15,15 +14,30 @@ namespace flutter_runner {
 SessionConnection::SessionConnection(
     std::string debug_label, fuchsia::ui::views::ViewToken view_token,
     fidl::InterfaceHandle<fuchsia::ui::scenic::Session> session,
-    fml::closure session_error_callback, zx_handle_t vsync_event_handle)
+    fml::closure session_error_callback, zx_handle_t vsync_event_handle,
+    std::shared_ptr<VsyncRecorder> vsync_recorder,
+    std::shared_ptr<FrameScheduler> frame_scheduler,
+    std::shared_ptr<FrameTimings> frame_timings,
+    size_t max_presents_in_flight)
     : debug_label_(std::move(debug_label)),
-      session_wrapper_(session.Bind(), nullptr),
+      command_buffer_(std::move(session)),
+      session_wrapper_(command_buffer_.NewBinding().Bind(), nullptr),
       root_view_(&session_wrapper_, std::move(view_token.value), debug_label),
       root_node_(&session_wrapper_),
       surface_producer_(
-          std::make_unique<VulkanSurfaceProducer>(&session_wrapper_)),
+          std::make_unique<VulkanSurfaceProducer>(&session_wrapper_,
+                                                  vsync_recorder,
+                                                  frame_timings)),
       scene_update_context_(&session_wrapper_, surface_producer_.get()),
-      vsync_event_handle_(vsync_event_handle) {
+      vsync_event_handle_(vsync_event_handle),
+      vsync_recorder_(std::move(vsync_recorder)),
+      frame_scheduler_(std::move(frame_scheduler)),
+      frame_timings_(std::move(frame_timings)),
+      present_throttle_(
+          max_presents_in_flight, [this] { PresentSession(); },
+          [handle = vsync_event_handle](bool raise) {
+            ToggleSignal(handle, raise);
+          }) {
   session_wrapper_.set_error_handler(
       [callback = session_error_callback](zx_status_t status) { callback(); });
 
@@ -40,31 +54,33 @@ SessionConnection::SessionConnection(
   // Signal is initially high indicating availability of the session.
   ToggleSignal(vsync_event_handle_, true);
 
-  PresentSession();
+  present_throttle_.OnFrame();
 }
 
 SessionConnection::~SessionConnection() = default;
 
 void SessionConnection::Present(
-    flutter::CompositorContext::ScopedFrame& frame) {
+    flutter::CompositorContext::ScopedFrame& frame,
+    FrameScheduler::FrameId frame_id) {
   TRACE_DURATION("gfx", "SessionConnection::Present");
   TRACE_FLOW_BEGIN("gfx", "SessionConnection::PresentSession",
                    next_present_session_trace_id_);
   next_present_session_trace_id_++;
 
-  // Throttle vsync if presentation callback is already pending. This allows
-  // the paint tasks for this frame to execute in parallel with presentation
-  // of last frame but still provides back-pressure to prevent us from queuing
-  // even more work.
-  if (presentation_callback_pending_) {
-    present_session_pending_ = true;
-    ToggleSignal(vsync_event_handle_, false);
-  } else {
-    PresentSession();
-  }
+  // Present now, or once a present in flight completes.  See
+  // |PresentThrottle| for how this provides back-pressure.
+  frames_to_present_.push_back(frame_id);
+  present_throttle_.OnFrame();
 
   // Execute paint tasks and signal fences.
+  const fml::TimePoint paint_start = fml::TimePoint::Now();
   auto surfaces_to_submit = scene_update_context_.ExecutePaintTasks(frame);
+  if (frame_timings_) {
+    const fml::TimeDelta paint_duration = fml::TimePoint::Now() - paint_start;
+    frame_timings_->Record(FramePhase::kExecutePaintTasks, paint_duration);
+    frame_timings_->RecordPaintTasks(surfaces_to_submit.size(),
+                                     paint_duration);
+  }
 
   // Tell the surface producer that a present has occurred so it can perform
   // book-keeping on buffer caches.
@@ -99,32 +115,55 @@ void SessionConnection::PresentSession() {
   TRACE_FLOW_BEGIN("gfx", "Session::Present", next_present_trace_id_);
   next_present_trace_id_++;
 
-  // Presentation callback is pending as a result of Present() call below.
-  presentation_callback_pending_ = true;
-
   // Flush all session ops. Paint tasks may not yet have executed but those are
   // fenced. The compositor can start processing ops while we finalize paint
   // tasks.
   session_wrapper_.Present(
       0,  // presentation_time. (placeholder).
-      [this, handle = vsync_event_handle_](
+      [this, frame_ids = std::move(frames_to_present_)](
           fuchsia::images::PresentationInfo presentation_info) {
-        presentation_callback_pending_ = false;
-        VsyncRecorder::GetInstance().UpdateVsyncInfo(presentation_info);
-        // Process pending PresentSession() calls.
-        if (present_session_pending_) {
-          present_session_pending_ = false;
-          PresentSession();
-        }
-        ToggleSignal(handle, true);
+        vsync_recorder_->UpdateVsyncInfo(presentation_info);
+        ReportFramesPresented(frame_ids, presentation_info);
+        // Process a pending PresentSession() call and raise the signal.
+        present_throttle_.OnPresentCompleted();
       }  // callback
   );
 
+  frames_to_present_.clear();
+
+  // Forward the frame to Scenic now, rather than once the raster task that
+  // called this has painted the surfaces.
+  {
+    FrameTimings::ScopedPhase phase(frame_timings_.get(),
+                                    FramePhase::kSceneCommandProxy);
+    command_buffer_.DispatchPending();
+  }
+
   // Prepare for the next frame. These ops won't be processed till the next
   // present.
   EnqueueClearOps();
 }
 
+void SessionConnection::ReportFramesPresented(
+    const std::vector<FrameScheduler::FrameId>& frame_ids,
+    const fuchsia::images::PresentationInfo& presentation_info) {
+  const fml::TimePoint presentation_time =
+      fml::TimePoint::FromEpochDelta(fml::TimeDelta::FromNanoseconds(
+          presentation_info.presentation_time));
+  const fml::TimeDelta presentation_interval =
+      fml::TimeDelta::FromNanoseconds(presentation_info.presentation_interval);
+  for (FrameScheduler::FrameId frame_id : frame_ids) {
+    frame_scheduler_->OnFramePresented(frame_id, presentation_time,
+                                       presentation_interval);
+  }
+  auto stats = frame_scheduler_->GetStats();
+  TRACE_COUNTER("flutter", "FrameScheduler", 0u,              //
+                "FramesPresented", stats.frames_presented,    //
+                "MissedDeadlines", stats.missed_deadlines,    //
+                "LateFrames", stats.late_frames               //
+  );
+}
+
 void SessionConnection::ToggleSignal(zx_handle_t handle, bool set) {
   const auto signal = VsyncWaiter::SessionPresentSignal;
   auto status = zx_object_signal(handle,            // handle
@@ -19,6 +19,11 @@
 #include "flutter/flow/scene_update_context.h"
 #include "flutter/fml/closure.h"
 #include "flutter/fml/macros.h"
+#include "frame_scheduler.h"
+#include "frame_timings.h"
+#include "present_throttle.h"
+#include "scene_command_buffer.h"
+#include "vsync_recorder.h"
 #include "vulkan_surface_producer.h"
 
 namespace flutter_runner {
@@ -31,7 +36,11 @@ class SessionConnection final {
                     fuchsia::ui::views::ViewToken view_token,
                     fidl::InterfaceHandle<fuchsia::ui::scenic::Session> session,
                     fml::closure session_error_callback,
-                    zx_handle_t vsync_event_handle);
+                    zx_handle_t vsync_event_handle,
+                    std::shared_ptr<VsyncRecorder> vsync_recorder,
+                    std::shared_ptr<FrameScheduler> frame_scheduler,
+                    std::shared_ptr<FrameTimings> frame_timings,
+                    size_t max_presents_in_flight);
 
   ~SessionConnection();
 
@@ -55,15 +64,24 @@ class SessionConnection final {
   }
 
   scenic::ContainerNode& root_node() { return root_node_; }
+
+  FrameScheduler& frame_scheduler() const { return *frame_scheduler_; }
+
+  // Where the raster phase times of this session go.  May be null.
+  FrameTimings* frame_timings() const { return frame_timings_.get(); }
   scenic::View* root_view() { return &root_view_; }
 
-  void Present(flutter::CompositorContext::ScopedFrame& frame);
+  // Presents the frame identified by |frame_id|.  See |FrameScheduler|.
+  void Present(flutter::CompositorContext::ScopedFrame& frame,
+               FrameScheduler::FrameId frame_id);
 
   void OnSessionSizeChangeHint(float width_change_factor,
                                float height_change_factor);
 
  private:
   const std::string debug_label_;
+  // Leaves out commands |session_wrapper_| sends that don't change the scene.
+  SceneCommandBuffer command_buffer_;
   scenic::Session session_wrapper_;
 
   scenic::View root_view_;
@@ -73,6 +91,12 @@ class SessionConnection final {
   flutter::SceneUpdateContext scene_update_context_;
 
   zx_handle_t vsync_event_handle_;
+  // Records the presentation info Scenic reports for this session.
+  std::shared_ptr<VsyncRecorder> vsync_recorder_;
+  std::shared_ptr<FrameScheduler> frame_scheduler_;
+  std::shared_ptr<FrameTimings> frame_timings_;
+  // The frames presented since the last |Session::Present|, which it shows.
+  std::vector<FrameScheduler::FrameId> frames_to_present_;
 
   // A flow event trace id for following |Session::Present| calls into
   // Scenic.  This will be incremented each |Session::Present| call.  By
@@ -82,13 +106,18 @@ class SessionConnection final {
   uint64_t next_present_session_trace_id_ = 0;
   uint64_t processed_present_session_trace_id_ = 0;
 
-  bool presentation_callback_pending_ = false;
-  bool present_session_pending_ = false;
+  // Calls |PresentSession| once Scenic has room for another frame.
+  PresentThrottle present_throttle_;
 
   void EnqueueClearOps();
 
   void PresentSession();
 
+  // Tell |FrameScheduler| when |frame_ids| were shown.
+  void ReportFramesPresented(
+      const std::vector<FrameScheduler::FrameId>& frame_ids,
+      const fuchsia::images::PresentationInfo& presentation_info);
+
   static void ToggleSignal(zx_handle_t handle, bool raise);
 
   FML_DISALLOW_COPY_AND_ASSIGN(SessionConnection);
@@ -0,0 +1,541 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/surface_pool.h"
+
+#include <trace/event.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "flutter/fml/logging.h"
+
+namespace flutter_runner {
+
+namespace {
+
+std::string ToString(const SkISize& size) {
+  return "{width: " + std::to_string(size.width()) +
+         ", height: " + std::to_string(size.height()) + "}";
+}
+
+}  // namespace
+
+SurfacePool::SurfacePool(std::unique_ptr<SurfacePoolBackend> backend,
+                         size_t max_bytes)
+    : backend_(std::move(backend)), max_bytes_(max_bytes) {
+  FML_DCHECK(backend_);
+}
+
+SurfacePool::~SurfacePool() = default;
+
+void SurfacePool::SetMaxBytes(size_t max_bytes) {
+  max_bytes_ = max_bytes;
+  EvictToBudget();
+}
+
+std::unique_ptr<SurfacePoolSurface> SurfacePool::AcquireSurface(
+    const SkISize& size) {
+  // The size arguments are what |ParseReplayTrace| replays.
+  TRACE_DURATION("flutter", "VulkanSurfacePool::AcquireSurface", "width",
+                 size.width(), "height", size.height());
+  trace_surfaces_acquired_++;
+  size_predictor_.OnSurfaceAcquired(size);
+  auto surface = GetCachedOrCreateSurface(size);
+
+  if (surface == nullptr) {
+    FML_DLOG(ERROR) << "Could not acquire surface";
+    return nullptr;
+  }
+
+  if (!surface->FlushSessionAcquireAndReleaseEvents()) {
+    FML_DLOG(ERROR) << "Could not flush acquire/release events for buffer.";
+    return nullptr;
+  }
+
+  return surface;
+}
+
+SurfacePoolSurface* SurfacePool::GetRetainedSurface(
+    const flutter::LayerRasterCacheKey& key) {
+  FML_DCHECK(HasRetainedNode(key));
+  auto& surface = retained_surfaces_[NormalizeRetainedKey(key)].surface;
+  trace_retained_hits_++;
+  if (surface->GetRetainedKey().matrix() != key.matrix()) {
+    trace_retained_translated_hits_++;
+  }
+  return surface.get();
+}
+
+flutter::LayerRasterCacheKey SurfacePool::NormalizeRetainedKey(
+    const flutter::LayerRasterCacheKey& key) {
+  SkMatrix matrix = key.matrix();
+  if (matrix.hasPerspective()) {
+    // The translation can't be separated from the rest of the transform.
+    return key;
+  }
+  // Translations that are within rounding error of a whole pixel count as
+  // whole, so that both sides of an integer map to the same key.
+  constexpr SkScalar kEpsilon = 1.f / 1024;
+  auto fractional_part = [kEpsilon](SkScalar translation) {
+    if (std::fabs(translation - std::round(translation)) < kEpsilon) {
+      return 0.f;
+    }
+    return translation - std::floor(translation);
+  };
+  matrix.setTranslateX(fractional_part(matrix.getTranslateX()));
+  matrix.setTranslateY(fractional_part(matrix.getTranslateY()));
+  return flutter::LayerRasterCacheKey(key.id(), matrix);
+}
+
+std::unique_ptr<SurfacePoolSurface> SurfacePool::GetCachedOrCreateSurface(
+    const SkISize& size) {
+  // First try to find a surface that exactly matches |size|.
+  if (auto exact_match = available_surfaces_.TakeExactMatch(size)) {
+    trace_surfaces_exact_hits_++;
+    return exact_match;
+  }
+
+  if (available_surfaces_.empty() && reserve_.empty()) {
+    RecordMiss(size);
+    return CreateSurface(size);
+  }
+
+  // Then, look for a surface that has enough memory to hold an image of size
+  // |size|, but is currently holding an image of a different size, first
+  // among the available surfaces and then in the reserve.  We only need to
+  // create an image up front if we have never seen the memory requirements
+  // for |size| before.
+  std::unique_ptr<SurfacePoolImage> image;
+  size_t memory_requirements_size = 0;
+  auto cached_size = memory_requirements_sizes_.find(size);
+  if (cached_size != memory_requirements_sizes_.end()) {
+    memory_requirements_size = cached_size->second;
+  } else {
+    image = backend_->CreateImage(size);
+    if (image == nullptr) {
+      FML_DLOG(ERROR) << "Failed to create an image of size: "
+                      << ToString(size);
+      return nullptr;
+    }
+    memory_requirements_size = image->GetMemoryRequirementsSize();
+    CacheMemoryRequirementsSize(size, memory_requirements_size);
+  }
+
+  auto acquired_surface =
+      available_surfaces_.TakeBestFit(memory_requirements_size);
+  if (acquired_surface == nullptr) {
+    RecordMiss(size);
+    acquired_surface = reserve_.TakeBestFit(memory_requirements_size);
+    if (acquired_surface != nullptr) {
+      trace_surfaces_reserve_hits_++;
+    }
+  }
+
+  // If no such surface exists, then create a new one.
+  if (acquired_surface == nullptr) {
+    return CreateSurface(size);
+  }
+
+  if (image == nullptr) {
+    image = backend_->CreateImage(size);
+    if (image == nullptr) {
+      FML_DLOG(ERROR) << "Failed to create an image of size: "
+                      << ToString(size);
+      RecycleSurface(std::move(acquired_surface));
+      return nullptr;
+    }
+  }
+
+  if (!backend_->BindToImage(acquired_surface.get(), std::move(image))) {
+    FML_DLOG(ERROR) << "Failed to swap surface to new image of size: "
+                    << ToString(size);
+    return CreateSurface(size);
+  }
+  FML_DCHECK(acquired_surface->IsValid());
+  trace_surfaces_reused_++;
+  return acquired_surface;
+}
+
+void SurfacePool::RecordMiss(const SkISize& size) {
+  if (recent_miss_sizes_.size() >= kMissHistorySize) {
+    recent_miss_sizes_.pop_front();
+  }
+  recent_miss_sizes_.push_back(size);
+}
+
+void SurfacePool::CacheMemoryRequirementsSize(const SkISize& size,
+                                              size_t memory_requirements_size) {
+  if (memory_requirements_sizes_.size() >= kMaxCachedMemoryRequirements) {
+    memory_requirements_sizes_.clear();
+  }
+  memory_requirements_sizes_[size] = memory_requirements_size;
+}
+
+bool SurfacePool::RefillReserve() {
+  if (!NeedsReserveRefill()) {
+    return false;
+  }
+  TRACE_DURATION("flutter", "VulkanSurfacePool::RefillReserve");
+
+  // Count the recent misses by size class, skipping classes the reserve
+  // already has a surface for.
+  auto size_class = [](const SkISize& size) {
+    auto round_up = [](int32_t dimension) {
+      return (dimension + kReserveSizeGranularity - 1) /
+             kReserveSizeGranularity * kReserveSizeGranularity;
+    };
+    return SkISize::Make(round_up(size.width()), round_up(size.height()));
+  };
+  std::unordered_map<SkISize, size_t, SkISizeHash> miss_counts;
+  for (const auto& size : recent_miss_sizes_) {
+    miss_counts[size_class(size)]++;
+  }
+  reserve_.ForEach([&miss_counts](const SurfacePoolSurface& surface) {
+    miss_counts.erase(surface.GetSize());
+  });
+  if (miss_counts.empty()) {
+    return false;
+  }
+  const SkISize size =
+      std::max_element(miss_counts.begin(), miss_counts.end(),
+                       [](const auto& a, const auto& b) {
+                         return a.second < b.second;
+                       })
+          ->first;
+
+  const size_t estimated_bytes = size.area() * 4;
+  if (GetHeldBytes() + estimated_bytes > max_bytes_) {
+    return false;
+  }
+
+  auto surface = CreateSurface(size);
+  if (surface == nullptr) {
+    FML_DLOG(ERROR) << "Failed to create reserve surface of size: "
+                    << ToString(size);
+    return false;
+  }
+  reserve_.Insert(std::move(surface));
+  return true;
+}
+
+void SurfacePool::SubmitSurface(std::unique_ptr<SurfacePoolSurface> surface) {
+  TRACE_DURATION("flutter", "VulkanSurfacePool::SubmitSurface");
+  if (!surface) {
+    return;
+  }
+
+  const flutter::LayerRasterCacheKey retained_key =
+      NormalizeRetainedKey(surface->GetRetainedKey());
+  if (retained_key.id() != 0) {
+    // Add the surface to |retained_surfaces_| if its retained key has a valid
+    // layer id (|retained_key.id()|).
+    //
+    // We have to add the entry to |retained_surfaces_| map early when it's
+    // still pending (|is_pending| = true). Otherwise (if we add the surface
+    // later when |SignalRetainedReady| is called), Flutter would fail to find
+    // the retained node before the painting is done (which could take multiple
+    // frames). Flutter would then create a new surface for the layer upon the
+    // failed lookup. The new surface would invalidate this surface, and before
+    // the new surface is done painting, another newer surface is likely to be
+    // created to replace the new surface. That would make the retained
+    // rendering much less useful in improving the performance.
+    auto existing = retained_surfaces_.find(retained_key);
+    if (existing != retained_surfaces_.end()) {
+      if (existing->second.is_pending ||
+          existing->second.surface->IsUsedInRetainedRendering()) {
+        // The surface retained under the same key is still being painted or
+        // is in this frame's scene, so it must stay.  Keep |surface| too, as
+        // an ordinary pending surface.
+        AddPendingSurface(std::move(surface));
+        return;
+      }
+      // Otherwise |surface| supersedes it.
+      RecycleRetainedSurface(retained_key);
+    }
+    retained_bytes_ += surface->GetAllocationSize();
+    auto& retained_surface = retained_surfaces_[retained_key];
+    retained_surface.is_pending = true;
+    retained_surface.surface = std::move(surface);
+    retained_surface.surface->SignalWritesFinished(
+        std::bind(&SurfacePool::SignalRetainedReady, this, retained_key));
+  } else {
+    AddPendingSurface(std::move(surface));
+  }
+}
+
+std::unique_ptr<SurfacePoolSurface> SurfacePool::CreateSurface(
+    const SkISize& size) {
+  TRACE_DURATION("flutter", "VulkanSurfacePool::CreateSurface", "width",
+                 size.width(), "height", size.height());
+  auto surface = backend_->CreateSurface(size);
+  if (surface == nullptr || !surface->IsValid()) {
+    return nullptr;
+  }
+  CacheMemoryRequirementsSize(size, surface->GetImageMemoryRequirementsSize());
+  trace_surfaces_created_++;
+  return surface;
+}
+
+void SurfacePool::RecycleSurface(std::unique_ptr<SurfacePoolSurface> surface) {
+  // The surface may have become invalid (for example it the fences could
+  // not be reset).
+  if (!surface->IsValid()) {
+    return;
+  }
+
+  // Recycle the buffer by putting it in the list of available surfaces,
+  // then make room for it if that took us over budget.  This may evict
+  // |surface| itself if it is the least valuable one.
+  available_surfaces_.Insert(std::move(surface));
+  EvictToBudget();
+}
+
+void SurfacePool::EvictToBudget() {
+  while (!available_surfaces_.empty() && GetHeldBytes() > max_bytes_) {
+    auto victim = available_surfaces_.TakeEvictionCandidate();
+    trace_surfaces_evicted_++;
+    trace_surfaces_evicted_bytes_ += victim->GetAllocationSize();
+  }
+}
+
+void SurfacePool::AddPendingSurface(
+    std::unique_ptr<SurfacePoolSurface> surface) {
+  uintptr_t surface_key = reinterpret_cast<uintptr_t>(surface.get());
+  auto insert_iterator = pending_surfaces_.insert(std::make_pair(
+      surface_key,        // key
+      std::move(surface)  // value
+      ));
+  if (insert_iterator.second) {
+    insert_iterator.first->second->SignalWritesFinished(
+        std::bind(&SurfacePool::RecyclePendingSurface, this, surface_key));
+  }
+}
+
+void SurfacePool::RecyclePendingSurface(uintptr_t surface_key) {
+  // Before we do anything, we must clear the surface from the collection of
+  // pending surfaces.
+  auto found_in_pending = pending_surfaces_.find(surface_key);
+  if (found_in_pending == pending_surfaces_.end()) {
+    return;
+  }
+
+  // Grab a hold of the surface to recycle and clear the entry in the
+  // pending surfaces collection.
+  auto surface_to_recycle = std::move(found_in_pending->second);
+  pending_surfaces_.erase(found_in_pending);
+
+  RecycleSurface(std::move(surface_to_recycle));
+}
+
+void SurfacePool::SignalRetainedReady(flutter::LayerRasterCacheKey key) {
+  retained_surfaces_[key].is_pending = false;
+}
+
+void SurfacePool::RecycleRetainedSurface(
+    const flutter::LayerRasterCacheKey& key) {
+  auto it = retained_surfaces_.find(key);
+  if (it == retained_surfaces_.end()) {
+    return;
+  }
+
+  // The surface should not be pending.
+  FML_DCHECK(!it->second.is_pending);
+
+  auto surface_to_recycle = std::move(it->second.surface);
+  retained_bytes_ -= surface_to_recycle->GetAllocationSize();
+  retained_surfaces_.erase(it);
+  RecycleSurface(std::move(surface_to_recycle));
+}
+
+void SurfacePool::AgeAndCollectOldBuffers() {
+  TRACE_DURATION("flutter", "VulkanSurfacePool::AgeAndCollectOldBuffers");
+
+  // Remove all surfaces that are no longer valid or are too old.
+  available_surfaces_.TakeIf([](SurfacePoolSurface& surface) {
+    return !surface.IsValid() || surface.AdvanceAndGetAge() >= kMaxSurfaceAge;
+  });
+
+  // Look for a surface that has both a larger memory allocation than is
+  // necessary for its image, and has a stable size history.
+  auto surface_to_remove =
+      available_surfaces_.TakeFirstIf([](const SurfacePoolSurface& surface) {
+        return surface.IsOversized() && surface.HasStableSizeHistory();
+      });
+  // If we found such a surface, then destroy it and cache a new one that only
+  // uses a necessary amount of memory.
+  if (surface_to_remove != nullptr) {
+    auto size = surface_to_remove->GetSize();
+    surface_to_remove.reset();
+    auto new_surface = CreateSurface(size);
+    if (new_surface != nullptr) {
+      available_surfaces_.Insert(std::move(new_surface));
+    } else {
+      FML_DLOG(ERROR) << "Failed to create a new shrunk surface";
+    }
+  }
+
+  // Recycle retained surfaces that are not used and not pending in this frame.
+  //
+  // It's safe to recycle any retained surfaces that are not pending no matter
+  // whether they're used or not. Hence if there's memory pressure, feel free to
+  // recycle all retained surfaces that are not pending.
+  std::vector<flutter::LayerRasterCacheKey> recycle_keys;
+  for (auto& [key, retained_surface] : retained_surfaces_) {
+    if (retained_surface.is_pending ||
+        retained_surface.surface->IsUsedInRetainedRendering()) {
+      // Reset the flag for the next frame
+      retained_surface.surface->ResetIsUsedInRetainedRendering();
+    } else {
+      recycle_keys.push_back(key);
+    }
+  }
+  for (auto& key : recycle_keys) {
+    RecycleRetainedSurface(key);
+  }
+
+  // Retained surfaces created this frame count against the budget too.
+  EvictToBudget();
+
+  size_predictor_.OnFrameEnd();
+
+  TraceStats();
+}
+
+size_t SurfacePool::ShrinkToFit() {
+  // Shrinking frees the slack of oversized surfaces, and compacting the arena
+  // frees whole blocks.  Arena-backed surfaces are counted in both, so
+  // shrinking one counts even if its block stays, which is why this is only
+  // an estimate.
+  auto device_bytes = [this] {
+    return GetHeldBytes() + backend_->GetArenaBytes();
+  };
+  const size_t bytes_before = device_bytes();
+
+  // Reset all oversized surfaces in |available_surfaces_| so that the old
+  // surfaces and new surfaces don't exist at the same time at any point,
+  // reducing our peak memory footprint.
+  std::vector<SkISize> sizes_to_recreate;
+  for (auto& surface :
+       available_surfaces_.TakeIf([](const SurfacePoolSurface& surface) {
+         return surface.IsOversized();
+       })) {
+    sizes_to_recreate.push_back(surface->GetSize());
+    surface.reset();
+  }
+  for (const auto& size : sizes_to_recreate) {
+    auto surface = CreateSurface(size);
+    if (surface != nullptr) {
+      available_surfaces_.Insert(std::move(surface));
+    } else {
+      FML_DLOG(ERROR) << "Failed to create resized surface";
+    }
+  }
+
+  CompactMemoryArena();
+
+  TraceStats();
+
+  const size_t bytes_after = device_bytes();
+  return bytes_before > bytes_after ? bytes_before - bytes_after : 0;
+}
+
+void SurfacePool::CompactMemoryArena() {
+  if (!backend_->IsArenaFragmented()) {
+    backend_->ReleaseEmptyArenaBlocks();
+    return;
+  }
+
+  TRACE_DURATION("flutter", "VulkanSurfacePool::CompactMemoryArena");
+  // The taken surfaces are destroyed right away.
+  available_surfaces_.TakeIf([](const SurfacePoolSurface& surface) {
+    return surface.IsValid() && surface.IsArenaBacked();
+  });
+  backend_->ReleaseEmptyArenaBlocks();
+}
+
+void SurfacePool::PreallocateSurfaces(float width_change_factor,
+                                      float height_change_factor) {
+  TRACE_DURATION("flutter", "VulkanSurfacePool::PreallocateSurfaces");
+  for (const auto& size : size_predictor_.PredictSizes(width_change_factor,
+                                                       height_change_factor)) {
+    // Estimate the memory a surface of |size| takes from what we know about
+    // its memory requirements, or from its pixel count.
+    auto cached_size = memory_requirements_sizes_.find(size);
+    const size_t estimated_bytes =
+        cached_size != memory_requirements_sizes_.end() ? cached_size->second
+                                                        : size.area() * 4;
+    if (GetHeldBytes() + estimated_bytes > max_bytes_) {
+      break;
+    }
+
+    auto surface = CreateSurface(size);
+    if (surface == nullptr) {
+      FML_DLOG(ERROR) << "Failed to preallocate surface of size: "
+                      << ToString(size);
+      break;
+    }
+    available_surfaces_.Insert(std::move(surface));
+    trace_surfaces_preallocated_++;
+  }
+}
+
+void SurfacePool::TraceStats() {
+  // Resources held in cached buffers.
+  const size_t cached_surfaces = available_surfaces_.size();
+  const size_t cached_surfaces_bytes = available_surfaces_.allocation_bytes();
+  const size_t hits = trace_surfaces_exact_hits_ + trace_surfaces_reused_;
+  const size_t hit_rate_percent =
+      trace_surfaces_acquired_ > 0 ? hits * 100 / trace_surfaces_acquired_
+                                   : 100;
+
+  // A counter takes at most 15 name/value pairs, so the stats are split by
+  // what they describe.
+  TRACE_COUNTER("flutter", "SurfacePool", 0u,                  //
+                "CachedCount", cached_surfaces,                //
+                "CachedBytes", cached_surfaces_bytes,          //
+                "BudgetBytes", max_bytes_,                     //
+                "Created", trace_surfaces_created_,            //
+                "Reused", trace_surfaces_reused_,              //
+                "Preallocated", trace_surfaces_preallocated_,  //
+                "ReserveCount", reserve_.size(),               //
+                "ReserveBytes", reserve_.allocation_bytes(),   //
+                "ReserveHits", trace_surfaces_reserve_hits_,   //
+                "PredictorHits", size_predictor_.hits(),       //
+                "PredictorMisses", size_predictor_.misses(),   //
+                "ExactHits", trace_surfaces_exact_hits_,       //
+                "HitRatePercent", hit_rate_percent             //
+  );
+
+  TRACE_COUNTER("flutter", "SurfacePoolRetained", 0u,              //
+                "Retained", retained_surfaces_.size(),             //
+                "RetainedBytes", retained_bytes_,                  //
+                "RetainedHits", trace_retained_hits_,              //
+                "RetainedTranslatedHits",                          //
+                trace_retained_translated_hits_,                   //
+                "Evicted", trace_surfaces_evicted_,                //
+                "EvictedBytes", trace_surfaces_evicted_bytes_,     //
+                "PendingInCompositor", pending_surfaces_.size()    //
+  );
+
+  backend_->TraceStats();
+
+  // Reset per present/frame stats.
+  trace_surfaces_acquired_ = 0;
+  trace_surfaces_exact_hits_ = 0;
+  trace_surfaces_created_ = 0;
+  trace_surfaces_reused_ = 0;
+  trace_surfaces_preallocated_ = 0;
+  trace_surfaces_reserve_hits_ = 0;
+  trace_retained_hits_ = 0;
+  trace_retained_translated_hits_ = 0;
+  trace_surfaces_evicted_ = 0;
+  trace_surfaces_evicted_bytes_ = 0;
+  size_predictor_.ResetCounters();
+}
+
+}  // namespace flutter_runner
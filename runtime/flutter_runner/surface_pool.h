@@ -0,0 +1,296 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_SURFACE_POOL_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_SURFACE_POOL_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+#include "flutter/flow/raster_cache_key.h"
+#include "flutter/fml/macros.h"
+#include "third_party/skia/include/core/SkSize.h"
+#include "topaz/runtime/flutter_runner/surface_size_index.h"
+#include "topaz/runtime/flutter_runner/surface_size_predictor.h"
+
+namespace flutter_runner {
+
+// What |SurfacePool| needs of the surfaces it caches.  See |VulkanSurface|.
+class SurfacePoolSurface {
+ public:
+  virtual ~SurfacePoolSurface() = default;
+
+  virtual bool IsValid() const = 0;
+
+  virtual SkISize GetSize() const = 0;
+
+  // The device memory the surface holds.
+  virtual size_t GetAllocationSize() const = 0;
+
+  // The device memory the surface's current image needs.
+  virtual size_t GetImageMemoryRequirementsSize() const = 0;
+
+  // The number of times this surface has been acquired for a frame.
+  virtual size_t GetUseCount() const = 0;
+
+  // Whether the surface's memory is a range of the backend's arena.
+  virtual bool IsArenaBacked() const = 0;
+
+  // Whether the size of the surface's image was the same for the last few
+  // frames.
+  virtual bool HasStableSizeHistory() const = 0;
+
+  virtual size_t AdvanceAndGetAge() = 0;
+
+  virtual bool FlushSessionAcquireAndReleaseEvents() = 0;
+
+  // Calls |on_writes_committed| once the compositor is done with the
+  // surface, which may destroy it.
+  virtual void SignalWritesFinished(
+      std::function<void(void)> on_writes_committed) = 0;
+
+  virtual const flutter::LayerRasterCacheKey& GetRetainedKey() const = 0;
+
+  virtual bool IsUsedInRetainedRendering() const = 0;
+
+  virtual void ResetIsUsedInRetainedRendering() = 0;
+
+  bool IsOversized() const {
+    return GetAllocationSize() > GetImageMemoryRequirementsSize();
+  }
+};
+
+// An image a |SurfacePoolSurface| can be bound to, created by
+// |SurfacePoolBackend::CreateImage|.
+class SurfacePoolImage {
+ public:
+  virtual ~SurfacePoolImage() = default;
+
+  virtual size_t GetMemoryRequirementsSize() const = 0;
+};
+
+// Creates the surfaces of a |SurfacePool| and binds them to images.  See
+// |VulkanSurfacePoolBackend|.
+class SurfacePoolBackend {
+ public:
+  virtual ~SurfacePoolBackend() = default;
+
+  // Returns nullptr on failure.
+  virtual std::unique_ptr<SurfacePoolSurface> CreateSurface(
+      const SkISize& size) = 0;
+
+  // Returns nullptr on failure.
+  virtual std::unique_ptr<SurfacePoolImage> CreateImage(
+      const SkISize& size) = 0;
+
+  // |image| was created by |CreateImage|.  The surface may become invalid if
+  // this fails.
+  virtual bool BindToImage(SurfacePoolSurface* surface,
+                           std::unique_ptr<SurfacePoolImage> image) = 0;
+
+  // The device memory held by blocks surfaces are sub-allocated from.
+  virtual size_t GetArenaBytes() const { return 0; }
+
+  virtual bool IsArenaFragmented() const { return false; }
+
+  virtual void ReleaseEmptyArenaBlocks() {}
+
+  // Emits any counters of its own along with the pool's.
+  virtual void TraceStats() {}
+};
+
+// Caches the surfaces Flutter paints layers into across frames: surfaces
+// waiting for the compositor to release them, surfaces available for reuse,
+// a small reserve for cache misses, and surfaces retained for a layer.
+//
+// The pool only decides which surface to hand out, keep or destroy.  Creating
+// surfaces and binding them to images is up to its |SurfacePoolBackend|, so
+// that the same policy runs against Vulkan in the runner and against fakes in
+// tests and in |ReplaySurfacePool|.
+class SurfacePool {
+ public:
+  // By default, keep about as much memory in cached and retained surfaces as
+  // 12 full-screen 1080p surfaces take, which is how many surfaces the pool
+  // used to cache regardless of their size.
+  static constexpr size_t kDefaultMaxBytes = 96 * (1 << 20);
+  // If a surface doesn't get used for 3 or more generations, we discard it.
+  static constexpr size_t kMaxSurfaceAge = 3;
+  // Bound on the number of distinct sizes whose memory requirements are
+  // remembered.  Resize animations can produce a new size every frame.
+  static constexpr size_t kMaxCachedMemoryRequirements = 128;
+  // Number of spare surfaces kept to serve cache misses without allocating.
+  static constexpr size_t kReserveSize = 2;
+  // Reserved surfaces are created in size classes that are a multiple of this
+  // many pixels in each dimension, so that one can serve any miss of a
+  // slightly smaller size.
+  static constexpr int32_t kReserveSizeGranularity = 64;
+  // Number of recent cache misses whose sizes guide what to reserve.
+  static constexpr size_t kMissHistorySize = 32;
+
+  explicit SurfacePool(std::unique_ptr<SurfacePoolBackend> backend,
+                       size_t max_bytes = kDefaultMaxBytes);
+
+  ~SurfacePool();
+
+  // The budget for the memory held by |available_surfaces_|, |reserve_| and
+  // |retained_surfaces_|.  Only available surfaces are evicted to stay within
+  // it, so retained surfaces alone may exceed it for a while.
+  size_t max_bytes() const { return max_bytes_; }
+  void SetMaxBytes(size_t max_bytes);
+
+  // The bytes held by available, retained and reserved surfaces.
+  size_t GetHeldBytes() const {
+    return available_surfaces_.allocation_bytes() + retained_bytes_ +
+           reserve_.allocation_bytes();
+  }
+
+  size_t available_count() const { return available_surfaces_.size(); }
+  size_t reserve_count() const { return reserve_.size(); }
+  size_t retained_count() const { return retained_surfaces_.size(); }
+  size_t pending_count() const { return pending_surfaces_.size(); }
+
+  std::unique_ptr<SurfacePoolSurface> AcquireSurface(const SkISize& size);
+
+  void SubmitSurface(std::unique_ptr<SurfacePoolSurface> surface);
+
+  void AgeAndCollectOldBuffers();
+
+  // Shrink all oversized surfaces in |available_surfaces_| to as small as
+  // they can be, and compact the backend's arena if it has become
+  // fragmented.  Returns roughly how many bytes of device memory that freed.
+  size_t ShrinkToFit();
+
+  // Whether |RefillReserve| has anything to do.
+  bool NeedsReserveRefill() const {
+    return reserve_.size() < kReserveSize && !recent_miss_sizes_.empty();
+  }
+
+  // Create one surface for the reserve, sized for the most common recent
+  // cache miss that the reserve does not cover yet.  Returns whether a surface
+  // was created.  This is meant to be called between frames, so that misses
+  // during a frame don't have to allocate.
+  bool RefillReserve();
+
+  // Create surfaces of the sizes the next frames are expected to use after
+  // Scenic hinted at a view size change, as far as the budget allows.
+  void PreallocateSurfaces(float width_change_factor,
+                           float height_change_factor);
+
+  // For |VulkanSurfaceProducer::HasRetainedNode|.
+  //
+  // Keys whose matrices differ only by a whole number of pixels of translation
+  // find the same retained surface.  See |NormalizeRetainedKey|.
+  bool HasRetainedNode(const flutter::LayerRasterCacheKey& key) const {
+    return retained_surfaces_.find(NormalizeRetainedKey(key)) !=
+           retained_surfaces_.end();
+  }
+
+  // The surface retained for |key|, whose retained node is what
+  // |VulkanSurfaceProducer::GetRetainedNode| returns.  |HasRetainedNode| must
+  // be true for |key|.
+  SurfacePoolSurface* GetRetainedSurface(
+      const flutter::LayerRasterCacheKey& key);
+
+  // Returns |key| with the integer part of its translation removed.
+  //
+  // The pixels of a retained surface don't change when its layer moves by
+  // whole pixels, and the retained node is positioned by the Scenic nodes of
+  // its ancestors, which carry the translation.  So a layer that was only
+  // scrolled or moved can reuse its retained node as is.
+  static flutter::LayerRasterCacheKey NormalizeRetainedKey(
+      const flutter::LayerRasterCacheKey& key);
+
+ protected:
+  const SurfacePoolBackend& backend() const { return *backend_; }
+
+ private:
+  // Struct for retained_surfaces_ map.
+  struct RetainedSurface {
+    // If |is_pending| is true, the |surface| is still under painting
+    // (similar to those in |pending_surfaces_|) so we can't recycle the
+    // |surface| yet.
+    bool is_pending;
+    std::unique_ptr<SurfacePoolSurface> surface;
+  };
+
+  std::unique_ptr<SurfacePoolBackend> backend_;
+  size_t max_bytes_;
+  SurfaceSizeIndex<SurfacePoolSurface> available_surfaces_;
+  std::unordered_map<uintptr_t, std::unique_ptr<SurfacePoolSurface>>
+      pending_surfaces_;
+
+  // Retained surfaces keyed by the layer that created and used the surface,
+  // with keys normalized by |NormalizeRetainedKey|.
+  flutter::LayerRasterCacheKey::Map<RetainedSurface> retained_surfaces_;
+  // The sum of |GetAllocationSize()| over |retained_surfaces_|.
+  size_t retained_bytes_ = 0;
+
+  // The memory requirements of an image of a given size, so that we don't
+  // have to create a probe image on every cache miss.
+  std::unordered_map<SkISize, size_t, SkISizeHash> memory_requirements_sizes_;
+
+  SurfaceSizePredictor size_predictor_;
+
+  // Spare surfaces that are only handed out when |available_surfaces_| has
+  // nothing suitable.  Unlike available surfaces, they don't age out.
+  SurfaceSizeIndex<SurfacePoolSurface> reserve_;
+  // Sizes of the most recent acquisitions that found no available surface.
+  std::deque<SkISize> recent_miss_sizes_;
+
+  size_t trace_surfaces_acquired_ = 0;
+  size_t trace_surfaces_exact_hits_ = 0;
+  size_t trace_surfaces_created_ = 0;
+  size_t trace_surfaces_reused_ = 0;
+  size_t trace_surfaces_preallocated_ = 0;
+  size_t trace_surfaces_reserve_hits_ = 0;
+  size_t trace_retained_hits_ = 0;
+  size_t trace_retained_translated_hits_ = 0;
+  size_t trace_surfaces_evicted_ = 0;
+  size_t trace_surfaces_evicted_bytes_ = 0;
+
+  std::unique_ptr<SurfacePoolSurface> GetCachedOrCreateSurface(
+      const SkISize& size);
+
+  void RecordMiss(const SkISize& size);
+
+  void CacheMemoryRequirementsSize(const SkISize& size,
+                                   size_t memory_requirements_size);
+
+  std::unique_ptr<SurfacePoolSurface> CreateSurface(const SkISize& size);
+
+  void RecycleSurface(std::unique_ptr<SurfacePoolSurface> surface);
+
+  // Release the available surfaces that live in the backend's arena, so that
+  // the free ranges left behind by other surfaces coalesce.  Their ranges are
+  // only free once the compositor is done with them, so the surfaces are not
+  // recreated here: surfaces acquired later are allocated from the coalesced
+  // ranges.
+  void CompactMemoryArena();
+
+  // Evict available surfaces, least valuable first, until the pool is within
+  // |max_bytes_| or there are no available surfaces left.
+  void EvictToBudget();
+
+  void AddPendingSurface(std::unique_ptr<SurfacePoolSurface> surface);
+
+  void RecyclePendingSurface(uintptr_t surface_key);
+
+  // Clear the |is_pending| flag of the retained surface.
+  void SignalRetainedReady(flutter::LayerRasterCacheKey key);
+
+  // Remove the corresponding surface from |retained_surfaces| and recycle it.
+  // The surface must not be pending.
+  void RecycleRetainedSurface(const flutter::LayerRasterCacheKey& key);
+
+  void TraceStats();
+
+  FML_DISALLOW_COPY_AND_ASSIGN(SurfacePool);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_SURFACE_POOL_H_
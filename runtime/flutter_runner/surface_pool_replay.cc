@@ -0,0 +1,244 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/surface_pool_replay.h"
+
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include <utility>
+
+#include "flutter/fml/logging.h"
+#include "topaz/runtime/dart/utils/files.h"
+#include "topaz/runtime/flutter_runner/trace_events.h"
+
+namespace flutter_runner {
+
+namespace {
+
+constexpr char kAcquireSurfaceEvent[] = "VulkanSurfacePool::AcquireSurface";
+constexpr char kEndFrameEvent[] = "VulkanSurfacePool::AgeAndCollectOldBuffers";
+
+class ReplayImage final : public SurfacePoolImage {
+ public:
+  explicit ReplayImage(const SkISize& size) : size(size) {}
+
+  // |SurfacePoolImage|
+  size_t GetMemoryRequirementsSize() const override {
+    return ReplaySurface::MemoryRequirementsSize(size);
+  }
+
+  const SkISize size;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(ReplayImage);
+};
+
+}  // namespace
+
+size_t ReplaySurface::MemoryRequirementsSize(const SkISize& size) {
+  constexpr size_t kPageSize = 64 * 1024;
+  size_t bytes = 4u * size.width() * size.height();
+  return (bytes + kPageSize - 1) / kPageSize * kPageSize;
+}
+
+ReplaySurface::ReplaySurface(ReplaySurfacePoolBackend* backend,
+                             const SkISize& size)
+    : backend_(backend),
+      size_(size),
+      allocation_size_(MemoryRequirementsSize(size)) {
+  size_history_.fill(SkISize::MakeEmpty());
+  auto& stats = backend_->stats_;
+  stats.created++;
+  stats.live++;
+  stats.live_bytes += allocation_size_;
+  stats.peak_bytes = std::max(stats.peak_bytes, stats.live_bytes);
+}
+
+ReplaySurface::~ReplaySurface() {
+  auto& stats = backend_->stats_;
+  stats.destroyed++;
+  stats.destroyed_bytes += allocation_size_;
+  stats.live--;
+  stats.live_bytes -= allocation_size_;
+}
+
+size_t ReplaySurface::AdvanceAndGetAge() {
+  size_history_[size_history_index_] = size_;
+  size_history_index_ = (size_history_index_ + 1) % kSizeHistorySize;
+  return ++age_;
+}
+
+bool ReplaySurface::FlushSessionAcquireAndReleaseEvents() {
+  use_count_++;
+  age_ = 0;
+  return true;
+}
+
+void ReplaySurface::SignalWritesFinished(
+    std::function<void(void)> on_writes_committed) {
+  FML_DCHECK(on_writes_committed);
+  pending_on_writes_committed_ = std::move(on_writes_committed);
+}
+
+void ReplaySurface::Release() {
+  // The callback may destroy this surface, so don't touch it afterwards.
+  auto on_writes_committed = std::move(pending_on_writes_committed_);
+  pending_on_writes_committed_ = nullptr;
+  if (on_writes_committed) {
+    on_writes_committed();
+  }
+}
+
+std::unique_ptr<SurfacePoolSurface> ReplaySurfacePoolBackend::CreateSurface(
+    const SkISize& size) {
+  return std::make_unique<ReplaySurface>(this, size);
+}
+
+std::unique_ptr<SurfacePoolImage> ReplaySurfacePoolBackend::CreateImage(
+    const SkISize& size) {
+  return std::make_unique<ReplayImage>(size);
+}
+
+bool ReplaySurfacePoolBackend::BindToImage(
+    SurfacePoolSurface* surface,
+    std::unique_ptr<SurfacePoolImage> image) {
+  FML_DCHECK(surface->GetAllocationSize() >=
+             image->GetMemoryRequirementsSize());
+  static_cast<ReplaySurface*>(surface)->size_ =
+      static_cast<ReplayImage*>(image.get())->size;
+  stats_.bound++;
+  return true;
+}
+
+ReplaySurfacePool::ReplaySurfacePool(size_t max_bytes)
+    : SurfacePool(std::make_unique<ReplaySurfacePoolBackend>(), max_bytes) {}
+
+ReplaySurfacePool::~ReplaySurfacePool() = default;
+
+std::unique_ptr<ReplaySurface> ReplaySurfacePool::AcquireSurface(
+    const SkISize& size) {
+  return std::unique_ptr<ReplaySurface>(
+      static_cast<ReplaySurface*>(SurfacePool::AcquireSurface(size).release()));
+}
+
+const ReplaySurface& ReplaySurfacePool::GetRetainedNode(
+    const flutter::LayerRasterCacheKey& key) {
+  return static_cast<ReplaySurface*>(GetRetainedSurface(key))
+      ->GetRetainedNode();
+}
+
+
+bool ParseReplayTrace(const std::string& json,
+                      std::vector<ReplayFrame>* out_frames) {
+  std::vector<TraceEvent> events;
+  if (!ParseTraceEvents(json, {kAcquireSurfaceEvent, kEndFrameEvent},
+                        &events)) {
+    return false;
+  }
+
+  std::vector<ReplayFrame> frames;
+  ReplayFrame frame;
+  for (const auto& event : events) {
+    if (event.name == kEndFrameEvent) {
+      frames.push_back(std::move(frame));
+      frame = ReplayFrame();
+      continue;
+    }
+    auto width = event.args.find("width");
+    auto height = event.args.find("height");
+    if (width == event.args.end() || height == event.args.end() ||
+        width->second <= 0 || height->second <= 0) {
+      return false;
+    }
+    frame.acquired_sizes.push_back(SkISize::Make(width->second, height->second));
+  }
+  if (!frame.acquired_sizes.empty()) {
+    frames.push_back(std::move(frame));
+  }
+  *out_frames = std::move(frames);
+  return true;
+}
+
+bool LoadReplayTrace(const std::string& path,
+                     std::vector<ReplayFrame>* out_frames) {
+  std::string json;
+  if (!dart_utils::ReadFileToString(path, &json)) {
+    FML_LOG(ERROR) << "Could not read trace " << path;
+    return false;
+  }
+  return ParseReplayTrace(json, out_frames);
+}
+
+double SurfacePoolReplayReport::AllocationsPerFrame() const {
+  return frames == 0 ? 0 : static_cast<double>(created) / frames;
+}
+
+double SurfacePoolReplayReport::ReuseRatio() const {
+  return acquired == 0
+             ? 0
+             : static_cast<double>(exact_hits + reused) / acquired;
+}
+
+double SurfacePoolReplayReport::ChurnBytesPerFrame() const {
+  return frames == 0 ? 0 : static_cast<double>(destroyed_bytes) / frames;
+}
+
+std::string SurfacePoolReplayReport::ToString() const {
+  std::ostringstream stream;
+  stream << "frames: " << frames << ", peak bytes: " << peak_bytes
+         << ", allocations per frame: " << AllocationsPerFrame()
+         << ", reuse ratio: " << ReuseRatio()
+         << ", churn bytes per frame: " << ChurnBytesPerFrame()
+         << " (created: " << created << ", destroyed: " << destroyed << ")";
+  return stream.str();
+}
+
+SurfacePoolReplayReport ReplaySurfacePoolTrace(
+    const std::vector<ReplayFrame>& frames, size_t max_bytes,
+    size_t frames_in_compositor) {
+  ReplaySurfacePool pool(max_bytes);
+  const auto& stats = pool.stats();
+  SurfacePoolReplayReport report;
+
+  // Submitted surfaces belong to the pool, which destroys none of them before
+  // they are released.
+  struct SubmittedSurface {
+    size_t frame;
+    ReplaySurface* surface;
+  };
+  std::deque<SubmittedSurface> submitted;
+
+  for (size_t frame = 0; frame < frames.size(); frame++) {
+    while (!submitted.empty() &&
+           submitted.front().frame + frames_in_compositor < frame) {
+      submitted.front().surface->Release();
+      submitted.pop_front();
+    }
+
+    for (const auto& size : frames[frame].acquired_sizes) {
+      const size_t created = stats.created;
+      const size_t bound = stats.bound;
+      auto surface = pool.AcquireSurface(size);
+      FML_CHECK(surface);
+      report.acquired++;
+      if (stats.bound != bound) {
+        report.reused++;
+      } else if (stats.created == created) {
+        report.exact_hits++;
+      }
+      submitted.push_back({frame, surface.get()});
+      pool.SubmitSurface(std::move(surface));
+    }
+    pool.AgeAndCollectOldBuffers();
+    report.frames++;
+  }
+
+  report.created = stats.created;
+  report.destroyed = stats.destroyed;
+  report.destroyed_bytes = stats.destroyed_bytes;
+  report.peak_bytes = stats.peak_bytes;
+  return report;
+}
+
+}  // namespace flutter_runner
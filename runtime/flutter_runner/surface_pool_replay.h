@@ -0,0 +1,233 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_SURFACE_POOL_REPLAY_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_SURFACE_POOL_REPLAY_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "flutter/flow/raster_cache_key.h"
+#include "flutter/fml/macros.h"
+#include "third_party/skia/include/core/SkSize.h"
+#include "topaz/runtime/flutter_runner/surface_pool.h"
+
+namespace flutter_runner {
+
+class ReplaySurfacePoolBackend;
+
+// Stands in for |VulkanSurface| in a |SurfacePool|, without a device.
+// Memory requirements are 4 bytes per pixel rounded up to a 64KiB page.
+//
+// Like a |VulkanSurface|, a submitted surface stays with the compositor until
+// it is released, which here is up to whoever drives the pool: see
+// |Release|.
+class ReplaySurface final : public SurfacePoolSurface {
+ public:
+  static size_t MemoryRequirementsSize(const SkISize& size);
+
+  ReplaySurface(ReplaySurfacePoolBackend* backend, const SkISize& size);
+
+  ~ReplaySurface() override;
+
+  // |SurfacePoolSurface|
+  bool IsValid() const override { return true; }
+
+  // |SurfacePoolSurface|
+  SkISize GetSize() const override { return size_; }
+
+  // |SurfacePoolSurface|
+  size_t GetAllocationSize() const override { return allocation_size_; }
+
+  // |SurfacePoolSurface|
+  size_t GetImageMemoryRequirementsSize() const override {
+    return MemoryRequirementsSize(size_);
+  }
+
+  // |SurfacePoolSurface|
+  size_t GetUseCount() const override { return use_count_; }
+
+  // |SurfacePoolSurface|
+  bool IsArenaBacked() const override { return false; }
+
+  // |SurfacePoolSurface|
+  bool HasStableSizeHistory() const override {
+    return std::equal(size_history_.begin() + 1, size_history_.end(),
+                      size_history_.begin());
+  }
+
+  // |SurfacePoolSurface|
+  size_t AdvanceAndGetAge() override;
+
+  // |SurfacePoolSurface|
+  bool FlushSessionAcquireAndReleaseEvents() override;
+
+  // |SurfacePoolSurface|
+  void SignalWritesFinished(
+      std::function<void(void)> on_writes_committed) override;
+
+  // Calls back the pool as if the compositor had released the surface, which
+  // may destroy it.  Does nothing if the surface was never submitted.
+  void Release();
+
+  // |SurfacePoolSurface|
+  const flutter::LayerRasterCacheKey& GetRetainedKey() const override {
+    return retained_key_;
+  }
+
+  // There is no Scenic node to retain; the surface stands in for it.
+  const ReplaySurface& GetRetainedNode() {
+    used_in_retained_rendering_ = true;
+    return *this;
+  }
+
+  // |SurfacePoolSurface|
+  bool IsUsedInRetainedRendering() const override {
+    return used_in_retained_rendering_;
+  }
+
+  // |SurfacePoolSurface|
+  void ResetIsUsedInRetainedRendering() override {
+    used_in_retained_rendering_ = false;
+  }
+
+  void SetRetainedKey(const flutter::LayerRasterCacheKey& key) {
+    retained_key_ = key;
+  }
+
+ private:
+  friend class ReplaySurfacePoolBackend;
+
+  static constexpr size_t kSizeHistorySize = 4;
+
+  ReplaySurfacePoolBackend* const backend_;
+  SkISize size_;
+  const size_t allocation_size_;
+  size_t use_count_ = 0;
+  size_t age_ = 0;
+  std::array<SkISize, kSizeHistorySize> size_history_;
+  size_t size_history_index_ = 0;
+  std::function<void()> pending_on_writes_committed_;
+  flutter::LayerRasterCacheKey retained_key_ = {0, SkMatrix::MakeScale(1, 1)};
+  bool used_in_retained_rendering_ = false;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(ReplaySurface);
+};
+
+// Creates |ReplaySurface|s and counts what a |SurfacePool| does with them.
+class ReplaySurfacePoolBackend final : public SurfacePoolBackend {
+ public:
+  struct Stats {
+    size_t created = 0;
+    // Surfaces rebound to an image of another size.
+    size_t bound = 0;
+    size_t destroyed = 0;
+    size_t destroyed_bytes = 0;
+    size_t live = 0;
+    size_t live_bytes = 0;
+    size_t peak_bytes = 0;
+  };
+
+  ReplaySurfacePoolBackend() = default;
+
+  ~ReplaySurfacePoolBackend() override = default;
+
+  const Stats& stats() const { return stats_; }
+
+  // |SurfacePoolBackend|
+  std::unique_ptr<SurfacePoolSurface> CreateSurface(
+      const SkISize& size) override;
+
+  // |SurfacePoolBackend|
+  std::unique_ptr<SurfacePoolImage> CreateImage(const SkISize& size) override;
+
+  // |SurfacePoolBackend|
+  bool BindToImage(SurfacePoolSurface* surface,
+                   std::unique_ptr<SurfacePoolImage> image) override;
+
+ private:
+  friend class ReplaySurface;
+
+  Stats stats_;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(ReplaySurfacePoolBackend);
+};
+
+// A |SurfacePool| of |ReplaySurface|s.
+class ReplaySurfacePool final : public SurfacePool {
+ public:
+  explicit ReplaySurfacePool(size_t max_bytes = kDefaultMaxBytes);
+
+  ~ReplaySurfacePool();
+
+  const ReplaySurfacePoolBackend::Stats& stats() const {
+    return static_cast<const ReplaySurfacePoolBackend&>(backend()).stats();
+  }
+
+  std::unique_ptr<ReplaySurface> AcquireSurface(const SkISize& size);
+
+  const ReplaySurface& GetRetainedNode(
+      const flutter::LayerRasterCacheKey& key);
+
+ private:
+  FML_DISALLOW_COPY_AND_ASSIGN(ReplaySurfacePool);
+};
+
+// The sizes of the surfaces acquired in one frame, in order.
+struct ReplayFrame {
+  std::vector<SkISize> acquired_sizes;
+};
+
+// Extracts the surface acquisitions of each frame from a trace captured on a
+// device with the "flutter" category and exported as JSON.  Acquisitions are
+// the width and height arguments of "VulkanSurfacePool::AcquireSurface"
+// events, and "VulkanSurfacePool::AgeAndCollectOldBuffers" ends a frame.
+// The trace should cover a single view.  Returns false on malformed input.
+bool ParseReplayTrace(const std::string& json,
+                      std::vector<ReplayFrame>* out_frames);
+
+// |ParseReplayTrace| on the contents of the file at |path|.
+bool LoadReplayTrace(const std::string& path,
+                     std::vector<ReplayFrame>* out_frames);
+
+struct SurfacePoolReplayReport {
+  size_t frames = 0;
+  size_t acquired = 0;
+  size_t exact_hits = 0;
+  size_t reused = 0;
+  // Surfaces created to serve an acquisition or to shrink an oversized one.
+  size_t created = 0;
+  // Surfaces destroyed for being too old, oversized or over budget.
+  size_t destroyed = 0;
+  size_t destroyed_bytes = 0;
+  // The most memory held by surfaces at once, including those in the
+  // compositor.
+  size_t peak_bytes = 0;
+
+  double AllocationsPerFrame() const;
+  // The fraction of acquisitions served without creating a surface.
+  double ReuseRatio() const;
+  // Bytes destroyed per frame, which had to be allocated at some point and
+  // often are again.
+  double ChurnBytesPerFrame() const;
+
+  std::string ToString() const;
+};
+
+// Replays |frames| through a |SurfacePool| with a budget of |max_bytes|.
+// Surfaces acquired in a frame are held by the compositor until
+// |frames_in_compositor| more frames have been acquired.
+SurfacePoolReplayReport ReplaySurfacePoolTrace(
+    const std::vector<ReplayFrame>& frames,
+    size_t max_bytes = ReplaySurfacePool::kDefaultMaxBytes,
+    size_t frames_in_compositor = 1);
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_SURFACE_POOL_REPLAY_H_
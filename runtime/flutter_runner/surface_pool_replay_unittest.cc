@@ -0,0 +1,184 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/surface_pool_replay.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "topaz/runtime/dart/utils/files.h"
+
+namespace flutter_runner_test {
+
+using flutter_runner::LoadReplayTrace;
+using flutter_runner::ParseReplayTrace;
+using flutter_runner::ReplayFrame;
+using flutter_runner::ReplaySurfacePoolTrace;
+
+namespace {
+
+// Writes the pool's events for |frames| as a JSON trace, as the runner emits
+// them: each frame's acquisitions, then the end of frame.
+std::string TraceJson(const std::vector<std::vector<SkISize>>& frames) {
+  std::string events;
+  int timestamp = 0;
+  auto add_event = [&](const std::string& name, const std::string& args) {
+    if (!events.empty()) {
+      events += ",";
+    }
+    events += "{\"name\":\"" + name +
+              "\",\"cat\":\"flutter\",\"ph\":\"X\",\"ts\":" +
+              std::to_string(timestamp++) + ",\"dur\":1,\"args\":{" + args +
+              "}}";
+  };
+  for (const auto& frame : frames) {
+    for (const auto& size : frame) {
+      add_event("VulkanSurfacePool::AcquireSurface",
+                "\"width\":" + std::to_string(size.width()) +
+                    ",\"height\":" + std::to_string(size.height()));
+    }
+    add_event("VulkanSurfacePool::AgeAndCollectOldBuffers", "");
+  }
+  return "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" + events + "]}";
+}
+
+std::vector<ReplayFrame> ParseOrDie(const std::string& json) {
+  std::vector<ReplayFrame> frames;
+  EXPECT_TRUE(ParseReplayTrace(json, &frames));
+  return frames;
+}
+
+// Full-screen and card layers of a list that scrolls, then a dialog that
+// grows in over a few frames.
+std::vector<ReplayFrame> ScrollThenDialogFrames() {
+  const SkISize screen = SkISize::Make(1080, 1920);
+  const SkISize card = SkISize::Make(1080, 400);
+  std::vector<std::vector<SkISize>> frames(4, {screen, card, card});
+  for (int width : {600, 700, 800, 800, 800, 800, 800}) {
+    frames.push_back({screen, SkISize::Make(width, width / 2)});
+  }
+  return ParseOrDie(TraceJson(frames));
+}
+
+}  // namespace
+
+TEST(SurfacePoolReplayTest, ParsesTrace) {
+  // Events arrive out of order and with other events in between, and the
+  // acquisitions after the last end of frame make a frame of their own.
+  auto frames = ParseOrDie(
+      "{\"traceEvents\":["
+      "{\"name\":\"VulkanSurfacePool::AcquireSurface\",\"ph\":\"B\","
+      "\"ts\":2,\"args\":{\"width\":30,\"height\":40}},"
+      "{\"name\":\"VulkanSurfacePool::AcquireSurface\",\"ph\":\"E\","
+      "\"ts\":3},"
+      "{\"name\":\"VulkanSurfacePool::AcquireSurface\",\"ph\":\"X\","
+      "\"ts\":1,\"dur\":0.5,\"args\":{\"width\":100,\"height\":200}},"
+      "{\"name\":\"VulkanSurfacePool::AgeAndCollectOldBuffers\","
+      "\"ph\":\"X\",\"ts\":4.5},"
+      "{\"name\":\"VulkanSurfacePool::SubmitSurface\",\"ph\":\"X\","
+      "\"ts\":5},"
+      "{\"name\":\"VulkanSurfacePool::AgeAndCollectOldBuffers\","
+      "\"ph\":\"X\",\"ts\":6},"
+      "{\"name\":\"VulkanSurfacePool::AcquireSurface\",\"ph\":\"X\","
+      "\"ts\":7,\"args\":{\"width\":5,\"height\":6}}"
+      "]}");
+  ASSERT_EQ(frames.size(), 3u);
+  ASSERT_EQ(frames[0].acquired_sizes.size(), 2u);
+  EXPECT_EQ(frames[0].acquired_sizes[0], SkISize::Make(100, 200));
+  EXPECT_EQ(frames[0].acquired_sizes[1], SkISize::Make(30, 40));
+  EXPECT_TRUE(frames[1].acquired_sizes.empty());
+  ASSERT_EQ(frames[2].acquired_sizes.size(), 1u);
+  EXPECT_EQ(frames[2].acquired_sizes[0], SkISize::Make(5, 6));
+}
+
+TEST(SurfacePoolReplayTest, RejectsMalformedTrace) {
+  std::vector<ReplayFrame> frames;
+  EXPECT_FALSE(ParseReplayTrace("100x200\n", &frames));
+  EXPECT_FALSE(ParseReplayTrace("{\"traceEvents\":", &frames));
+  EXPECT_FALSE(ParseReplayTrace("{\"events\":[]}", &frames));
+  EXPECT_FALSE(ParseReplayTrace(
+      "{\"traceEvents\":[{\"name\":\"VulkanSurfacePool::AcquireSurface\","
+      "\"ts\":1,\"args\":{\"width\":100}}]}",
+      &frames));
+  EXPECT_FALSE(ParseReplayTrace(
+      "{\"traceEvents\":[{\"name\":\"VulkanSurfacePool::AcquireSurface\","
+      "\"ts\":1,\"args\":{\"width\":0,\"height\":200}}]}",
+      &frames));
+}
+
+TEST(SurfacePoolReplayTest, LoadsTraceFromFile) {
+  const std::string path = "/tmp/surface_pool_replay_unittest.json";
+  const std::string json =
+      TraceJson({{SkISize::Make(10, 20)}, {SkISize::Make(30, 40)}});
+  ASSERT_TRUE(dart_utils::WriteFile(path, json.data(), json.size()));
+
+  std::vector<ReplayFrame> frames;
+  ASSERT_TRUE(LoadReplayTrace(path, &frames));
+  ASSERT_EQ(frames.size(), 2u);
+  EXPECT_EQ(frames[1].acquired_sizes[0], SkISize::Make(30, 40));
+
+  EXPECT_FALSE(LoadReplayTrace(path + ".missing", &frames));
+  std::remove(path.c_str());
+}
+
+TEST(SurfacePoolReplayTest, SteadyFramesReuseEverySurface) {
+  std::vector<std::vector<SkISize>> frames(
+      100, {SkISize::Make(1080, 1920), SkISize::Make(500, 500)});
+  auto report = ReplaySurfacePoolTrace(ParseOrDie(TraceJson(frames)));
+
+  EXPECT_EQ(report.frames, 100u);
+  EXPECT_EQ(report.acquired, 200u);
+  // One set of surfaces in the compositor and one being painted.
+  EXPECT_EQ(report.created, 4u);
+  EXPECT_EQ(report.exact_hits, 196u);
+  EXPECT_EQ(report.destroyed, 0u);
+  EXPECT_GT(report.ReuseRatio(), 0.95);
+}
+
+TEST(SurfacePoolReplayTest, IdleFramesAgeSurfacesOut) {
+  const SkISize size = SkISize::Make(100, 100);
+  auto report = ReplaySurfacePoolTrace(
+      ParseOrDie(TraceJson({{size}, {}, {}, {}, {}, {}, {size}})));
+  EXPECT_EQ(report.destroyed, 1u);
+  EXPECT_EQ(report.created, 2u);
+}
+
+TEST(SurfacePoolReplayTest, ComparesBudgets) {
+  auto frames = ScrollThenDialogFrames();
+
+  auto default_report = ReplaySurfacePoolTrace(frames);
+  auto tight_budget_report = ReplaySurfacePoolTrace(frames, 8 * (1 << 20));
+
+  // The growing dialog reuses larger surfaces instead of allocating.
+  EXPECT_GT(default_report.reused, 0u);
+
+  // A budget smaller than a frame's surfaces trades memory for churn.
+  EXPECT_GT(tight_budget_report.AllocationsPerFrame(),
+            default_report.AllocationsPerFrame());
+  EXPECT_GT(tight_budget_report.ChurnBytesPerFrame(),
+            default_report.ChurnBytesPerFrame());
+  EXPECT_LE(tight_budget_report.peak_bytes, default_report.peak_bytes);
+
+  EXPECT_FALSE(default_report.ToString().empty());
+}
+
+// Replays the trace named by SURFACE_POOL_REPLAY_TRACE, which is a JSON trace
+// of a single view captured with the "flutter" category.  Run with
+// --gtest_also_run_disabled_tests.
+TEST(SurfacePoolReplayTest, DISABLED_ReplaysCapturedTrace) {
+  const char* path = std::getenv("SURFACE_POOL_REPLAY_TRACE");
+  ASSERT_NE(path, nullptr) << "SURFACE_POOL_REPLAY_TRACE is not set";
+  std::vector<ReplayFrame> frames;
+  ASSERT_TRUE(LoadReplayTrace(path, &frames));
+  auto report = ReplaySurfacePoolTrace(frames);
+  EXPECT_EQ(report.frames, frames.size());
+  std::cout << report.ToString() << std::endl;
+}
+
+}  // namespace flutter_runner_test
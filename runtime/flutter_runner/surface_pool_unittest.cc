@@ -0,0 +1,199 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/surface_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "topaz/runtime/flutter_runner/surface_pool_replay.h"
+
+namespace flutter_runner_test {
+
+using flutter::LayerRasterCacheKey;
+using flutter_runner::ReplaySurface;
+using flutter_runner::ReplaySurfacePool;
+using flutter_runner::ReplaySurfacePoolBackend;
+
+namespace {
+
+constexpr uint64_t kLayerId = 7;
+
+LayerRasterCacheKey TranslatedKey(SkScalar x, SkScalar y) {
+  return LayerRasterCacheKey(kLayerId, SkMatrix::MakeTrans(x, y));
+}
+
+class SurfacePoolTest : public ::testing::Test {
+ protected:
+  SurfacePoolTest() : stats_(pool_.stats()) {}
+
+  // Acquires a surface for the layer at |key| and submits it, returning the
+  // surface so that the test can release it.
+  ReplaySurface* SubmitRetained(const LayerRasterCacheKey& key) {
+    auto surface = pool_.AcquireSurface(SkISize::Make(100, 100));
+    surface->SetRetainedKey(key);
+    ReplaySurface* submitted = surface.get();
+    pool_.SubmitSurface(std::move(surface));
+    return submitted;
+  }
+
+  // Acquires and submits a surface of each of |sizes| and ends the frame,
+  // returning the surfaces so that the test can release them.
+  std::vector<ReplaySurface*> SubmitFrame(const std::vector<SkISize>& sizes) {
+    std::vector<ReplaySurface*> submitted;
+    for (const auto& size : sizes) {
+      auto surface = pool_.AcquireSurface(size);
+      submitted.push_back(surface.get());
+      pool_.SubmitSurface(std::move(surface));
+    }
+    pool_.AgeAndCollectOldBuffers();
+    return submitted;
+  }
+
+  static void Release(const std::vector<ReplaySurface*>& surfaces) {
+    for (auto* surface : surfaces) {
+      surface->Release();
+    }
+  }
+
+  ReplaySurfacePool pool_;
+  const ReplaySurfacePoolBackend::Stats& stats_;
+};
+
+}  // namespace
+
+TEST(SurfacePoolKeyTest, NormalizeRetainedKeyDropsWholePixels) {
+  auto normalize = [](const LayerRasterCacheKey& key) {
+    return ReplaySurfacePool::NormalizeRetainedKey(key);
+  };
+  LayerRasterCacheKey::Equal equal;
+
+  EXPECT_TRUE(equal(normalize(TranslatedKey(12, -30)), TranslatedKey(0, 0)));
+  EXPECT_TRUE(
+      equal(normalize(TranslatedKey(12.25f, 3)), TranslatedKey(0.25f, 0)));
+  // Negative translations keep the fraction up to the next pixel.
+  EXPECT_TRUE(
+      equal(normalize(TranslatedKey(-0.25f, 0)), TranslatedKey(0.75f, 0)));
+  // Rounding error either side of a whole pixel counts as whole.
+  EXPECT_TRUE(equal(normalize(TranslatedKey(5.0001f, 4.9999f)),
+                    TranslatedKey(0, 0)));
+  EXPECT_EQ(normalize(TranslatedKey(3, 4)).id(), kLayerId);
+
+  // Scale is kept, and perspective keeps the key as is.
+  SkMatrix scaled = SkMatrix::MakeScale(2, 2);
+  scaled.setTranslateX(8);
+  EXPECT_TRUE(equal(normalize(LayerRasterCacheKey(kLayerId, scaled)),
+                    LayerRasterCacheKey(kLayerId, SkMatrix::MakeScale(2, 2))));
+  SkMatrix perspective = SkMatrix::MakeTrans(8, 8);
+  perspective.setPerspX(0.5f);
+  EXPECT_TRUE(equal(normalize(LayerRasterCacheKey(kLayerId, perspective)),
+                    LayerRasterCacheKey(kLayerId, perspective)));
+}
+
+TEST_F(SurfacePoolTest, TranslatedLayerFindsRetainedNode) {
+  ReplaySurface* surface = SubmitRetained(TranslatedKey(0, 0));
+  ASSERT_TRUE(pool_.HasRetainedNode(TranslatedKey(0, 200)));
+  EXPECT_EQ(&pool_.GetRetainedNode(TranslatedKey(0, 200)), surface);
+  EXPECT_FALSE(pool_.HasRetainedNode(TranslatedKey(0, 200.5f)));
+}
+
+TEST_F(SurfacePoolTest, KeyCollisionKeepsPendingRetainedSurface) {
+  ReplaySurface* first = SubmitRetained(TranslatedKey(0, 0));
+  // The layer moved by a pixel and was painted again before the first
+  // surface was done.
+  ReplaySurface* second = SubmitRetained(TranslatedKey(0, 1));
+
+  EXPECT_EQ(stats_.destroyed, 0u);
+  EXPECT_EQ(pool_.retained_count(), 1u);
+  EXPECT_EQ(pool_.pending_count(), 1u);
+  EXPECT_EQ(&pool_.GetRetainedNode(TranslatedKey(0, 0)), first);
+
+  // The second surface is recycled once it is done, and the first one stays.
+  second->Release();
+  first->Release();
+  EXPECT_EQ(pool_.pending_count(), 0u);
+  EXPECT_EQ(pool_.available_count(), 1u);
+  EXPECT_EQ(pool_.retained_count(), 1u);
+  EXPECT_EQ(stats_.destroyed, 0u);
+}
+
+TEST_F(SurfacePoolTest, KeyCollisionReplacesReadyRetainedSurface) {
+  ReplaySurface* first = SubmitRetained(TranslatedKey(0, 0));
+  first->Release();
+  ReplaySurface* second = SubmitRetained(TranslatedKey(0, 1));
+
+  // The first surface is no longer needed, so it becomes available.
+  EXPECT_EQ(stats_.destroyed, 0u);
+  EXPECT_EQ(pool_.retained_count(), 1u);
+  EXPECT_EQ(pool_.pending_count(), 0u);
+  EXPECT_EQ(pool_.available_count(), 1u);
+  EXPECT_EQ(&pool_.GetRetainedNode(TranslatedKey(0, 0)), second);
+}
+
+TEST_F(SurfacePoolTest, PreallocatesPredictedSizes) {
+  Release(SubmitFrame({SkISize::Make(200, 100), SkISize::Make(50, 50)}));
+  ASSERT_EQ(stats_.created, 2u);
+
+  // The view is about to double in size.
+  pool_.PreallocateSurfaces(2.f, 2.f);
+  EXPECT_EQ(stats_.created, 4u);
+  EXPECT_EQ(pool_.available_count(), 4u);
+
+  // The next frame finds surfaces of the new sizes without creating any.
+  SubmitFrame({SkISize::Make(400, 200), SkISize::Make(100, 100)});
+  EXPECT_EQ(stats_.created, 4u);
+  EXPECT_EQ(stats_.bound, 0u);
+}
+
+TEST_F(SurfacePoolTest, PreallocatesWithinBudget) {
+  Release(SubmitFrame({SkISize::Make(200, 100), SkISize::Make(50, 50)}));
+  // Drop the surfaces of the first frame so that only the predictions count.
+  pool_.SetMaxBytes(0);
+  ASSERT_EQ(pool_.available_count(), 0u);
+
+  // Room for the larger prediction, but not for both.
+  const size_t larger_bytes =
+      ReplaySurface::MemoryRequirementsSize(SkISize::Make(400, 200));
+  pool_.SetMaxBytes(larger_bytes + 1000);
+  pool_.PreallocateSurfaces(2.f, 2.f);
+  EXPECT_EQ(pool_.available_count(), 1u);
+  EXPECT_EQ(stats_.created, 3u);
+}
+
+TEST_F(SurfacePoolTest, ReserveServesMisses) {
+  // A miss on an empty pool is remembered for the reserve.
+  SubmitFrame({SkISize::Make(100, 100)});
+  ASSERT_TRUE(pool_.NeedsReserveRefill());
+
+  // The reserve covers the miss's size class once, rounded up.
+  EXPECT_TRUE(pool_.RefillReserve());
+  EXPECT_EQ(pool_.reserve_count(), 1u);
+  EXPECT_FALSE(pool_.RefillReserve());
+  EXPECT_EQ(stats_.created, 2u);
+
+  // A slightly larger miss is served from the reserve without creating a
+  // surface, and the reserve doesn't age out.
+  SubmitFrame({});
+  SubmitFrame({});
+  SubmitFrame({});
+  SubmitFrame({SkISize::Make(120, 120)});
+  EXPECT_EQ(pool_.reserve_count(), 0u);
+  EXPECT_EQ(stats_.created, 2u);
+  EXPECT_EQ(stats_.bound, 1u);
+}
+
+TEST_F(SurfacePoolTest, ReserveRespectsBudget) {
+  SubmitFrame({SkISize::Make(100, 100)});
+  pool_.SetMaxBytes(0);
+  EXPECT_FALSE(pool_.RefillReserve());
+  EXPECT_EQ(pool_.reserve_count(), 0u);
+
+  pool_.SetMaxBytes(ReplaySurfacePool::kDefaultMaxBytes);
+  EXPECT_TRUE(pool_.RefillReserve());
+  EXPECT_EQ(pool_.reserve_count(), 1u);
+}
+
+}  // namespace flutter_runner_test
@@ -0,0 +1,272 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_SURFACE_SIZE_INDEX_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_SURFACE_SIZE_INDEX_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "flutter/fml/logging.h"
+#include "flutter/fml/macros.h"
+#include "third_party/skia/include/core/SkSize.h"
+
+namespace flutter_runner {
+
+struct SkISizeHash {
+  size_t operator()(const SkISize& size) const {
+    return std::hash<uint64_t>()(
+        (static_cast<uint64_t>(static_cast<uint32_t>(size.width())) << 32) |
+        static_cast<uint32_t>(size.height()));
+  }
+};
+
+// Owns the surfaces that are available for reuse and indexes them by size
+// class, so that the raster thread does not have to scan every cached surface
+// on each acquisition.
+//
+// Surfaces are bucketed by exact |SkISize| in a hash map, and a flat array
+// sorted by allocation size is kept alongside for best fit lookups.  Neither
+// structure allocates once it has seen the sizes a frame uses, which matters
+// because every surface goes through the index once per frame.
+//
+// The index also picks eviction victims using GreedyDual-Size-Frequency: a
+// surface's priority is the index's inflation value at the time it was
+// inserted plus its use count per MiB of allocation.  Evicting a surface
+// raises the inflation value to the victim's priority, so surfaces that sit
+// unused eventually lose to recently recycled ones no matter how often they
+// were used before, while small, frequently reused surfaces outlive large,
+// rarely reused ones.
+//
+// |Surface| must provide |IsValid()|, |GetSize()|, |GetAllocationSize()| and
+// |GetUseCount()|.  The size and allocation size of a surface must not change
+// while it is held by the index.
+template <typename Surface>
+class SurfaceSizeIndex final {
+ public:
+  SurfaceSizeIndex() = default;
+
+  ~SurfaceSizeIndex() = default;
+
+  size_t size() const { return best_fit_.size(); }
+
+  bool empty() const { return best_fit_.empty(); }
+
+  // The sum of |GetAllocationSize()| over all surfaces in the index.
+  size_t allocation_bytes() const { return allocation_bytes_; }
+
+  void Insert(std::unique_ptr<Surface> surface) {
+    FML_DCHECK(surface != nullptr);
+    const size_t allocation_size = surface->GetAllocationSize();
+    const double uses_per_mib =
+        static_cast<double>(surface->GetUseCount()) * (1 << 20) /
+        std::max<size_t>(allocation_size, 1);
+    const FitEntry entry = {allocation_size, surface->GetSize(),
+                            inflation_ + uses_per_mib, surface.get()};
+
+    auto& bucket = exact_[entry.size];
+    if (bucket.empty() && bucket.capacity() > 0) {
+      // Reusing a bucket that was emptied by |Remove|.
+      empty_buckets_--;
+    }
+    bucket.push_back(std::move(surface));
+
+    // Surfaces with equal allocation sizes stay in insertion order.
+    best_fit_.insert(std::upper_bound(best_fit_.begin(), best_fit_.end(),
+                                      entry.allocation_size, AllocationLess()),
+                     entry);
+    allocation_bytes_ += entry.allocation_size;
+  }
+
+  // Removes and returns a valid surface whose size is exactly |size|, or
+  // nullptr if there is none.
+  std::unique_ptr<Surface> TakeExactMatch(const SkISize& size) {
+    auto bucket = exact_.find(size);
+    if (bucket == exact_.end()) {
+      return nullptr;
+    }
+    auto& surfaces = bucket->second;
+    for (auto it = surfaces.begin(); it != surfaces.end(); ++it) {
+      if ((*it)->IsValid()) {
+        auto removed = std::move(*it);
+        surfaces.erase(it);
+        OnBucketShrunk(surfaces);
+        RemoveFitEntry(FindFitEntry(removed.get(), removed->GetAllocationSize()));
+        return removed;
+      }
+    }
+    return nullptr;
+  }
+
+  // Removes and returns the valid surface with the smallest allocation that
+  // holds at least |min_allocation_size| bytes, or nullptr if there is none.
+  std::unique_ptr<Surface> TakeBestFit(size_t min_allocation_size) {
+    for (auto it = std::lower_bound(best_fit_.begin(), best_fit_.end(),
+                                    min_allocation_size, AllocationLess());
+         it != best_fit_.end(); ++it) {
+      if (it->surface->IsValid()) {
+        return Remove(it);
+      }
+    }
+    return nullptr;
+  }
+
+  // Removes and returns the first surface for which |predicate| returns true,
+  // or nullptr if there is none.  Surfaces are visited in order of increasing
+  // allocation size.
+  template <typename Predicate>
+  std::unique_ptr<Surface> TakeFirstIf(Predicate predicate) {
+    for (auto it = best_fit_.begin(); it != best_fit_.end(); ++it) {
+      if (predicate(*it->surface)) {
+        return Remove(it);
+      }
+    }
+    return nullptr;
+  }
+
+  // Removes and returns every surface for which |predicate| returns true.
+  // |predicate| is called exactly once for every surface in the index.
+  template <typename Predicate>
+  std::vector<std::unique_ptr<Surface>> TakeIf(Predicate predicate) {
+    std::vector<Surface*> matches;
+    for (const auto& entry : best_fit_) {
+      if (predicate(*entry.surface)) {
+        matches.push_back(entry.surface);
+      }
+    }
+    std::vector<std::unique_ptr<Surface>> taken;
+    taken.reserve(matches.size());
+    for (Surface* surface : matches) {
+      taken.push_back(Remove(FindFitEntry(surface)));
+    }
+    return taken;
+  }
+
+  // Removes and returns the surface that is least worth keeping, or nullptr
+  // if the index is empty.  Invalid surfaces are always evicted first.
+  std::unique_ptr<Surface> TakeEvictionCandidate() {
+    if (best_fit_.empty()) {
+      return nullptr;
+    }
+    auto victim = best_fit_.begin();
+    for (auto it = best_fit_.begin(); it != best_fit_.end(); ++it) {
+      if (!it->surface->IsValid()) {
+        return Remove(it);
+      }
+      if (it->priority < victim->priority) {
+        victim = it;
+      }
+    }
+    inflation_ = victim->priority;
+    return Remove(victim);
+  }
+
+  template <typename Function>
+  void ForEach(Function function) const {
+    for (const auto& entry : best_fit_) {
+      function(static_cast<const Surface&>(*entry.surface));
+    }
+  }
+
+ private:
+  // Empty exact-size buckets are kept around so that surfaces cycling through
+  // the index every frame don't reallocate their buckets, but only up to this
+  // many.  Every surface of a frame is out of the index at the same time, so
+  // this needs to comfortably exceed the number of layers in a frame.
+  static constexpr size_t kMaxEmptyBuckets = 256;
+
+  struct FitEntry {
+    size_t allocation_size;
+    // The size the surface was indexed under.  This is kept separately since
+    // an invalid surface reports an empty size.
+    SkISize size;
+    double priority;
+    Surface* surface;
+  };
+
+  struct AllocationLess {
+    bool operator()(const FitEntry& entry, size_t allocation_size) const {
+      return entry.allocation_size < allocation_size;
+    }
+    bool operator()(size_t allocation_size, const FitEntry& entry) const {
+      return allocation_size < entry.allocation_size;
+    }
+  };
+
+  using FitIterator = typename std::vector<FitEntry>::iterator;
+
+  // Owns the surfaces, oldest first within each bucket.
+  std::unordered_map<SkISize, std::vector<std::unique_ptr<Surface>>,
+                     SkISizeHash>
+      exact_;
+  // One entry per owned surface, sorted by allocation size.
+  std::vector<FitEntry> best_fit_;
+  size_t empty_buckets_ = 0;
+  size_t allocation_bytes_ = 0;
+  double inflation_ = 0.0;
+
+  FitIterator FindFitEntry(const Surface* surface, size_t allocation_size) {
+    auto it = std::lower_bound(best_fit_.begin(), best_fit_.end(),
+                               allocation_size, AllocationLess());
+    while (it != best_fit_.end() && it->surface != surface) {
+      ++it;
+    }
+    FML_DCHECK(it != best_fit_.end());
+    return it;
+  }
+
+  FitIterator FindFitEntry(const Surface* surface) {
+    auto it = std::find_if(
+        best_fit_.begin(), best_fit_.end(),
+        [surface](const FitEntry& entry) { return entry.surface == surface; });
+    FML_DCHECK(it != best_fit_.end());
+    return it;
+  }
+
+  void RemoveFitEntry(FitIterator fit_it) {
+    allocation_bytes_ -= fit_it->allocation_size;
+    best_fit_.erase(fit_it);
+  }
+
+  void OnBucketShrunk(const std::vector<std::unique_ptr<Surface>>& bucket) {
+    if (bucket.empty() && ++empty_buckets_ > kMaxEmptyBuckets) {
+      PruneEmptyBuckets();
+    }
+  }
+
+  std::unique_ptr<Surface> Remove(FitIterator fit_it) {
+    const FitEntry entry = *fit_it;
+    RemoveFitEntry(fit_it);
+
+    auto bucket_it = exact_.find(entry.size);
+    FML_DCHECK(bucket_it != exact_.end());
+    auto& bucket = bucket_it->second;
+    auto surface_it =
+        std::find_if(bucket.begin(), bucket.end(), [&entry](const auto& s) {
+          return s.get() == entry.surface;
+        });
+    FML_DCHECK(surface_it != bucket.end());
+    auto removed = std::move(*surface_it);
+    bucket.erase(surface_it);
+    OnBucketShrunk(bucket);
+    return removed;
+  }
+
+  void PruneEmptyBuckets() {
+    for (auto it = exact_.begin(); it != exact_.end();) {
+      it = it->second.empty() ? exact_.erase(it) : std::next(it);
+    }
+    empty_buckets_ = 0;
+  }
+
+  FML_DISALLOW_COPY_AND_ASSIGN(SurfaceSizeIndex);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_SURFACE_SIZE_INDEX_H_
@@ -0,0 +1,171 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/surface_size_index.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+namespace flutter_runner_test {
+namespace {
+
+// Stands in for |VulkanSurface|.  Memory requirements are modelled as 4 bytes
+// per pixel rounded up to a 64KiB page, which is close to what the drivers
+// we ship on report for optimally tiled BGRA images.
+class FakeSurface {
+ public:
+  static size_t MemoryRequirementsSize(const SkISize& size) {
+    constexpr size_t kPageSize = 64 * 1024;
+    size_t bytes = 4u * size.width() * size.height();
+    return (bytes + kPageSize - 1) / kPageSize * kPageSize;
+  }
+
+  explicit FakeSurface(const SkISize& size)
+      : size_(size), allocation_size_(MemoryRequirementsSize(size)) {}
+
+  bool IsValid() const { return valid_; }
+  SkISize GetSize() const { return valid_ ? size_ : SkISize::Make(0, 0); }
+  size_t GetAllocationSize() const { return allocation_size_; }
+  size_t GetUseCount() const { return use_count_; }
+
+  // Mirrors |VulkanSurface::FlushSessionAcquireAndReleaseEvents|.
+  void Use() { use_count_++; }
+  void Invalidate() { valid_ = false; }
+
+ private:
+  SkISize size_;
+  size_t allocation_size_;
+  size_t use_count_ = 0;
+  bool valid_ = true;
+};
+
+using FakeSurfaceIndex = flutter_runner::SurfaceSizeIndex<FakeSurface>;
+
+TEST(SurfaceSizeIndexTest, TakesExactMatchBeforeLargerSurface) {
+  FakeSurfaceIndex index;
+  index.Insert(std::make_unique<FakeSurface>(SkISize::Make(512, 512)));
+  index.Insert(std::make_unique<FakeSurface>(SkISize::Make(100, 100)));
+  EXPECT_EQ(index.size(), 2u);
+
+  auto surface = index.TakeExactMatch(SkISize::Make(100, 100));
+  ASSERT_NE(surface, nullptr);
+  EXPECT_EQ(surface->GetSize(), SkISize::Make(100, 100));
+  EXPECT_EQ(index.size(), 1u);
+  EXPECT_EQ(index.TakeExactMatch(SkISize::Make(100, 100)), nullptr);
+}
+
+TEST(SurfaceSizeIndexTest, TakesSmallestSufficientAllocation) {
+  FakeSurfaceIndex index;
+  index.Insert(std::make_unique<FakeSurface>(SkISize::Make(1024, 1024)));
+  index.Insert(std::make_unique<FakeSurface>(SkISize::Make(300, 300)));
+  index.Insert(std::make_unique<FakeSurface>(SkISize::Make(64, 64)));
+
+  const size_t required =
+      FakeSurface::MemoryRequirementsSize(SkISize::Make(200, 250));
+  auto surface = index.TakeBestFit(required);
+  ASSERT_NE(surface, nullptr);
+  EXPECT_EQ(surface->GetSize(), SkISize::Make(300, 300));
+
+  EXPECT_EQ(index.TakeBestFit(FakeSurface::MemoryRequirementsSize(
+                SkISize::Make(2048, 2048))),
+            nullptr);
+  EXPECT_EQ(index.size(), 2u);
+}
+
+TEST(SurfaceSizeIndexTest, SkipsInvalidSurfaces) {
+  FakeSurfaceIndex index;
+  auto invalid = std::make_unique<FakeSurface>(SkISize::Make(100, 100));
+  FakeSurface* invalid_ptr = invalid.get();
+  index.Insert(std::move(invalid));
+  index.Insert(std::make_unique<FakeSurface>(SkISize::Make(100, 100)));
+  invalid_ptr->Invalidate();
+
+  auto surface = index.TakeExactMatch(SkISize::Make(100, 100));
+  ASSERT_NE(surface, nullptr);
+  EXPECT_TRUE(surface->IsValid());
+  EXPECT_EQ(index.TakeExactMatch(SkISize::Make(100, 100)), nullptr);
+  EXPECT_EQ(index.TakeBestFit(0), nullptr);
+
+  // The invalid surface can still be collected even though it now reports an
+  // empty size.
+  auto collected =
+      index.TakeIf([](const FakeSurface& surface) { return !surface.IsValid(); });
+  EXPECT_EQ(collected.size(), 1u);
+  EXPECT_TRUE(index.empty());
+  EXPECT_EQ(index.allocation_bytes(), 0u);
+}
+
+TEST(SurfaceSizeIndexTest, TracksAllocationBytes) {
+  FakeSurfaceIndex index;
+  const SkISize a = SkISize::Make(10, 10);
+  const SkISize b = SkISize::Make(800, 600);
+  index.Insert(std::make_unique<FakeSurface>(a));
+  index.Insert(std::make_unique<FakeSurface>(b));
+  EXPECT_EQ(index.allocation_bytes(), FakeSurface::MemoryRequirementsSize(a) +
+                                          FakeSurface::MemoryRequirementsSize(b));
+
+  auto taken = index.TakeFirstIf([&b](const FakeSurface& surface) {
+    return surface.GetSize() == b;
+  });
+  ASSERT_NE(taken, nullptr);
+  EXPECT_EQ(index.allocation_bytes(), FakeSurface::MemoryRequirementsSize(a));
+}
+
+TEST(SurfaceSizeIndexTest, EvictsLargeRarelyUsedSurfacesFirst) {
+  FakeSurfaceIndex index;
+  auto small = std::make_unique<FakeSurface>(SkISize::Make(64, 64));
+  auto large = std::make_unique<FakeSurface>(SkISize::Make(1024, 1024));
+  for (int i = 0; i < 4; i++) {
+    small->Use();
+    large->Use();
+  }
+  index.Insert(std::move(large));
+  index.Insert(std::move(small));
+
+  auto victim = index.TakeEvictionCandidate();
+  ASSERT_NE(victim, nullptr);
+  EXPECT_EQ(victim->GetSize(), SkISize::Make(1024, 1024));
+}
+
+TEST(SurfaceSizeIndexTest, EvictionAgesOutIdleSurfaces) {
+  FakeSurfaceIndex index;
+  const SkISize busy_size = SkISize::Make(64, 64);
+  auto busy = std::make_unique<FakeSurface>(busy_size);
+  for (int i = 0; i < 3; i++) {
+    busy->Use();
+  }
+  index.Insert(std::move(busy));
+
+  // Keep evicting freshly recycled, never reused surfaces.  Each eviction
+  // raises the inflation value, so the busy surface, which has not been
+  // recycled since, is eventually evicted ahead of new ones.
+  bool busy_evicted = false;
+  for (int i = 0; i < 64 && !busy_evicted; i++) {
+    auto fresh = std::make_unique<FakeSurface>(busy_size);
+    fresh->Use();
+    index.Insert(std::move(fresh));
+    auto victim = index.TakeEvictionCandidate();
+    ASSERT_NE(victim, nullptr);
+    busy_evicted = victim->GetUseCount() == 3;
+  }
+  EXPECT_TRUE(busy_evicted);
+}
+
+TEST(SurfaceSizeIndexTest, EvictsInvalidSurfacesFirst) {
+  FakeSurfaceIndex index;
+  auto invalid = std::make_unique<FakeSurface>(SkISize::Make(64, 64));
+  FakeSurface* invalid_ptr = invalid.get();
+  invalid->Use();
+  index.Insert(std::move(invalid));
+  index.Insert(std::make_unique<FakeSurface>(SkISize::Make(1024, 1024)));
+  invalid_ptr->Invalidate();
+
+  auto victim = index.TakeEvictionCandidate();
+  ASSERT_NE(victim, nullptr);
+  EXPECT_FALSE(victim->IsValid());
+}
+
+}  // namespace
+}  // namespace flutter_runner_test
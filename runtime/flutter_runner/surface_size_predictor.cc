@@ -0,0 +1,102 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/surface_size_predictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace flutter_runner {
+
+namespace {
+
+bool Contains(const std::vector<SkISize>& sizes, const SkISize& size) {
+  return std::find(sizes.begin(), sizes.end(), size) != sizes.end();
+}
+
+}  // namespace
+
+SurfaceSizePredictor::SurfaceSizePredictor()
+    : size_history_(kSizeHistoryFrames + 1) {}
+
+SurfaceSizePredictor::~SurfaceSizePredictor() = default;
+
+void SurfaceSizePredictor::OnSurfaceAcquired(const SkISize& size) {
+  auto& current_frame = size_history_.front();
+  if (!Contains(current_frame, size)) {
+    current_frame.push_back(size);
+  }
+
+  auto prediction =
+      std::find_if(predictions_.begin(), predictions_.end(),
+                   [&size](const Prediction& p) { return p.size == size; });
+  if (prediction != predictions_.end()) {
+    predictions_.erase(prediction);
+    hits_++;
+  }
+}
+
+void SurfaceSizePredictor::OnFrameEnd() {
+  // Keep the finished frame only if it used any surfaces, so that idle frames
+  // don't push the last real frame out of the history.
+  if (!size_history_.front().empty()) {
+    std::rotate(size_history_.rbegin(), size_history_.rbegin() + 1,
+                size_history_.rend());
+    size_history_.front().clear();
+  }
+
+  for (auto& prediction : predictions_) {
+    prediction.age++;
+  }
+  const auto expired = std::remove_if(
+      predictions_.begin(), predictions_.end(), [](const Prediction& p) {
+        return p.age >= kPredictionLifetime;
+      });
+  misses_ += predictions_.end() - expired;
+  predictions_.erase(expired, predictions_.end());
+}
+
+std::vector<SkISize> SurfaceSizePredictor::PredictSizes(
+    float width_change_factor,
+    float height_change_factor) {
+  std::vector<SkISize> sizes;
+  if (width_change_factor <= 0.f || height_change_factor <= 0.f ||
+      (width_change_factor == 1.f && height_change_factor == 1.f)) {
+    return sizes;
+  }
+
+  // Skip the frame in progress, which may be incomplete.
+  for (size_t i = 1; i < size_history_.size(); i++) {
+    for (const auto& size : size_history_[i]) {
+      const SkISize predicted = SkISize::Make(
+          static_cast<int32_t>(std::ceil(size.width() * width_change_factor)),
+          static_cast<int32_t>(
+              std::ceil(size.height() * height_change_factor)));
+      if (predicted.isEmpty() || Contains(sizes, predicted)) {
+        continue;
+      }
+      const bool outstanding =
+          std::any_of(predictions_.begin(), predictions_.end(),
+                      [&predicted](const Prediction& p) {
+                        return p.size == predicted;
+                      });
+      if (!outstanding) {
+        sizes.push_back(predicted);
+      }
+    }
+  }
+
+  std::sort(sizes.begin(), sizes.end(), [](const SkISize& a, const SkISize& b) {
+    return a.area() > b.area();
+  });
+  if (sizes.size() > kMaxPredictions) {
+    sizes.resize(kMaxPredictions);
+  }
+  for (const auto& size : sizes) {
+    predictions_.push_back({size, 0});
+  }
+  return sizes;
+}
+
+}  // namespace flutter_runner
@@ -0,0 +1,72 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_SURFACE_SIZE_PREDICTOR_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_SURFACE_SIZE_PREDICTOR_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "flutter/fml/macros.h"
+#include "third_party/skia/include/core/SkSize.h"
+
+namespace flutter_runner {
+
+// Predicts the surface sizes upcoming frames will need when Scenic hints that
+// the view is about to change size, so that surfaces of those sizes can be
+// created before the frames that need them.
+//
+// Predictions scale the sizes used by the most recent frames by the hinted
+// change factors.  A prediction counts as a hit if a surface of that size is
+// acquired within |kPredictionLifetime| frames, and as a miss otherwise.
+class SurfaceSizePredictor final {
+ public:
+  // Predictions are based on the sizes acquired in this many recent frames.
+  static constexpr size_t kSizeHistoryFrames = 2;
+  // Frames a prediction stays outstanding before it counts as a miss.
+  static constexpr size_t kPredictionLifetime = 3;
+  // Bound on the number of sizes predicted for a single hint.
+  static constexpr size_t kMaxPredictions = 16;
+
+  SurfaceSizePredictor();
+
+  ~SurfaceSizePredictor();
+
+  void OnSurfaceAcquired(const SkISize& size);
+
+  void OnFrameEnd();
+
+  // Returns the sizes expected after the view is scaled by the given factors,
+  // largest first.  Sizes that are already outstanding predictions are not
+  // returned again.
+  std::vector<SkISize> PredictSizes(float width_change_factor,
+                                    float height_change_factor);
+
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+  void ResetCounters() {
+    hits_ = 0;
+    misses_ = 0;
+  }
+
+ private:
+  struct Prediction {
+    SkISize size;
+    size_t age;
+  };
+
+  // Distinct sizes acquired in each of the last |kSizeHistoryFrames| frames,
+  // most recent first.  The first entry is the frame in progress.
+  std::vector<std::vector<SkISize>> size_history_;
+  std::vector<Prediction> predictions_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(SurfaceSizePredictor);
+};
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_SURFACE_SIZE_PREDICTOR_H_
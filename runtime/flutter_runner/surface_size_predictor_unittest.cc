@@ -0,0 +1,73 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/surface_size_predictor.h"
+
+#include <gtest/gtest.h>
+
+namespace flutter_runner_test {
+
+using flutter_runner::SurfaceSizePredictor;
+
+TEST(SurfaceSizePredictorTest, ScalesRecentSizesLargestFirst) {
+  SurfaceSizePredictor predictor;
+  predictor.OnSurfaceAcquired(SkISize::Make(100, 50));
+  predictor.OnSurfaceAcquired(SkISize::Make(400, 300));
+  predictor.OnSurfaceAcquired(SkISize::Make(100, 50));
+  predictor.OnFrameEnd();
+
+  const auto sizes = predictor.PredictSizes(1.5f, 2.f);
+  ASSERT_EQ(sizes.size(), 2u);
+  EXPECT_EQ(sizes[0], SkISize::Make(600, 600));
+  EXPECT_EQ(sizes[1], SkISize::Make(150, 100));
+}
+
+TEST(SurfaceSizePredictorTest, IgnoresNeutralHints) {
+  SurfaceSizePredictor predictor;
+  predictor.OnSurfaceAcquired(SkISize::Make(100, 100));
+  predictor.OnFrameEnd();
+
+  EXPECT_TRUE(predictor.PredictSizes(1.f, 1.f).empty());
+  EXPECT_TRUE(predictor.PredictSizes(0.f, 2.f).empty());
+}
+
+TEST(SurfaceSizePredictorTest, CountsHitsAndMisses) {
+  SurfaceSizePredictor predictor;
+  predictor.OnSurfaceAcquired(SkISize::Make(100, 100));
+  predictor.OnSurfaceAcquired(SkISize::Make(10, 10));
+  predictor.OnFrameEnd();
+
+  ASSERT_EQ(predictor.PredictSizes(2.f, 2.f).size(), 2u);
+  // Outstanding predictions are not returned again.
+  EXPECT_TRUE(predictor.PredictSizes(2.f, 2.f).empty());
+
+  predictor.OnSurfaceAcquired(SkISize::Make(200, 200));
+  predictor.OnFrameEnd();
+  EXPECT_EQ(predictor.hits(), 1u);
+  EXPECT_EQ(predictor.misses(), 0u);
+
+  for (size_t i = 0; i < SurfaceSizePredictor::kPredictionLifetime; i++) {
+    predictor.OnFrameEnd();
+  }
+  EXPECT_EQ(predictor.hits(), 1u);
+  EXPECT_EQ(predictor.misses(), 1u);
+
+  predictor.ResetCounters();
+  EXPECT_EQ(predictor.hits(), 0u);
+  EXPECT_EQ(predictor.misses(), 0u);
+}
+
+TEST(SurfaceSizePredictorTest, IdleFramesKeepHistory) {
+  SurfaceSizePredictor predictor;
+  predictor.OnSurfaceAcquired(SkISize::Make(100, 100));
+  for (int i = 0; i < 10; i++) {
+    predictor.OnFrameEnd();
+  }
+
+  const auto sizes = predictor.PredictSizes(0.5f, 0.5f);
+  ASSERT_EQ(sizes.size(), 1u);
+  EXPECT_EQ(sizes[0], SkISize::Make(50, 50));
+}
+
+}  // namespace flutter_runner_test
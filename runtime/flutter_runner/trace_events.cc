@@ -0,0 +1,67 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/trace_events.h"
+
+#include <algorithm>
+
+#include "rapidjson/document.h"
+
+namespace flutter_runner {
+
+bool ParseTraceEvents(const std::string& json,
+                      const std::set<std::string>& names,
+                      std::vector<TraceEvent>* out_events) {
+  rapidjson::Document document;
+  document.Parse(json.data(), json.size());
+  if (document.HasParseError() || !document.IsObject()) {
+    return false;
+  }
+  auto trace_events = document.FindMember("traceEvents");
+  if (trace_events == document.MemberEnd() ||
+      !trace_events->value.IsArray()) {
+    return false;
+  }
+
+  std::vector<TraceEvent> events;
+  for (const auto& event : trace_events->value.GetArray()) {
+    if (!event.IsObject()) {
+      continue;
+    }
+    auto name = event.FindMember("name");
+    if (name == event.MemberEnd() || !name->value.IsString()) {
+      continue;
+    }
+    auto phase = event.FindMember("ph");
+    if (phase != event.MemberEnd() && phase->value.IsString() &&
+        std::string(phase->value.GetString()) == "E") {
+      continue;
+    }
+    if (names.count(name->value.GetString()) == 0) {
+      continue;
+    }
+    TraceEvent& out_event = events.emplace_back();
+    out_event.name = name->value.GetString();
+    auto timestamp = event.FindMember("ts");
+    if (timestamp != event.MemberEnd() && timestamp->value.IsNumber()) {
+      out_event.timestamp = timestamp->value.GetDouble();
+    }
+    auto args = event.FindMember("args");
+    if (args != event.MemberEnd() && args->value.IsObject()) {
+      for (const auto& arg : args->value.GetObject()) {
+        if (arg.value.IsInt64()) {
+          out_event.args.emplace(arg.name.GetString(), arg.value.GetInt64());
+        }
+      }
+    }
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const TraceEvent& a, const TraceEvent& b) {
+                     return a.timestamp < b.timestamp;
+                   });
+  *out_events = std::move(events);
+  return true;
+}
+
+}  // namespace flutter_runner
@@ -0,0 +1,35 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_TRACE_EVENTS_H_
+#define TOPAZ_RUNTIME_FLUTTER_RUNNER_TRACE_EVENTS_H_
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace flutter_runner {
+
+// An event of a trace captured on a device and exported as JSON, as
+// `trace2json` and `traceutil convert` write it.
+struct TraceEvent {
+  std::string name;
+  // In microseconds.
+  double timestamp = 0;
+  // The integer arguments of the event.  Other arguments are dropped.
+  std::map<std::string, int64_t> args;
+};
+
+// Parses the "traceEvents" of a JSON trace, keeping the events named in
+// |names| in timestamp order.  Events that end a duration are skipped, so
+// each duration appears once.  Returns false on malformed input.
+bool ParseTraceEvents(const std::string& json,
+                      const std::set<std::string>& names,
+                      std::vector<TraceEvent>* out_events);
+
+}  // namespace flutter_runner
+
+#endif  // TOPAZ_RUNTIME_FLUTTER_RUNNER_TRACE_EVENTS_H_
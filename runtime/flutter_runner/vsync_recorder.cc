@@ -4,49 +4,105 @@
 
 #include "vsync_recorder.h"
 
-#include <mutex>
-
 namespace flutter_runner {
 
 namespace {
 
-std::mutex g_mutex;
-
 // Since we don't have any presentation info until we call |Present| for the
 // first time, assume a 60hz refresh rate in the meantime.
 constexpr fml::TimeDelta kDefaultPresentationInterval =
     fml::TimeDelta::FromSecondsF(1.0 / 60.0);
 
+VsyncInfo ToVsyncInfo(int64_t presentation_time,
+                      int64_t presentation_interval) {
+  return {fml::TimePoint::FromEpochDelta(
+              fml::TimeDelta::FromNanoseconds(presentation_time)),
+          fml::TimeDelta::FromNanoseconds(presentation_interval)};
+}
+
 }  // namespace
 
-VsyncRecorder& VsyncRecorder::GetInstance() {
-  static VsyncRecorder vsync_recorder;
-  return vsync_recorder;
-}
+VsyncRecorder::VsyncRecorder() = default;
+
+VsyncRecorder::~VsyncRecorder() = default;
 
 VsyncInfo VsyncRecorder::GetCurrentVsyncInfo() const {
-  {
-    std::unique_lock<std::mutex> lock(g_mutex);
-    if (last_presentation_info_) {
-      return {fml::TimePoint::FromEpochDelta(fml::TimeDelta::FromNanoseconds(
-                  last_presentation_info_->presentation_time)),
-              fml::TimeDelta::FromNanoseconds(
-                  last_presentation_info_->presentation_interval)};
+  while (true) {
+    const uint64_t sequence = sequence_.load(std::memory_order_acquire);
+    if (sequence % 2 != 0) {
+      continue;
+    }
+    const uint64_t count = count_.load(std::memory_order_relaxed);
+    int64_t presentation_time = 0;
+    int64_t presentation_interval = 0;
+    if (count > 0) {
+      const Record& record = history_[(count - 1) % kHistorySize];
+      presentation_time =
+          record.presentation_time.load(std::memory_order_relaxed);
+      presentation_interval =
+          record.presentation_interval.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) != sequence) {
+      continue;
+    }
+    if (count == 0) {
+      return {fml::TimePoint::Now(), kDefaultPresentationInterval};
+    }
+    return ToVsyncInfo(presentation_time, presentation_interval);
+  }
+}
+
+std::vector<VsyncInfo> VsyncRecorder::GetHistory() const {
+  std::vector<VsyncInfo> history;
+  history.reserve(kHistorySize);
+  while (true) {
+    history.clear();
+    const uint64_t sequence = sequence_.load(std::memory_order_acquire);
+    if (sequence % 2 != 0) {
+      continue;
+    }
+    const uint64_t count = count_.load(std::memory_order_relaxed);
+    const uint64_t first = count > kHistorySize ? count - kHistorySize : 0;
+    for (uint64_t i = first; i < count; i++) {
+      const Record& record = history_[i % kHistorySize];
+      history.push_back(ToVsyncInfo(
+          record.presentation_time.load(std::memory_order_relaxed),
+          record.presentation_interval.load(std::memory_order_relaxed)));
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) == sequence) {
+      return history;
     }
   }
-  return {fml::TimePoint::Now(), kDefaultPresentationInterval};
 }
 
 void VsyncRecorder::UpdateVsyncInfo(
     fuchsia::images::PresentationInfo presentation_info) {
-  std::unique_lock<std::mutex> lock(g_mutex);
-  if (last_presentation_info_ &&
-      presentation_info.presentation_time >
-          last_presentation_info_->presentation_time) {
-    last_presentation_info_ = presentation_info;
-  } else if (!last_presentation_info_) {
-    last_presentation_info_ = presentation_info;
+  // Only this thread writes, so relaxed loads see our own latest values.
+  const int64_t presentation_time =
+      static_cast<int64_t>(presentation_info.presentation_time);
+  const int64_t presentation_interval =
+      static_cast<int64_t>(presentation_info.presentation_interval);
+  const uint64_t count = count_.load(std::memory_order_relaxed);
+  if (count > 0 &&
+      presentation_time <=
+          history_[(count - 1) % kHistorySize].presentation_time.load(
+              std::memory_order_relaxed)) {
+    return;
   }
+
+  const uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  Record& record = history_[count % kHistorySize];
+  record.presentation_time.store(presentation_time, std::memory_order_relaxed);
+  record.presentation_interval.store(presentation_interval,
+                                     std::memory_order_relaxed);
+  count_.store(count + 1, std::memory_order_relaxed);
+
+  sequence_.store(sequence + 2, std::memory_order_release);
 }
 
 }  // namespace flutter_runner
@@ -5,7 +5,10 @@
 #ifndef TOPAZ_RUNTIME_FLUTTER_RUNNER_VSYNC_RECORDER_H_
 #define TOPAZ_RUNTIME_FLUTTER_RUNNER_VSYNC_RECORDER_H_
 
-#include <optional>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
 
 #include "flutter/fml/time/time_delta.h"
 #include "flutter/fml/time/time_point.h"
@@ -18,26 +21,46 @@ struct VsyncInfo {
   fml::TimeDelta presentation_interval;
 };
 
+// Records the |PresentationInfo| Scenic reports for one session.
+//
+// The record is a seqlock: the writer bumps a sequence number around each
+// update, and readers retry if it changed while they were reading.  Readers
+// never block the writer or each other, and the writer never waits.
 class VsyncRecorder {
  public:
-  static VsyncRecorder& GetInstance();
+  // Number of recent presentation infos kept for |GetHistory|.
+  static constexpr size_t kHistorySize = 32;
+
+  VsyncRecorder();
+
+  ~VsyncRecorder();
 
   // Retrieve the most recent |PresentationInfo| provided to us by scenic.
   // This function is safe to call from any thread.
   VsyncInfo GetCurrentVsyncInfo() const;
 
+  // Retrieve up to |kHistorySize| recent presentation infos, oldest first.
+  // This function is safe to call from any thread.
+  std::vector<VsyncInfo> GetHistory() const;
+
   // Update the current Vsync info to |presentation_info|.  This is expected
   // to be called in |scenic::Sesssion::Present| callbacks with the
-  // presentation info provided by scenic.  Only the most recent vsync
-  // information will be saved (in order to handle edge cases involving
-  // multiple scenic sessions in the same process).  This function is safe to
-  // call from any thread.
+  // presentation info provided by scenic.  Infos older than the current one
+  // are ignored.  Only one thread may call this at a time.
   void UpdateVsyncInfo(fuchsia::images::PresentationInfo presentation_info);
 
  private:
-  VsyncRecorder() = default;
+  struct Record {
+    std::atomic<int64_t> presentation_time{0};
+    std::atomic<int64_t> presentation_interval{0};
+  };
 
-  std::optional<fuchsia::images::PresentationInfo> last_presentation_info_;
+  // Even while no update is in progress.
+  std::atomic<uint64_t> sequence_{0};
+  // Number of infos recorded so far.  |history_[(count - 1) % kHistorySize]|
+  // is the current one.
+  std::atomic<uint64_t> count_{0};
+  std::array<Record, kHistorySize> history_;
 
   // Disallow copy and assignment.
   VsyncRecorder(const VsyncRecorder&) = delete;
@@ -0,0 +1,86 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "topaz/runtime/flutter_runner/vsync_recorder.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+namespace flutter_runner_test {
+
+using flutter_runner::VsyncInfo;
+using flutter_runner::VsyncRecorder;
+
+namespace {
+
+fuchsia::images::PresentationInfo MakeInfo(uint64_t time, uint64_t interval) {
+  fuchsia::images::PresentationInfo info;
+  info.presentation_time = time;
+  info.presentation_interval = interval;
+  return info;
+}
+
+}  // namespace
+
+TEST(VsyncRecorderTest, DefaultsToSixtyHertz) {
+  VsyncRecorder recorder;
+  VsyncInfo info = recorder.GetCurrentVsyncInfo();
+  EXPECT_EQ(info.presentation_interval,
+            fml::TimeDelta::FromSecondsF(1.0 / 60.0));
+  EXPECT_TRUE(recorder.GetHistory().empty());
+}
+
+TEST(VsyncRecorderTest, IgnoresOlderInfos) {
+  VsyncRecorder recorder;
+  recorder.UpdateVsyncInfo(MakeInfo(2000, 16));
+  recorder.UpdateVsyncInfo(MakeInfo(1000, 8));
+  recorder.UpdateVsyncInfo(MakeInfo(2000, 8));
+
+  VsyncInfo info = recorder.GetCurrentVsyncInfo();
+  EXPECT_EQ(info.presentation_time.ToEpochDelta().ToNanoseconds(), 2000);
+  EXPECT_EQ(info.presentation_interval.ToNanoseconds(), 16);
+  EXPECT_EQ(recorder.GetHistory().size(), 1u);
+}
+
+TEST(VsyncRecorderTest, HistoryKeepsMostRecentOldestFirst) {
+  VsyncRecorder recorder;
+  const size_t count = VsyncRecorder::kHistorySize + 5;
+  for (size_t i = 1; i <= count; i++) {
+    recorder.UpdateVsyncInfo(MakeInfo(i * 100, i));
+  }
+
+  auto history = recorder.GetHistory();
+  ASSERT_EQ(history.size(), VsyncRecorder::kHistorySize);
+  EXPECT_EQ(history.front().presentation_interval.ToNanoseconds(), 6);
+  EXPECT_EQ(history.back().presentation_interval.ToNanoseconds(),
+            static_cast<int64_t>(count));
+}
+
+TEST(VsyncRecorderTest, ReadersNeverSeeTornUpdates) {
+  VsyncRecorder recorder;
+  recorder.UpdateVsyncInfo(MakeInfo(1000, 1));
+  std::atomic<bool> done = false;
+  std::thread writer([&] {
+    for (uint64_t i = 2; i <= 100000; i++) {
+      recorder.UpdateVsyncInfo(MakeInfo(i * 1000, i));
+    }
+    done = true;
+  });
+
+  // Every info the writer records has a time of 1000 times its interval.
+  while (!done) {
+    VsyncInfo info = recorder.GetCurrentVsyncInfo();
+    EXPECT_EQ(info.presentation_time.ToEpochDelta().ToNanoseconds(),
+              info.presentation_interval.ToNanoseconds() * 1000);
+    for (const VsyncInfo& entry : recorder.GetHistory()) {
+      EXPECT_EQ(entry.presentation_time.ToEpochDelta().ToNanoseconds(),
+                entry.presentation_interval.ToNanoseconds() * 1000);
+    }
+  }
+  writer.join();
+}
+
+}  // namespace flutter_runner_test
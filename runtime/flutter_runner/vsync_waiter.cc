@@ -7,16 +7,18 @@
 #include <lib/async/default.h>
 #include <trace/event.h>
 
-#include "vsync_recorder.h"
-
 namespace flutter_runner {
 
 VsyncWaiter::VsyncWaiter(std::string debug_label,
                          zx_handle_t session_present_handle,
+                         std::shared_ptr<VsyncRecorder> vsync_recorder,
+                         std::shared_ptr<FrameScheduler> frame_scheduler,
                          flutter::TaskRunners task_runners)
     : flutter::VsyncWaiter(task_runners),
       debug_label_(std::move(debug_label)),
       session_wait_(session_present_handle, SessionPresentSignal),
+      vsync_recorder_(std::move(vsync_recorder)),
+      frame_scheduler_(std::move(frame_scheduler)),
       weak_factory_(this) {
   auto wait_handler = [&](async_dispatcher_t* dispatcher,   //
                           async::Wait* wait,                //
@@ -38,29 +40,19 @@ VsyncWaiter::VsyncWaiter(std::string debug_label,
 
 VsyncWaiter::~VsyncWaiter() { session_wait_.Cancel(); }
 
-static fml::TimePoint SnapToNextPhase(fml::TimePoint value,
-                                      fml::TimePoint phase,
-                                      fml::TimeDelta interval) {
-  fml::TimeDelta offset = (phase - value) % interval;
-  if (offset < fml::TimeDelta::Zero()) {
-    offset = offset + interval;
-  }
-  return value + offset;
-}
-
 void VsyncWaiter::AwaitVSync() {
-  VsyncInfo vsync_info = VsyncRecorder::GetInstance().GetCurrentVsyncInfo();
+  VsyncInfo vsync_info = vsync_recorder_->GetCurrentVsyncInfo();
 
   fml::TimePoint now = fml::TimePoint::Now();
-  fml::TimePoint next_vsync = SnapToNextPhase(now, vsync_info.presentation_time,
-                                              vsync_info.presentation_interval);
+  frame_times_ = frame_scheduler_->GetNextFrameTimes(
+      now, vsync_info.presentation_time, vsync_info.presentation_interval);
   task_runners_.GetUITaskRunner()->PostDelayedTask(
       [self = weak_factory_.GetWeakPtr()] {
         if (self) {
           self->FireCallbackWhenSessionAvailable();
         }
       },
-      next_vsync - now);
+      frame_times_.wakeup_time - now);
 }
 
 void VsyncWaiter::FireCallbackWhenSessionAvailable() {
@@ -74,14 +66,22 @@ void VsyncWaiter::FireCallbackWhenSessionAvailable() {
 void VsyncWaiter::FireCallbackNow() {
   FML_DCHECK(task_runners_.GetUITaskRunner()->RunsTasksOnCurrentThread());
 
-  VsyncInfo vsync_info = VsyncRecorder::GetInstance().GetCurrentVsyncInfo();
+  VsyncInfo vsync_info = vsync_recorder_->GetCurrentVsyncInfo();
 
+  // Waiting for the session may have made us late, in which case aim for
+  // the earliest vsync still reachable instead.
   fml::TimePoint now = fml::TimePoint::Now();
-  fml::TimePoint next_vsync = SnapToNextPhase(now, vsync_info.presentation_time,
-                                              vsync_info.presentation_interval);
-  fml::TimePoint previous_vsync = next_vsync - vsync_info.presentation_interval;
-
-  FireCallback(previous_vsync, next_vsync);
+  auto frame_times = frame_scheduler_->GetStartFrameTimes(
+      frame_times_, now, vsync_info.presentation_time,
+      vsync_info.presentation_interval);
+  fml::TimePoint target_vsync = frame_times.target_time;
+  fml::TimePoint previous_vsync =
+      target_vsync - vsync_info.presentation_interval;
+  // The engine hands |previous_vsync| back as the layer tree's build start,
+  // which identifies the frame from here on.
+  frame_scheduler_->OnFrameStarted(previous_vsync, now, target_vsync);
+
+  FireCallback(previous_vsync, target_vsync);
 }
 
 }  // namespace flutter_runner
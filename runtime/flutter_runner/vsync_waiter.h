@@ -7,10 +7,14 @@
 
 #include <lib/async/cpp/wait.h>
 
+#include <memory>
+
 #include "flutter/fml/macros.h"
 #include "flutter/fml/memory/weak_ptr.h"
 #include "flutter/fml/time/time_point.h"
 #include "flutter/shell/common/vsync_waiter.h"
+#include "frame_scheduler.h"
+#include "vsync_recorder.h"
 
 namespace flutter_runner {
 
@@ -19,6 +23,8 @@ class VsyncWaiter final : public flutter::VsyncWaiter {
   static constexpr zx_signals_t SessionPresentSignal = ZX_EVENT_SIGNALED;
 
   VsyncWaiter(std::string debug_label, zx_handle_t session_present_handle,
+              std::shared_ptr<VsyncRecorder> vsync_recorder,
+              std::shared_ptr<FrameScheduler> frame_scheduler,
               flutter::TaskRunners task_runners);
 
   ~VsyncWaiter() override;
@@ -26,6 +32,10 @@ class VsyncWaiter final : public flutter::VsyncWaiter {
  private:
   const std::string debug_label_;
   async::Wait session_wait_;
+  std::shared_ptr<VsyncRecorder> vsync_recorder_;
+  std::shared_ptr<FrameScheduler> frame_scheduler_;
+  // The frame times |AwaitVSync| chose for the frame being waited for.
+  FrameScheduler::FrameTimes frame_times_;
   fml::WeakPtrFactory<VsyncWaiter> weak_factory_;
 
   // |flutter::VsyncWaiter|
@@ -0,0 +1,253 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "vulkan_memory_arena.h"
+
+#include <lib/zx/vmo.h>
+#include <trace/event.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace flutter_runner {
+
+class VulkanMemoryArena::Block final {
+ public:
+  Block(uint32_t memory_type,
+        vulkan::VulkanHandle<VkDeviceMemory> vk_memory,
+        std::unique_ptr<scenic::Memory> scenic_memory)
+      : memory_type_(memory_type),
+        vk_memory_(std::move(vk_memory)),
+        scenic_memory_(std::move(scenic_memory)),
+        ranges_(kBlockSize) {}
+
+  uint32_t memory_type() const { return memory_type_; }
+  VkDeviceMemory vk_memory() const { return vk_memory_; }
+  scenic::Memory& scenic_memory() const { return *scenic_memory_; }
+  MemoryRangeAllocator& ranges() { return ranges_; }
+  const MemoryRangeAllocator& ranges() const { return ranges_; }
+
+  // Frees the range at |offset| once |release_fence| is signaled.
+  void FreeAfter(VkDeviceSize offset, zx::event release_fence) {
+    released_ranges_.emplace_back(offset, std::move(release_fence));
+  }
+
+  bool has_released_ranges() const { return !released_ranges_.empty(); }
+
+  void CollectReleasedRanges() {
+    released_ranges_.erase(
+        std::remove_if(released_ranges_.begin(), released_ranges_.end(),
+                       [this](const auto& released_range) {
+                         if (released_range.second.wait_one(
+                                 ZX_EVENT_SIGNALED, zx::time(), nullptr) !=
+                             ZX_OK) {
+                           return false;
+                         }
+                         ranges_.Free(released_range.first);
+                         return true;
+                       }),
+        released_ranges_.end());
+  }
+
+ private:
+  const uint32_t memory_type_;
+  vulkan::VulkanHandle<VkDeviceMemory> vk_memory_;
+  std::unique_ptr<scenic::Memory> scenic_memory_;
+  MemoryRangeAllocator ranges_;
+  // Ranges that stay allocated until the compositor is done with them.
+  std::vector<std::pair<VkDeviceSize, zx::event>> released_ranges_;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(Block);
+};
+
+VulkanMemoryArena::Allocation::Allocation(std::shared_ptr<Block> block,
+                                          VkDeviceSize offset,
+                                          VkDeviceSize size)
+    : block_(std::move(block)), offset_(offset), size_(size) {}
+
+VulkanMemoryArena::Allocation::~Allocation() {
+  if (release_fence_) {
+    block_->FreeAfter(offset_, std::move(release_fence_));
+  } else {
+    block_->ranges().Free(offset_);
+  }
+}
+
+VkDeviceMemory VulkanMemoryArena::Allocation::vk_memory() const {
+  return block_->vk_memory();
+}
+
+uint32_t VulkanMemoryArena::Allocation::memory_type() const {
+  return block_->memory_type();
+}
+
+scenic::Memory& VulkanMemoryArena::Allocation::scenic_memory() const {
+  return block_->scenic_memory();
+}
+
+VulkanMemoryArena::VulkanMemoryArena(vulkan::VulkanProvider& vulkan_provider,
+                                     scenic::Session* session)
+    : vulkan_provider_(vulkan_provider), session_(session) {
+  FML_DCHECK(session_);
+}
+
+VulkanMemoryArena::~VulkanMemoryArena() = default;
+
+std::unique_ptr<VulkanMemoryArena::Allocation> VulkanMemoryArena::Allocate(
+    const VkMemoryRequirements& memory_requirements) {
+  FML_DCHECK(ShouldAllocate(memory_requirements));
+
+  CollectReleasedRanges();
+  for (auto& block : blocks_) {
+    if (!(memory_requirements.memoryTypeBits & (1 << block->memory_type()))) {
+      continue;
+    }
+    const uint64_t offset = block->ranges().Allocate(
+        memory_requirements.size, memory_requirements.alignment);
+    if (offset != MemoryRangeAllocator::kInvalidOffset) {
+      return std::unique_ptr<Allocation>(
+          new Allocation(block, offset, memory_requirements.size));
+    }
+  }
+
+  // Match the memory type |VulkanSurface| picks for dedicated allocations.
+  uint32_t memory_type = 0;
+  for (; memory_type < 32; memory_type++) {
+    if ((memory_requirements.memoryTypeBits & (1 << memory_type))) {
+      break;
+    }
+  }
+
+  auto block = CreateBlock(memory_type);
+  if (!block) {
+    return nullptr;
+  }
+
+  // Don't keep the block around if even a fresh one can't hold the range.
+  const uint64_t offset = block->ranges().Allocate(
+      memory_requirements.size, memory_requirements.alignment);
+  if (offset == MemoryRangeAllocator::kInvalidOffset) {
+    return nullptr;
+  }
+  blocks_.push_back(block);
+  return std::unique_ptr<Allocation>(
+      new Allocation(std::move(block), offset, memory_requirements.size));
+}
+
+std::shared_ptr<VulkanMemoryArena::Block> VulkanMemoryArena::CreateBlock(
+    uint32_t memory_type) {
+  TRACE_DURATION("flutter", "VulkanMemoryArena::CreateBlock");
+
+  // Unlike the memory of a standalone surface, blocks are not dedicated to a
+  // single image.
+  VkExportMemoryAllocateInfoKHR export_allocate_info = {
+      .sType = VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO_KHR,
+      .pNext = nullptr,
+      .handleTypes =
+          VK_EXTERNAL_MEMORY_HANDLE_TYPE_TEMP_ZIRCON_VMO_BIT_FUCHSIA};
+
+  const VkMemoryAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .pNext = &export_allocate_info,
+      .allocationSize = kBlockSize,
+      .memoryTypeIndex = memory_type,
+  };
+
+  vulkan::VulkanHandle<VkDeviceMemory> vk_memory;
+  {
+    TRACE_DURATION("flutter", "vk().AllocateMemory", "allocation_size",
+                   alloc_info.allocationSize);
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (VK_CALL_LOG_ERROR(vulkan_provider_.vk().AllocateMemory(
+            vulkan_provider_.vk_device(), &alloc_info, NULL, &memory)) !=
+        VK_SUCCESS) {
+      return nullptr;
+    }
+
+    vk_memory = {memory, [& vulkan_provider =
+                              vulkan_provider_](VkDeviceMemory memory) {
+                   vulkan_provider.vk().FreeMemory(vulkan_provider.vk_device(),
+                                                   memory, NULL);
+                 }};
+  }
+
+  // Acquire the VMO for the device memory.
+  zx::vmo exported_vmo;
+  {
+    uint32_t vmo_handle = 0;
+
+    VkMemoryGetZirconHandleInfoFUCHSIA get_handle_info = {
+        VK_STRUCTURE_TYPE_TEMP_MEMORY_GET_ZIRCON_HANDLE_INFO_FUCHSIA, nullptr,
+        vk_memory, VK_EXTERNAL_MEMORY_HANDLE_TYPE_TEMP_ZIRCON_VMO_BIT_FUCHSIA};
+    if (VK_CALL_LOG_ERROR(vulkan_provider_.vk().GetMemoryZirconHandleFUCHSIA(
+            vulkan_provider_.vk_device(), &get_handle_info, &vmo_handle)) !=
+        VK_SUCCESS) {
+      return nullptr;
+    }
+
+    exported_vmo.reset(static_cast<zx_handle_t>(vmo_handle));
+  }
+
+  uint64_t vmo_size = 0;
+  if (exported_vmo.get_size(&vmo_size) != ZX_OK || vmo_size < kBlockSize) {
+    return nullptr;
+  }
+
+  auto scenic_memory = std::make_unique<scenic::Memory>(
+      session_, std::move(exported_vmo), vmo_size,
+      fuchsia::images::MemoryType::VK_DEVICE_MEMORY);
+
+  return std::make_shared<Block>(memory_type, std::move(vk_memory),
+                                 std::move(scenic_memory));
+}
+
+bool VulkanMemoryArena::IsFragmented() const {
+  VkDeviceSize free_bytes = 0;
+  VkDeviceSize largest_free_range = 0;
+  for (const auto& block : blocks_) {
+    // Ranges waiting on a release fence are about to be freed, and whatever
+    // compaction frees meanwhile would wait behind them.  Judge the arena
+    // once they have drained.
+    if (block->has_released_ranges()) {
+      return false;
+    }
+    if (block->ranges().empty()) {
+      // Empty blocks are released rather than compacted.
+      continue;
+    }
+    free_bytes += block->ranges().free_bytes();
+    largest_free_range =
+        std::max(largest_free_range, block->ranges().LargestFreeRange());
+  }
+  // Don't bother if the free memory could not hold a single surface anyway.
+  if (free_bytes < kMaxAllocationSize) {
+    return false;
+  }
+  return largest_free_range < free_bytes * kMinLargestFreeRangeFraction;
+}
+
+void VulkanMemoryArena::CollectReleasedRanges() {
+  for (auto& block : blocks_) {
+    block->CollectReleasedRanges();
+  }
+}
+
+void VulkanMemoryArena::ReleaseEmptyBlocks() {
+  CollectReleasedRanges();
+  blocks_.erase(std::remove_if(blocks_.begin(), blocks_.end(),
+                               [](const std::shared_ptr<Block>& block) {
+                                 return block->ranges().empty();
+                               }),
+                blocks_.end());
+}
+
+VkDeviceSize VulkanMemoryArena::used_bytes() const {
+  VkDeviceSize used_bytes = 0;
+  for (const auto& block : blocks_) {
+    used_bytes += block->ranges().used_bytes();
+  }
+  return used_bytes;
+}
+
+}  // namespace flutter_runner
@@ -0,0 +1,114 @@
+// Copyright 2019 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <lib/zx/event.h>
+
+#include <memory>
+#include <vector>
+
+#include "flutter/fml/macros.h"
+#include "flutter/vulkan/vulkan_handle.h"
+#include "flutter/vulkan/vulkan_provider.h"
+#include "lib/ui/scenic/cpp/resources.h"
+#include "memory_range_allocator.h"
+
+namespace flutter_runner {
+
+// Sub-allocates image memory for small surfaces out of a few large blocks of
+// exported |VkDeviceMemory|.  Each block is imported into the session once as
+// a |scenic::Memory|, so surfaces sharing a block share that memory resource
+// and its VMO instead of paying for their own.
+//
+// Allocations never move.  The arena only reports when its blocks have become
+// fragmented; it is up to the owner to release idle surfaces so that their
+// ranges coalesce.
+class VulkanMemoryArena final {
+ public:
+  static constexpr VkDeviceSize kBlockSize = 16 * (1 << 20);
+  // Larger allocations would waste too much of a block when they are freed
+  // and should use dedicated memory instead.  This fits a 512x512 BGRA image.
+  static constexpr VkDeviceSize kMaxAllocationSize = kBlockSize / 8;
+  // The arena counts as fragmented when less than this fraction of its free
+  // memory is in a single range.
+  static constexpr double kMinLargestFreeRangeFraction = 0.5;
+
+  class Block;
+
+  // A range of one of the arena's blocks.  The range is released when the
+  // allocation is destroyed, or once its release fence is signaled if it has
+  // one.  Allocations keep their block alive, so they may outlive the arena.
+  class Allocation final {
+   public:
+    ~Allocation();
+
+    VkDeviceMemory vk_memory() const;
+    VkDeviceSize offset() const { return offset_; }
+    VkDeviceSize size() const { return size_; }
+    uint32_t memory_type() const;
+    scenic::Memory& scenic_memory() const;
+
+    // Keep the range from being handed out again until |release_fence| is
+    // signaled, for memory the compositor may still be reading.
+    void SetReleaseFence(zx::event release_fence) {
+      release_fence_ = std::move(release_fence);
+    }
+
+   private:
+    friend class VulkanMemoryArena;
+
+    Allocation(std::shared_ptr<Block> block,
+               VkDeviceSize offset,
+               VkDeviceSize size);
+
+    std::shared_ptr<Block> block_;
+    const VkDeviceSize offset_;
+    const VkDeviceSize size_;
+    zx::event release_fence_;
+
+    FML_DISALLOW_COPY_AND_ASSIGN(Allocation);
+  };
+
+  VulkanMemoryArena(vulkan::VulkanProvider& vulkan_provider,
+                    scenic::Session* session);
+
+  ~VulkanMemoryArena();
+
+  // Whether memory with |memory_requirements| should come from the arena.
+  static bool ShouldAllocate(const VkMemoryRequirements& memory_requirements) {
+    return memory_requirements.size <= kMaxAllocationSize;
+  }
+
+  // Returns a range satisfying |memory_requirements|, creating a new block if
+  // none of the existing ones has room, or nullptr on failure.  Ranges whose
+  // release fence has been signaled are freed first.
+  std::unique_ptr<Allocation> Allocate(
+      const VkMemoryRequirements& memory_requirements);
+
+  // Whether the free memory of the blocks in use is split up.  Never true
+  // while ranges are waiting on their release fence.
+  bool IsFragmented() const;
+
+  // Free the ranges whose release fence has been signaled.
+  void CollectReleasedRanges();
+
+  // Destroy blocks that have no live allocations.
+  void ReleaseEmptyBlocks();
+
+  size_t block_count() const { return blocks_.size(); }
+
+  VkDeviceSize used_bytes() const;
+
+ private:
+  vulkan::VulkanProvider& vulkan_provider_;
+  scenic::Session* session_;
+  std::vector<std::shared_ptr<Block>> blocks_;
+
+  std::shared_ptr<Block> CreateBlock(uint32_t memory_type);
+
+  FML_DISALLOW_COPY_AND_ASSIGN(VulkanMemoryArena);
+};
+
+}  // namespace flutter_runner
@@ -78,37 +78,81 @@ bool CreateVulkanImage(vulkan::VulkanProvider& vulkan_provider,
         }};
   }
 
-  vulkan_provider.vk().GetImageMemoryRequirements(
-      vulkan_provider.vk_device(), out_vulkan_image->vk_image,
-      &out_vulkan_image->vk_memory_requirements);
+  VkMemoryDedicatedRequirements dedicated_requirements = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS,
+      .pNext = nullptr,
+  };
+  VkMemoryRequirements2 memory_requirements = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+      .pNext = &dedicated_requirements,
+  };
+  const VkImageMemoryRequirementsInfo2 requirements_info = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2,
+      .pNext = nullptr,
+      .image = out_vulkan_image->vk_image,
+  };
+  vulkan_provider.vk().GetImageMemoryRequirements2(
+      vulkan_provider.vk_device(), &requirements_info, &memory_requirements);
+
+  out_vulkan_image->vk_memory_requirements =
+      memory_requirements.memoryRequirements;
+  out_vulkan_image->dedicated_allocation =
+      dedicated_requirements.requiresDedicatedAllocation ||
+      dedicated_requirements.prefersDedicatedAllocation;
 
   return true;
 }
 
+VulkanCommandSubmission::VulkanCommandSubmission(
+    vulkan::VulkanProvider& vulkan_provider,
+    const vulkan::VulkanHandle<VkCommandPool>& pool)
+    : vulkan_provider_(vulkan_provider),
+      command_buffer_(vulkan_provider.vk(), vulkan_provider.vk_device(), pool),
+      fence_(vulkan_provider.CreateFence()) {}
+
+VulkanCommandSubmission::~VulkanCommandSubmission() {
+  Wait();
+}
+
+void VulkanCommandSubmission::Wait() {
+  if (!submitted_) {
+    return;
+  }
+  VkFence fence = fence_;
+  VK_CALL_LOG_ERROR(vulkan_provider_.vk().WaitForFences(
+      vulkan_provider_.vk_device(), 1, &fence, VK_TRUE, UINT64_MAX));
+  submitted_ = false;
+}
+
 VulkanSurface::VulkanSurface(vulkan::VulkanProvider& vulkan_provider,
                              sk_sp<GrContext> context, scenic::Session* session,
-                             const SkISize& size)
+                             const SkISize& size,
+                             VulkanMemoryArena* memory_arena)
     : vulkan_provider_(vulkan_provider), session_(session), wait_(this) {
   FML_DCHECK(session_);
 
   zx::vmo exported_vmo;
-  if (!AllocateDeviceMemory(std::move(context), size, exported_vmo)) {
+  if (!AllocateDeviceMemory(std::move(context), size, memory_arena,
+                            exported_vmo)) {
     FML_DLOG(INFO) << "Could not allocate device memory.";
     return;
   }
 
-  uint64_t vmo_size;
-  zx_status_t status = exported_vmo.get_size(&vmo_size);
-  FML_DCHECK(status == ZX_OK);
-
   if (!CreateFences()) {
     FML_DLOG(INFO) << "Could not create signal fences.";
     return;
   }
 
-  scenic_memory_ = std::make_unique<scenic::Memory>(
-      session, std::move(exported_vmo), vmo_size,
-      fuchsia::images::MemoryType::VK_DEVICE_MEMORY);
+  // Surfaces carved out of the arena use the arena's |scenic::Memory|.
+  if (arena_allocation_ == nullptr) {
+    uint64_t vmo_size;
+    zx_status_t status = exported_vmo.get_size(&vmo_size);
+    FML_DCHECK(status == ZX_OK);
+
+    scenic_memory_ = std::make_unique<scenic::Memory>(
+        session, std::move(exported_vmo), vmo_size,
+        fuchsia::images::MemoryType::VK_DEVICE_MEMORY);
+  }
   if (!PushSessionImageSetupOps(session)) {
     FML_DLOG(INFO) << "Could not push session image setup ops.";
     return;
@@ -126,6 +170,19 @@ VulkanSurface::VulkanSurface(vulkan::VulkanProvider& vulkan_provider,
 VulkanSurface::~VulkanSurface() {
   wait_.Cancel();
   wait_.set_object(ZX_HANDLE_INVALID);
+
+  // Scenic may still be showing the image, and the arena would hand its range
+  // to the next surface.  Keep the range until the next present has released
+  // everything this surface was part of.
+  if (arena_allocation_ != nullptr && use_count_ > 0) {
+    zx::event release_fence, release_fence_dup;
+    if (zx::event::create(0, &release_fence) == ZX_OK &&
+        release_fence.duplicate(ZX_RIGHT_SAME_RIGHTS, &release_fence_dup) ==
+            ZX_OK) {
+      session_->EnqueueReleaseFence(std::move(release_fence_dup));
+      arena_allocation_->SetReleaseFence(std::move(release_fence));
+    }
+  }
 }
 
 bool VulkanSurface::IsValid() const { return valid_; }
@@ -200,13 +257,12 @@ bool VulkanSurface::CreateFences() {
     return false;
   }
 
-  command_buffer_fence_ = vulkan_provider_.CreateFence();
-
   return true;
 }
 
 bool VulkanSurface::AllocateDeviceMemory(sk_sp<GrContext> context,
                                          const SkISize& size,
+                                         VulkanMemoryArena* memory_arena,
                                          zx::vmo& exported_vmo) {
   if (size.isEmpty()) {
     return false;
@@ -224,6 +280,18 @@ bool VulkanSurface::AllocateDeviceMemory(sk_sp<GrContext> context,
   const VkImageCreateInfo& image_create_info =
       vulkan_image_.vk_image_create_info;
 
+  // Images the driver wants to have memory of their own are never carved out
+  // of the arena.
+  if (memory_arena != nullptr && !vulkan_image_.dedicated_allocation &&
+      VulkanMemoryArena::ShouldAllocate(memory_reqs)) {
+    if (AllocateArenaMemory(memory_arena)) {
+      return SetupSkiaSurface(std::move(context), size, kSkiaColorType,
+                              image_create_info, memory_reqs);
+    }
+    // Fall back to dedicated memory.
+    FML_DLOG(ERROR) << "Could not allocate memory from the arena.";
+  }
+
   uint32_t memory_type = 0;
   for (; memory_type < 32; memory_type++) {
     if ((memory_reqs.memoryTypeBits & (1 << memory_type))) {
@@ -302,6 +370,37 @@ bool VulkanSurface::AllocateDeviceMemory(sk_sp<GrContext> context,
                           image_create_info, memory_reqs);
 }
 
+bool VulkanSurface::AllocateArenaMemory(VulkanMemoryArena* memory_arena) {
+  auto allocation =
+      memory_arena->Allocate(vulkan_image_.vk_memory_requirements);
+  if (allocation == nullptr) {
+    return false;
+  }
+
+  if (VK_CALL_LOG_ERROR(vulkan_provider_.vk().BindImageMemory(
+          vulkan_provider_.vk_device(), vulkan_image_.vk_image,
+          allocation->vk_memory(), allocation->offset())) != VK_SUCCESS) {
+    return false;
+  }
+
+  vk_memory_info_ = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .pNext = nullptr,
+      .allocationSize = allocation->size(),
+      .memoryTypeIndex = allocation->memory_type(),
+  };
+  arena_allocation_ = std::move(allocation);
+  return true;
+}
+
+VkDeviceMemory VulkanSurface::GetVkMemory() const {
+  return arena_allocation_ ? arena_allocation_->vk_memory() : vk_memory_;
+}
+
+VkDeviceSize VulkanSurface::GetMemoryOffset() const {
+  return arena_allocation_ ? arena_allocation_->offset() : 0;
+}
+
 bool VulkanSurface::SetupSkiaSurface(sk_sp<GrContext> context,
                                      const SkISize& size,
                                      SkColorType color_type,
@@ -313,7 +412,7 @@ bool VulkanSurface::SetupSkiaSurface(sk_sp<GrContext> context,
 
   const GrVkImageInfo image_info = {
       vulkan_image_.vk_image,                // image
-      {vk_memory_, 0, memory_reqs.size, 0},  // alloc
+      {GetVkMemory(), GetMemoryOffset(), memory_reqs.size, 0},  // alloc
       image_create_info.tiling,              // tiling
       image_create_info.initialLayout,       // layout
       image_create_info.format,              // format
@@ -344,7 +443,7 @@ bool VulkanSurface::SetupSkiaSurface(sk_sp<GrContext> context,
 }
 
 bool VulkanSurface::PushSessionImageSetupOps(scenic::Session* session) {
-  FML_DCHECK(scenic_memory_ != nullptr);
+  FML_DCHECK(scenic_memory_ != nullptr || arena_allocation_ != nullptr);
 
   if (sk_surface_ == nullptr) {
     return false;
@@ -369,8 +468,11 @@ bool VulkanSurface::PushSessionImageSetupOps(scenic::Session* session) {
       return false;
   }
 
-  session_image_ = std::make_unique<scenic::Image>(
-      *scenic_memory_, 0 /* memory offset */, std::move(image_info));
+  scenic::Memory& memory = arena_allocation_
+                               ? arena_allocation_->scenic_memory()
+                               : *scenic_memory_;
+  session_image_ = std::make_unique<scenic::Image>(memory, GetMemoryOffset(),
+                                                   std::move(image_info));
 
   return session_image_ != nullptr;
 }
@@ -391,12 +493,26 @@ bool VulkanSurface::BindToImage(sk_sp<GrContext> context,
   FML_DCHECK(vulkan_image.vk_memory_requirements.size <=
              vk_memory_info_.allocationSize);
 
+  // The memory must be of a type the new image can be bound to.
+  if (!(vulkan_image.vk_memory_requirements.memoryTypeBits &
+        (1 << vk_memory_info_.memoryTypeIndex))) {
+    valid_ = false;
+    return false;
+  }
+
+  // A range of an arena block is only aligned for the image it was allocated
+  // for.
+  if (GetMemoryOffset() % vulkan_image.vk_memory_requirements.alignment != 0) {
+    valid_ = false;
+    return false;
+  }
+
   vulkan_image_ = std::move(vulkan_image);
 
   // Bind image memory.
   if (VK_CALL_LOG_ERROR(vulkan_provider_.vk().BindImageMemory(
-          vulkan_provider_.vk_device(), vulkan_image_.vk_image, vk_memory_,
-          0)) != VK_SUCCESS) {
+          vulkan_provider_.vk_device(), vulkan_image_.vk_image, GetVkMemory(),
+          GetMemoryOffset())) != VK_SUCCESS) {
     valid_ = false;
     return false;
   }
@@ -444,6 +560,7 @@ bool VulkanSurface::FlushSessionAcquireAndReleaseEvents() {
   session_->EnqueueAcquireFence(std::move(acquire));
   session_->EnqueueReleaseFence(std::move(release));
   age_ = 0;
+  use_count_++;
   return true;
 }
 
@@ -472,17 +589,11 @@ void VulkanSurface::Reset() {
         << "Could not reset fences. The surface is no longer valid.";
   }
 
-  VkFence fence = command_buffer_fence_;
-
-  if (command_buffer_) {
-    VK_CALL_LOG_ERROR(vulkan_provider_.vk().WaitForFences(
-        vulkan_provider_.vk_device(), 1, &fence, VK_TRUE, UINT64_MAX));
-    command_buffer_.reset();
+  if (pending_submission_) {
+    pending_submission_->Wait();
+    pending_submission_.reset();
   }
 
-  VK_CALL_LOG_ERROR(vulkan_provider_.vk().ResetFences(
-      vulkan_provider_.vk_device(), 1, &fence));
-
   // Need to make a new  acquire semaphore every frame or else validation layers
   // get confused about why no one is waiting on it in this VkInstance
   acquire_semaphore_.Reset();
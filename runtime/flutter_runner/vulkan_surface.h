@@ -19,7 +19,9 @@
 #include "flutter/vulkan/vulkan_proc_table.h"
 #include "flutter/vulkan/vulkan_provider.h"
 #include "lib/ui/scenic/cpp/resources.h"
+#include "surface_pool.h"
 #include "third_party/skia/include/core/SkSurface.h"
+#include "vulkan_memory_arena.h"
 
 namespace flutter_runner {
 
@@ -32,6 +34,9 @@ struct VulkanImage {
   VkExternalMemoryImageCreateInfo vk_external_image_create_info;
   VkImageCreateInfo vk_image_create_info;
   VkMemoryRequirements vk_memory_requirements;
+  // Whether the driver requires or prefers the image to have memory of its
+  // own, rather than a range of a larger allocation.
+  bool dedicated_allocation = false;
   vulkan::VulkanHandle<VkImage> vk_image;
 
   FML_DISALLOW_COPY_AND_ASSIGN(VulkanImage);
@@ -43,12 +48,47 @@ struct VulkanImage {
 bool CreateVulkanImage(vulkan::VulkanProvider& vulkan_provider,
                        const SkISize& size, VulkanImage* out_vulkan_image);
 
+// A command buffer recorded and submitted once on behalf of several
+// surfaces, and the fence that is signaled when the GPU is done with it.  The
+// surfaces share ownership of it until they are released by the compositor.
+class VulkanCommandSubmission final {
+ public:
+  VulkanCommandSubmission(vulkan::VulkanProvider& vulkan_provider,
+                          const vulkan::VulkanHandle<VkCommandPool>& pool);
+
+  // Waits for the GPU if the command buffer was submitted.
+  ~VulkanCommandSubmission();
+
+  vulkan::VulkanCommandBuffer* command_buffer() { return &command_buffer_; }
+
+  const vulkan::VulkanHandle<VkFence>& fence() const { return fence_; }
+
+  // Must be called once |fence()| has been passed to a queue submission.
+  void set_submitted() { submitted_ = true; }
+
+  // Blocks until the GPU is done with the command buffer.
+  void Wait();
+
+ private:
+  vulkan::VulkanProvider& vulkan_provider_;
+  vulkan::VulkanCommandBuffer command_buffer_;
+  vulkan::VulkanHandle<VkFence> fence_;
+  bool submitted_ = false;
+
+  FML_DISALLOW_COPY_AND_ASSIGN(VulkanCommandSubmission);
+};
+
 class VulkanSurface final
-    : public flutter::SceneUpdateContext::SurfaceProducerSurface {
+    : public flutter::SceneUpdateContext::SurfaceProducerSurface,
+      public SurfacePoolSurface {
  public:
+  // If |memory_arena| is not null, small surfaces take their memory from it
+  // instead of allocating and exporting memory of their own.  The arena must
+  // use the same session.
   VulkanSurface(vulkan::VulkanProvider& vulkan_provider,
                 sk_sp<GrContext> context, scenic::Session* session,
-                const SkISize& size);
+                const SkISize& size,
+                VulkanMemoryArena* memory_arena = nullptr);
 
   ~VulkanSurface() override;
 
@@ -83,36 +123,38 @@ class VulkanSurface final
     return acquire_semaphore_;
   }
 
-  vulkan::VulkanCommandBuffer* GetCommandBuffer(
-      const vulkan::VulkanHandle<VkCommandPool>& pool) {
-    if (!command_buffer_)
-      command_buffer_ = std::make_unique<vulkan::VulkanCommandBuffer>(
-          vulkan_provider_.vk(), vulkan_provider_.vk_device(), pool);
-    return command_buffer_.get();
+  // Keep |submission|, which transitions this surface's image for the
+  // compositor, alive until the compositor releases the surface.
+  void SetPendingSubmission(
+      std::shared_ptr<VulkanCommandSubmission> submission) {
+    pending_submission_ = std::move(submission);
   }
 
-  const vulkan::VulkanHandle<VkFence>& GetCommandBufferFence() {
-    return command_buffer_fence_;
+  // |SurfacePoolSurface|
+  size_t GetAllocationSize() const override {
+    return vk_memory_info_.allocationSize;
   }
 
-  size_t GetAllocationSize() const { return vk_memory_info_.allocationSize; }
-
-  size_t GetImageMemoryRequirementsSize() const {
+  // |SurfacePoolSurface|
+  size_t GetImageMemoryRequirementsSize() const override {
     return vulkan_image_.vk_memory_requirements.size;
   }
 
-  bool IsOversized() const {
-    return GetAllocationSize() > GetImageMemoryRequirementsSize();
-  }
+  // |SurfacePoolSurface|
+  size_t GetUseCount() const override { return use_count_; }
+
+  // |SurfacePoolSurface|
+  bool IsArenaBacked() const override { return arena_allocation_ != nullptr; }
 
-  bool HasStableSizeHistory() const {
+  // |SurfacePoolSurface|
+  bool HasStableSizeHistory() const override {
     return std::equal(size_history_.begin() + 1, size_history_.end(),
                       size_history_.begin());
   }
 
-  // Bind |vulkan_image| to |vk_memory_| and create a new skia surface,
-  // replacing the previous |vk_image_|.  |vulkan_image| MUST require less
-  // than or equal the amount of memory contained in |vk_memory_|. Returns
+  // Bind |vulkan_image| to this surface's memory and create a new skia
+  // surface, replacing the previous |vk_image_|.  |vulkan_image| MUST require
+  // less than or equal the amount of memory contained in this surface.  Returns
   // whether the swap was successful.  The |VulkanSurface| will become invalid
   // if the swap was not successful.
   bool BindToImage(sk_sp<GrContext> context, VulkanImage vulkan_image);
@@ -124,7 +166,7 @@ class VulkanSurface final
   // transformation matrix: |retained_key_.matrix()|. We need the matrix part
   // because a different matrix would invalidate the pixels (raster cache) in
   // this |VulkanSurface|.
-  const flutter::LayerRasterCacheKey& GetRetainedKey() const {
+  const flutter::LayerRasterCacheKey& GetRetainedKey() const override {
     return retained_key_;
   }
 
@@ -140,8 +182,12 @@ class VulkanSurface final
   // Check whether the retained surface (and its associated |EntityNode|) is
   // used in the current frame or not. If unused, the |VulkanSurfacePool| will
   // try to recycle the surface. This flag is reset after each frame.
-  bool IsUsedInRetainedRendering() const { return used_in_retained_rendering_; }
-  void ResetIsUsedInRetainedRendering() { used_in_retained_rendering_ = false; }
+  bool IsUsedInRetainedRendering() const override {
+    return used_in_retained_rendering_;
+  }
+  void ResetIsUsedInRetainedRendering() override {
+    used_in_retained_rendering_ = false;
+  }
 
   // Let this surface own the retained EntityNode associated with it (see
   // |GetRetainedNode|), and set the retained key (see |GetRetainedKey|).
@@ -158,8 +204,16 @@ class VulkanSurface final
                      zx_status_t status, const zx_packet_signal_t* signal);
 
   bool AllocateDeviceMemory(sk_sp<GrContext> context, const SkISize& size,
+                            VulkanMemoryArena* memory_arena,
                             zx::vmo& exported_vmo);
 
+  // Bind |vulkan_image_| to a range of |memory_arena|.
+  bool AllocateArenaMemory(VulkanMemoryArena* memory_arena);
+
+  VkDeviceMemory GetVkMemory() const;
+
+  VkDeviceSize GetMemoryOffset() const;
+
   bool SetupSkiaSurface(sk_sp<GrContext> context, const SkISize& size,
                         SkColorType color_type,
                         const VkImageCreateInfo& image_create_info,
@@ -177,22 +231,25 @@ class VulkanSurface final
   vulkan::VulkanProvider& vulkan_provider_;
   scenic::Session* session_;
   VulkanImage vulkan_image_;
+  // Either |vk_memory_| and |scenic_memory_| or |arena_allocation_| back the
+  // image.
   vulkan::VulkanHandle<VkDeviceMemory> vk_memory_;
+  std::unique_ptr<VulkanMemoryArena::Allocation> arena_allocation_;
   VkMemoryAllocateInfo vk_memory_info_;
-  vulkan::VulkanHandle<VkFence> command_buffer_fence_;
   sk_sp<SkSurface> sk_surface_;
   // TODO: Don't heap allocate this once SCN-268 is resolved.
   std::unique_ptr<scenic::Memory> scenic_memory_;
   std::unique_ptr<scenic::Image> session_image_;
   zx::event acquire_event_;
   vulkan::VulkanHandle<VkSemaphore> acquire_semaphore_;
-  std::unique_ptr<vulkan::VulkanCommandBuffer> command_buffer_;
+  std::shared_ptr<VulkanCommandSubmission> pending_submission_;
   zx::event release_event_;
   async::WaitMethod<VulkanSurface, &VulkanSurface::OnHandleReady> wait_;
   std::function<void()> pending_on_writes_committed_;
   std::array<SkISize, kSizeHistorySize> size_history_;
   int size_history_index_ = 0;
   size_t age_ = 0;
+  size_t use_count_ = 0;
   bool valid_ = false;
 
   flutter::LayerRasterCacheKey retained_key_ = {0, SkMatrix::MakeScale(1, 1)};
@@ -4,92 +4,82 @@
 
 #pragma once
 
-#include <unordered_map>
-#include <vector>
+#include <memory>
 
 #include "flutter/fml/macros.h"
+#include "surface_pool.h"
+#include "vulkan_memory_arena.h"
 #include "vulkan_surface.h"
 
 namespace flutter_runner {
 
-class VulkanSurfacePool final {
+// Creates |VulkanSurface|s for |VulkanSurfacePool|, sub-allocating small ones
+// from a |VulkanMemoryArena|.
+class VulkanSurfacePoolBackend final : public SurfacePoolBackend {
  public:
-  // Only keep 12 surfaces at a time.  This value was based on how many
-  // surfaces got cached in the old, exact-match-only caching logic.
-  static constexpr int kMaxSurfaces = 12;
-  // If a surface doesn't get used for 3 or more generations, we discard it.
-  static constexpr int kMaxSurfaceAge = 3;
+  VulkanSurfacePoolBackend(vulkan::VulkanProvider& vulkan_provider,
+                           sk_sp<GrContext> context,
+                           scenic::Session* scenic_session);
 
-  VulkanSurfacePool(vulkan::VulkanProvider& vulkan_provider,
-                    sk_sp<GrContext> context, scenic::Session* scenic_session);
-
-  ~VulkanSurfacePool();
+  ~VulkanSurfacePoolBackend() override;
 
-  std::unique_ptr<VulkanSurface> AcquireSurface(const SkISize& size);
+  // |SurfacePoolBackend|
+  std::unique_ptr<SurfacePoolSurface> CreateSurface(
+      const SkISize& size) override;
 
-  void SubmitSurface(
-      std::unique_ptr<flutter::SceneUpdateContext::SurfaceProducerSurface>
-          surface);
+  // |SurfacePoolBackend|
+  std::unique_ptr<SurfacePoolImage> CreateImage(const SkISize& size) override;
 
-  void AgeAndCollectOldBuffers();
+  // |SurfacePoolBackend|
+  bool BindToImage(SurfacePoolSurface* surface,
+                   std::unique_ptr<SurfacePoolImage> image) override;
 
-  // Shrink all oversized |VulkanSurfaces| in |available_surfaces_| to as
-  // small as they can be.
-  void ShrinkToFit();
+  // |SurfacePoolBackend|
+  size_t GetArenaBytes() const override {
+    return memory_arena_.block_count() * VulkanMemoryArena::kBlockSize;
+  }
 
-  // For |VulkanSurfaceProducer::HasRetainedNode|.
-  bool HasRetainedNode(const flutter::LayerRasterCacheKey& key) const {
-    return retained_surfaces_.find(key) != retained_surfaces_.end();
+  // |SurfacePoolBackend|
+  bool IsArenaFragmented() const override {
+    return memory_arena_.IsFragmented();
   }
-  // For |VulkanSurfaceProducer::GetRetainedNode|.
-  const scenic::EntityNode& GetRetainedNode(
-      const flutter::LayerRasterCacheKey& key)  {
-    FML_DCHECK(HasRetainedNode(key));
-    return retained_surfaces_[key].vk_surface->GetRetainedNode();
+
+  // |SurfacePoolBackend|
+  void ReleaseEmptyArenaBlocks() override {
+    memory_arena_.ReleaseEmptyBlocks();
   }
 
+  // |SurfacePoolBackend|
+  void TraceStats() override;
 
  private:
-  // Struct for retained_surfaces_ map.
-  struct RetainedSurface {
-    // If |is_pending| is true, the |vk_surface| is still under painting
-    // (similar to those in |pending_surfaces_|) so we can't recycle the
-    // |vk_surface| yet.
-    bool is_pending;
-    std::unique_ptr<VulkanSurface> vk_surface;
-  };
-
   vulkan::VulkanProvider& vulkan_provider_;
   sk_sp<GrContext> context_;
   scenic::Session* scenic_session_;
-  std::vector<std::unique_ptr<VulkanSurface>> available_surfaces_;
-  std::unordered_map<uintptr_t, std::unique_ptr<VulkanSurface>>
-      pending_surfaces_;
-
-  // Retained surfaces keyed by the layer that created and used the surface.
-  flutter::LayerRasterCacheKey::Map<RetainedSurface>
-      retained_surfaces_;
+  VulkanMemoryArena memory_arena_;
 
-  size_t trace_surfaces_created_ = 0;
-  size_t trace_surfaces_reused_ = 0;
-
-  std::unique_ptr<VulkanSurface> GetCachedOrCreateSurface(const SkISize& size);
-
-  std::unique_ptr<VulkanSurface> CreateSurface(const SkISize& size);
+  FML_DISALLOW_COPY_AND_ASSIGN(VulkanSurfacePoolBackend);
+};
 
-  void RecycleSurface(std::unique_ptr<VulkanSurface> surface);
+// A |SurfacePool| of |VulkanSurface|s.
+class VulkanSurfacePool final : public SurfacePool {
+ public:
+  VulkanSurfacePool(vulkan::VulkanProvider& vulkan_provider,
+                    sk_sp<GrContext> context, scenic::Session* scenic_session,
+                    size_t max_bytes = kDefaultMaxBytes);
 
-  void RecyclePendingSurface(uintptr_t surface_key);
+  ~VulkanSurfacePool();
 
-  // Clear the |is_pending| flag of the retained surface.
-  void SignalRetainedReady(flutter::LayerRasterCacheKey key);
+  std::unique_ptr<VulkanSurface> AcquireSurface(const SkISize& size);
 
-  // Remove the corresponding surface from |retained_surfaces| and recycle it.
-  // The surface must not be pending.
-  void RecycleRetainedSurface(const flutter::LayerRasterCacheKey& key);
+  void SubmitSurface(
+      std::unique_ptr<flutter::SceneUpdateContext::SurfaceProducerSurface>
+          surface);
 
-  void TraceStats();
+  const scenic::EntityNode& GetRetainedNode(
+      const flutter::LayerRasterCacheKey& key);
 
+ private:
   FML_DISALLOW_COPY_AND_ASSIGN(VulkanSurfacePool);
 };
 
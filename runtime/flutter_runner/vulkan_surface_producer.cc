@@ -8,6 +8,7 @@
 #include <lib/async/cpp/task.h>
 #include <trace/event.h>
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -23,20 +24,30 @@ namespace flutter_runner {
 namespace {
 
 constexpr int kGrCacheMaxCount = 8192;
-// Tuning advice:
-// If you see the following 3 things happening simultaneously in a trace:
-//   * Over budget ("flutter", "GPURasterizer::Draw") durations
-//   * Many ("skia", "GrGpu::createTexture") events within the
-//     "GPURasterizer::Draw"s
-//   * The Skia GPU resource cache is full, as indicated by the
-//     "SkiaCacheBytes" field in the ("flutter", "SurfacePool") trace counter
-//     (compare it to the bytes value here)
-// then you should consider increasing the size of the GPU resource cache.
-constexpr size_t kGrCacheMaxByteSize = 16 * (1 << 20);
+// The byte limit of the GPU resource cache is adjusted at runtime by
+// |GrCacheBudgetController|.  Its decisions show up in the
+// ("flutter", "SkiaCacheBudget") trace counter.  If a trace shows over budget
+// ("flutter", "GPURasterizer::Draw") durations with many
+// ("skia", "GrGpu::createTexture") events while the budget sits at
+// |max_bytes|, consider raising |max_bytes|.
+constexpr GrCacheBudgetController::Config kGrCacheBudgetConfig = {
+    .min_bytes = 8 * (1 << 20),
+    .max_bytes = 64 * (1 << 20),
+    .initial_bytes = 16 * (1 << 20),
+    .step_bytes = 4 * (1 << 20),
+    .frames_to_grow = 3,
+    .frames_to_shrink = 120,
+};
 
 }  // namespace
 
-VulkanSurfaceProducer::VulkanSurfaceProducer(scenic::Session* scenic_session) {
+VulkanSurfaceProducer::VulkanSurfaceProducer(
+    scenic::Session* scenic_session,
+    std::shared_ptr<VsyncRecorder> vsync_recorder,
+    std::shared_ptr<FrameTimings> frame_timings)
+    : gr_cache_budget_(kGrCacheBudgetConfig),
+      vsync_recorder_(std::move(vsync_recorder)),
+      frame_timings_(std::move(frame_timings)) {
   valid_ = Initialize(scenic_session);
 
   if (valid_) {
@@ -125,7 +136,8 @@ bool VulkanSurfaceProducer::Initialize(scenic::Session* scenic_session) {
   context_ = GrContext::MakeVulkan(backend_context);
 
   // Use local limits specified in this file above instead of flutter defaults.
-  context_->setResourceCacheLimits(kGrCacheMaxCount, kGrCacheMaxByteSize);
+  context_->setResourceCacheLimits(kGrCacheMaxCount,
+                                   gr_cache_budget_.budget());
 
   surface_pool_ =
       std::make_unique<VulkanSurfacePool>(*this, context_, scenic_session);
@@ -142,6 +154,8 @@ void VulkanSurfaceProducer::OnSurfacesPresented(
   // Do a single flush for all canvases derived from the context.
   {
     TRACE_DURATION("flutter", "GrContext::flushAndSignalSemaphores");
+    FrameTimings::ScopedPhase phase(frame_timings_.get(),
+                                   FramePhase::kGrContextFlush);
     context_->flush();
   }
 
@@ -155,36 +169,157 @@ void VulkanSurfaceProducer::OnSurfacesPresented(
 
   // Buffer management.
   surface_pool_->AgeAndCollectOldBuffers();
+  ScheduleReserveRefill();
+
+  {
+    int resources = 0;
+    size_t bytes = 0;
+    context_->getResourceCacheUsage(&resources, &bytes);
+    ApplyGrCacheBudget(gr_cache_budget_.OnFrame(
+        bytes, context_->getResourceCachePurgeableBytes()));
+  }
+
+  // Once no frame has been presented for a while, shrink our surface pool
+  // to fit.
+  idle_detector_.OnFrame(
+      fml::TimePoint::Now(),
+      vsync_recorder_->GetCurrentVsyncInfo().presentation_interval);
+  ScheduleIdleCheck();
+}
 
-  // If no further surface production has taken place for 10 frames (TODO:
-  // Don't hardcode refresh rate here), then shrink our surface pool to fit.
-  constexpr auto kShouldShrinkThreshold = zx::msec(10 * 16.67);
+void VulkanSurfaceProducer::ScheduleIdleCheck() {
+  if (idle_check_pending_ || !idle_detector_.shrink_pending()) {
+    return;
+  }
+  idle_check_pending_ = true;
+  // Frames presented before the task runs only push the deadline back, so
+  // when it runs early it posts itself again for the new deadline instead of
+  // every frame posting a task of its own.
+  const auto delay = idle_detector_.IdleDeadline() - fml::TimePoint::Now();
   async::PostDelayedTask(async_get_default_dispatcher(),
-      [self = weak_factory_.GetWeakPtr(), kShouldShrinkThreshold] {
-        if (!self) {
-          return;
-        }
-        auto time_since_last_produce =
-            async::Now(async_get_default_dispatcher()) - self->last_produce_time_;
-        if (time_since_last_produce >= kShouldShrinkThreshold) {
-          self->surface_pool_->ShrinkToFit();
-        }
-      },
-      kShouldShrinkThreshold);
+                         [self = weak_factory_.GetWeakPtr()] {
+                           if (!self) {
+                             return;
+                           }
+                           self->idle_check_pending_ = false;
+                           if (self->idle_detector_.ShouldShrink(
+                                   fml::TimePoint::Now())) {
+                             self->ShrinkWhenIdle();
+                           } else {
+                             self->ScheduleIdleCheck();
+                           }
+                         },
+                         zx::nsec(std::max<int64_t>(delay.ToNanoseconds(), 0)));
+}
+
+void VulkanSurfaceProducer::ShrinkWhenIdle() {
+  TRACE_DURATION("flutter", "VulkanSurfaceProducer::ShrinkWhenIdle");
+  idle_detector_.OnShrink(fml::TimePoint::Now());
+  const size_t pool_reclaimed_bytes = surface_pool_->ShrinkToFit();
+  const size_t skia_reclaimed_bytes = PurgeGrCacheWhenIdle();
+  trace_idle_shrinks_++;
+  TRACE_COUNTER("flutter", "IdleShrink", 0u,                  //
+                "Shrinks", trace_idle_shrinks_,               //
+                "PoolReclaimedBytes", pool_reclaimed_bytes,   //
+                "SkiaReclaimedBytes", skia_reclaimed_bytes,   //
+                "IdleFrames", idle_detector_.idle_frames()    //
+  );
+}
+
+size_t VulkanSurfaceProducer::PurgeGrCacheWhenIdle() {
+  TRACE_DURATION("flutter", "VulkanSurfaceProducer::PurgeGrCacheWhenIdle");
+  int resources = 0;
+  size_t bytes_before = 0;
+  context_->getResourceCacheUsage(&resources, &bytes_before);
+  // Scratch resources are the ones Skia would otherwise keep around to
+  // avoid recreating textures from frame to frame.
+  context_->purgeUnlockedResources(true /* scratchResourcesOnly */);
+  size_t bytes = 0;
+  context_->getResourceCacheUsage(&resources, &bytes);
+  ApplyGrCacheBudget(gr_cache_budget_.OnIdle(bytes));
+  return bytes_before > bytes ? bytes_before - bytes : 0;
+}
+
+void VulkanSurfaceProducer::ApplyGrCacheBudget(
+    GrCacheBudgetController::Decision decision) {
+  if (decision != GrCacheBudgetController::Decision::kKeep) {
+    context_->setResourceCacheLimits(kGrCacheMaxCount,
+                                     gr_cache_budget_.budget());
+  }
+  const int grew = decision == GrCacheBudgetController::Decision::kGrow;
+  const int shrank = decision == GrCacheBudgetController::Decision::kShrink;
+  TRACE_COUNTER("flutter", "SkiaCacheBudget", 0u,           //
+                "BudgetBytes", gr_cache_budget_.budget(),  //
+                "Grew", grew,                              //
+                "Shrank", shrank                           //
+  );
+}
+
+void VulkanSurfaceProducer::ScheduleReserveRefill() {
+  if (reserve_refill_pending_ || !surface_pool_->NeedsReserveRefill()) {
+    return;
+  }
+  reserve_refill_pending_ = true;
+  async::PostTask(async_get_default_dispatcher(),
+                  [self = weak_factory_.GetWeakPtr()] {
+                    if (!self) {
+                      return;
+                    }
+                    self->reserve_refill_pending_ = false;
+                    if (self->surface_pool_->RefillReserve()) {
+                      self->ScheduleReserveRefill();
+                    }
+                  });
+}
+
+void VulkanSurfaceProducer::OnSessionSizeChangeHint(
+    float width_change_factor,
+    float height_change_factor) {
+  FX_LOGF(INFO, LOG_TAG, "VulkanSurfaceProducer:OnSessionSizeChangeHint %f, %f",
+          width_change_factor, height_change_factor);
+
+  // Surfaces can only be created on this thread, since they need |context_|
+  // and the session.  Create them in a separate task so that frames that are
+  // already queued up don't wait for them.
+  async::PostTask(async_get_default_dispatcher(),
+                  [self = weak_factory_.GetWeakPtr(), width_change_factor,
+                   height_change_factor] {
+                    if (!self) {
+                      return;
+                    }
+                    self->surface_pool_->PreallocateSurfaces(
+                        width_change_factor, height_change_factor);
+                  });
 }
 
 bool VulkanSurfaceProducer::TransitionSurfacesToExternal(
     const std::vector<
         std::unique_ptr<flutter::SceneUpdateContext::SurfaceProducerSurface>>&
         surfaces) {
+  TRACE_DURATION("flutter", "VulkanSurfaceProducer::TransitionSurfacesToExternal",
+                 "surfaces", surfaces.size());
+  if (surfaces.empty()) {
+    return true;
+  }
+
+  // Record the barriers for every surface of the frame into one command
+  // buffer and submit it once, signaling each surface's acquire semaphore.
+  auto submission = std::make_shared<VulkanCommandSubmission>(
+      *this, logical_device_->GetCommandPool());
+  vulkan::VulkanCommandBuffer* command_buffer = submission->command_buffer();
+  if (!command_buffer->Begin())
+    return false;
+
+  std::vector<GrBackendRenderTarget> render_targets;
+  std::vector<VkImageMemoryBarrier> image_barriers;
+  std::vector<VkSemaphore> signal_semaphores;
+  render_targets.reserve(surfaces.size());
+  image_barriers.reserve(surfaces.size());
+  signal_semaphores.reserve(surfaces.size());
+
   for (auto& surface : surfaces) {
     auto vk_surface = static_cast<VulkanSurface*>(surface.get());
 
-    vulkan::VulkanCommandBuffer* command_buffer =
-        vk_surface->GetCommandBuffer(logical_device_->GetCommandPool());
-    if (!command_buffer->Begin())
-      return false;
-
     GrBackendRenderTarget backendRT =
         vk_surface->GetSkiaSurface()->getBackendRenderTarget(
             SkSurface::kFlushRead_BackendHandleAccess);
@@ -196,7 +331,7 @@ bool VulkanSurfaceProducer::TransitionSurfacesToExternal(
       return false;
     }
 
-    VkImageMemoryBarrier image_barrier = {
+    image_barriers.push_back({
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .pNext = nullptr,
         .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
@@ -206,27 +341,45 @@ bool VulkanSurfaceProducer::TransitionSurfacesToExternal(
         .srcQueueFamilyIndex = 0,
         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_EXTERNAL_KHR,
         .image = vk_surface->GetVkImage(),
-        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
-
-    if (!command_buffer->InsertPipelineBarrier(
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-            0,           // dependencyFlags
-            0, nullptr,  // memory barriers
-            0, nullptr,  // buffer barriers
-            1, &image_barrier))
-      return false;
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}});
+    signal_semaphores.push_back(vk_surface->GetAcquireVkSemaphore());
+    render_targets.push_back(std::move(backendRT));
+  }
 
-    backendRT.setVkImageLayout(image_barrier.newLayout);
+  if (!command_buffer->InsertPipelineBarrier(
+          VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+          VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+          0,           // dependencyFlags
+          0, nullptr,  // memory barriers
+          0, nullptr,  // buffer barriers
+          static_cast<uint32_t>(image_barriers.size()),
+          image_barriers.data()))
+    return false;
 
-    if (!command_buffer->End())
-      return false;
+  for (auto& render_target : render_targets) {
+    render_target.setVkImageLayout(VK_IMAGE_LAYOUT_GENERAL);
+  }
 
-    if (!logical_device_->QueueSubmit(
-            {}, {}, {vk_surface->GetAcquireVkSemaphore()},
-            {command_buffer->Handle()}, vk_surface->GetCommandBufferFence()))
-      return false;
+  if (!command_buffer->End())
+    return false;
+
+  if (!logical_device_->QueueSubmit({}, {}, signal_semaphores,
+                                    {command_buffer->Handle()},
+                                    submission->fence()))
+    return false;
+  submission->set_submitted();
+
+  for (auto& surface : surfaces) {
+    static_cast<VulkanSurface*>(surface.get())
+        ->SetPendingSubmission(submission);
   }
+
+  // Previously every surface was submitted on its own, so "Surfaces" is the
+  // number of submits this frame would have taken before batching.
+  TRACE_COUNTER("flutter", "SurfaceTransitions", 0u,  //
+                "Surfaces", surfaces.size(),          //
+                "QueueSubmits", 1                     //
+  );
   return true;
 }
 
@@ -236,7 +389,8 @@ VulkanSurfaceProducer::ProduceSurface(
     const flutter::LayerRasterCacheKey& layer_key,
     std::unique_ptr<scenic::EntityNode> entity_node) {
   FML_DCHECK(valid_);
-  last_produce_time_ = async::Now(async_get_default_dispatcher());
+  FrameTimings::ScopedPhase phase(frame_timings_.get(),
+                                 FramePhase::kSurfaceAcquire);
   auto surface = surface_pool_->AcquireSurface(size);
   surface->SetRetainedInfo(layer_key, std::move(entity_node));
   return surface;
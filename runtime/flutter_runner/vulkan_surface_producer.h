@@ -17,8 +17,12 @@
 #include "lib/ui/scenic/cpp/resources.h"
 #include "lib/ui/scenic/cpp/session.h"
 
+#include "topaz/runtime/flutter_runner/frame_timings.h"
+#include "topaz/runtime/flutter_runner/gr_cache_budget_controller.h"
+#include "topaz/runtime/flutter_runner/idle_detector.h"
 #include "topaz/runtime/flutter_runner/logging.h"
 #include "topaz/runtime/flutter_runner/vulkan_surface.h"
+#include "topaz/runtime/flutter_runner/vsync_recorder.h"
 #include "topaz/runtime/flutter_runner/vulkan_surface_pool.h"
 
 namespace flutter_runner {
@@ -27,7 +31,9 @@ class VulkanSurfaceProducer final
     : public flutter::SceneUpdateContext::SurfaceProducer,
       public vulkan::VulkanProvider {
  public:
-  VulkanSurfaceProducer(scenic::Session* scenic_session);
+  VulkanSurfaceProducer(scenic::Session* scenic_session,
+                        std::shared_ptr<VsyncRecorder> vsync_recorder,
+                        std::shared_ptr<FrameTimings> frame_timings);
 
   ~VulkanSurfaceProducer();
 
@@ -61,11 +67,7 @@ class VulkanSurfaceProducer final
           surfaces);
 
   void OnSessionSizeChangeHint(float width_change_factor,
-                               float height_change_factor) {
-    FX_LOGF(INFO, LOG_TAG,
-            "VulkanSurfaceProducer:OnSessionSizeChangeHint %f, %f",
-            width_change_factor, height_change_factor);
-  }
+                               float height_change_factor);
 
  private:
   // VulkanProvider
@@ -86,16 +88,42 @@ class VulkanSurfaceProducer final
   std::unique_ptr<vulkan::VulkanApplication> application_;
   std::unique_ptr<vulkan::VulkanDevice> logical_device_;
   sk_sp<GrContext> context_;
+  GrCacheBudgetController gr_cache_budget_;
   std::unique_ptr<VulkanSurfacePool> surface_pool_;
   bool valid_ = false;
-
-  // Keep track of the last time we produced a surface.  This is used to
-  // determine whether it is safe to shrink |surface_pool_| or not.
-  zx::time last_produce_time_ = async::Now(async_get_default_dispatcher());
+  // Set while a task to refill |surface_pool_|'s reserve is posted.
+  bool reserve_refill_pending_ = false;
+
+  // Supplies the refresh interval |idle_detector_| counts frames in.
+  std::shared_ptr<VsyncRecorder> vsync_recorder_;
+  // Where surface acquisition and |GrContext| flush times go.  May be null.
+  std::shared_ptr<FrameTimings> frame_timings_;
+  // Decides when |surface_pool_| has been idle long enough to shrink.
+  IdleDetector idle_detector_;
+  // Set while a task to check |idle_detector_| is posted.
+  bool idle_check_pending_ = false;
+  size_t trace_idle_shrinks_ = 0;
   fml::WeakPtrFactory<VulkanSurfaceProducer> weak_factory_{this};
 
   bool Initialize(scenic::Session* scenic_session);
 
+  // Refill the reserve of |surface_pool_| one surface per task, so that
+  // frames queued in the meantime run first.
+  void ScheduleReserveRefill();
+
+  // Post a single task that shrinks |surface_pool_| and Skia's cache once
+  // |idle_detector_| says the view is idle.
+  void ScheduleIdleCheck();
+
+  void ShrinkWhenIdle();
+
+  // Purge Skia's scratch resources and lower the cache budget to what is
+  // still in use.  Returns the bytes purged.
+  size_t PurgeGrCacheWhenIdle();
+
+  // Apply the budget picked by |gr_cache_budget_| and trace the decision.
+  void ApplyGrCacheBudget(GrCacheBudgetController::Decision decision);
+
   // Disallow copy and assignment.
   VulkanSurfaceProducer(const VulkanSurfaceProducer&) = delete;
   VulkanSurfaceProducer& operator=(const VulkanSurfaceProducer&) = delete;
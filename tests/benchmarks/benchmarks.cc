@@ -24,6 +24,28 @@ int main(int argc, const char** argv) {
 
   if (benchmarking::IsVulkanSupported()) {
     AddGraphicsBenchmarks(&benchmarks_runner);
+
+    // Compare "surfaces_presented" across builds to see the effect of changes
+    // to how the Flutter runner hands its surfaces to Scenic.
+    benchmarks_runner.AddTspecBenchmark(
+        "flutter.surface_transitions",
+        "/pkgfs/packages/topaz_benchmarks/0/data/"
+        "flutter_surface_transitions.tspec");
+
+    // "scene_command_proxy" is what filtering Scenic commands in the runner
+    // costs per frame, to weigh against the commands it leaves out.  The
+    // "SceneCommands" trace counter has those.
+    benchmarks_runner.AddTspecBenchmark(
+        "flutter.scene_commands",
+        "/pkgfs/packages/topaz_benchmarks/0/data/"
+        "flutter_scene_commands.tspec");
+
+    // Compare "acquire_surface" and "submit_surface" across builds to see
+    // what changes to the runner's surface pool cost the raster thread.
+    benchmarks_runner.AddTspecBenchmark(
+        "flutter.surface_pool",
+        "/pkgfs/packages/topaz_benchmarks/0/data/"
+        "flutter_surface_pool.tspec");
   } else {
     FXL_LOG(INFO) << "Vulkan not supported; graphics tests skipped.";
   }